@@ -101,6 +101,7 @@ void exit_program(int ret)
     if (program_exit)
         program_exit(ret);
 
+    av_log_flush();
     exit(ret);
 }
 
@@ -517,6 +517,7 @@ static void ffmpeg_cleanup(int ret)
     hw_device_free_all();
 
     av_freep(&filter_nbthreads);
+    av_freep(&filter_pool_flags);
 
     av_freep(&input_files);
     av_freep(&output_files);
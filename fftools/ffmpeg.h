@@ -234,6 +234,10 @@ typedef struct OptionsContext {
     int        nb_pass;
     SpecifierOpt *passlogfiles;
     int        nb_passlogfiles;
+    SpecifierOpt *chunk_threads;
+    int        nb_chunk_threads;
+    SpecifierOpt *chunk_durations;
+    int        nb_chunk_durations;
     SpecifierOpt *max_muxing_queue_size;
     int        nb_max_muxing_queue_size;
     SpecifierOpt *muxing_queue_data_threshold;
@@ -609,6 +613,8 @@ typedef struct OutputStream {
     int is_cfr;
     int force_fps;
     int top_field_first;
+    int chunk_threads;
+    int64_t chunk_duration;
 #if FFMPEG_ROTATION_METADATA
     int rotate_overridden;
 #endif
@@ -737,6 +743,7 @@ extern AVIOContext *progress_avio;
 extern float max_error_rate;
 
 extern char *filter_nbthreads;
+extern char *filter_pool_flags;
 extern int filter_complex_nbthreads;
 extern int vstats_version;
 extern int auto_conversion_filters;
@@ -20,6 +20,8 @@
 #include <stdint.h>
 
 #include "ffmpeg.h"
+#include "objpool.h"
+#include "thread_queue.h"
 
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
@@ -27,11 +29,14 @@
 #include "libavutil/dict.h"
 #include "libavutil/display.h"
 #include "libavutil/eval.h"
+#include "libavutil/fifo.h"
 #include "libavutil/frame.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/log.h"
+#include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/rational.h"
+#include "libavutil/thread.h"
 #include "libavutil/timestamp.h"
 
 #include "libavfilter/buffersink.h"
@@ -43,6 +48,67 @@
 
 #include "libavformat/avformat.h"
 
+typedef struct EncChunk {
+    /* encoded packets (AVPacket*), in the order the encoder returned them */
+    AVFifo *packets;
+    /* set by the worker once the chunk encoder has been flushed */
+    int     done;
+} EncChunk;
+
+typedef struct EncChunkWorker {
+    struct EncChunks *cs;
+    int               index;
+
+    /* frames of the chunks assigned to this worker,
+     * a frame without data terminates a chunk */
+    ThreadQueue      *queue;
+
+    pthread_t         thread;
+    int               thread_started;
+} EncChunkWorker;
+
+/**
+ * State for chunked encoding: the frames are split into chunks starting
+ * with a keyframe, each chunk is encoded by a separate encoder instance
+ * on one of the worker threads and the packets are output in chunk order.
+ */
+typedef struct EncChunks {
+    OutputStream   *ost;
+
+    /* unopened encoder context holding the configuration for the chunk
+     * encoders, and the options they are opened with */
+    AVCodecContext *base;
+    AVDictionary   *opts;
+    int             keep_sar;
+
+    EncChunkWorker *workers;
+    int          nb_workers;
+
+    /* ring buffer of chunks being encoded or output, indexed by the
+     * chunk number modulo nb_chunks */
+    EncChunk       *chunks;
+    int          nb_chunks;
+
+    /* chunk receiving frames and the number of frames sent to it */
+    int64_t         chunk_in;
+    int64_t         chunk_frames;
+    /* chunk whose packets are being output */
+    int64_t         chunk_out;
+
+    /* a chunk is terminated at the first keyframe after min_frames,
+     * and unconditionally after max_frames */
+    int64_t         min_frames;
+    int64_t         max_frames;
+
+    AVFrame        *frame;
+
+    /* protects the chunks and ret */
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    /* first error returned by a worker */
+    int             ret;
+} EncChunks;
+
 struct Encoder {
     /* predicted pts of the next frame to be encoded */
     int64_t next_pts;
@@ -62,10 +128,53 @@ struct Encoder {
 
     // number of packets received from the encoder
     uint64_t packets_encoded;
+
+    EncChunks *chunks;
 };
 
 static uint64_t dup_warning = 1000;
 
+static void enc_chunks_free(EncChunks **pcs)
+{
+    EncChunks *cs = *pcs;
+
+    if (!cs)
+        return;
+
+    for (int i = 0; i < cs->nb_workers; i++) {
+        EncChunkWorker *w = &cs->workers[i];
+
+        if (w->thread_started) {
+            tq_send_finish(w->queue, 0);
+            pthread_join(w->thread, NULL);
+        }
+        tq_free(&w->queue);
+    }
+    av_freep(&cs->workers);
+
+    for (int i = 0; i < cs->nb_chunks; i++) {
+        EncChunk *c = &cs->chunks[i];
+        AVPacket *pkt;
+
+        if (!c->packets)
+            continue;
+
+        while (av_fifo_read(c->packets, &pkt, 1) >= 0)
+            av_packet_free(&pkt);
+        av_fifo_freep2(&c->packets);
+    }
+    av_freep(&cs->chunks);
+
+    avcodec_free_context(&cs->base);
+    av_dict_free(&cs->opts);
+    av_frame_free(&cs->frame);
+
+    pthread_cond_destroy(&cs->cond);
+    pthread_mutex_destroy(&cs->lock);
+
+    av_freep(pcs);
+}
+
 void enc_free(Encoder **penc)
 {
     Encoder *enc = *penc;
@@ -73,6 +182,8 @@ void enc_free(Encoder **penc)
     if (!enc)
         return;
 
+    enc_chunks_free(&enc->chunks);
+
     av_frame_free(&enc->last_frame);
     av_frame_free(&enc->sq_frame);
 
@@ -149,6 +260,295 @@ static void init_encoder_time_base(OutputStream *ost, AVRational default_time_ba
     enc_ctx->time_base = default_time_base;
 }
 
+static void frame_move(void *dst, void *src)
+{
+    av_frame_move_ref(dst, src);
+}
+
+/* copy the encoder configuration from an unopened context */
+static int enc_chunk_ctx_copy(AVCodecContext *dst, const AVCodecContext *src)
+{
+    int ret;
+
+    ret = av_opt_copy(dst, src);
+    if (ret < 0)
+        return ret;
+
+    dst->framerate = src->framerate;
+
+    if (src->intra_matrix &&
+        !(dst->intra_matrix = av_memdup(src->intra_matrix, sizeof(*src->intra_matrix) * 64)))
+        return AVERROR(ENOMEM);
+    if (src->inter_matrix &&
+        !(dst->inter_matrix = av_memdup(src->inter_matrix, sizeof(*src->inter_matrix) * 64)))
+        return AVERROR(ENOMEM);
+    if (src->chroma_intra_matrix &&
+        !(dst->chroma_intra_matrix = av_memdup(src->chroma_intra_matrix,
+                                               sizeof(*src->chroma_intra_matrix) * 64)))
+        return AVERROR(ENOMEM);
+    if (src->rc_override_count &&
+        !(dst->rc_override = av_memdup(src->rc_override,
+                                       sizeof(*src->rc_override) * src->rc_override_count)))
+        return AVERROR(ENOMEM);
+
+    if (src->hw_device_ctx &&
+        !(dst->hw_device_ctx = av_buffer_ref(src->hw_device_ctx)))
+        return AVERROR(ENOMEM);
+    if (src->hw_frames_ctx &&
+        !(dst->hw_frames_ctx = av_buffer_ref(src->hw_frames_ctx)))
+        return AVERROR(ENOMEM);
+
+    return 0;
+}
+
+static int enc_chunk_open(EncChunks *cs, OutputStream *ost,
+                          AVCodecContext **penc, const AVFrame *frame)
+{
+    const AVCodecContext *ref = ost->enc_ctx;
+    AVDictionary *opts = NULL;
+    AVCodecContext *enc;
+    int ret;
+
+    enc = avcodec_alloc_context3(cs->base->codec);
+    if (!enc)
+        return AVERROR(ENOMEM);
+    *penc = enc;
+
+    ret = enc_chunk_ctx_copy(enc, cs->base);
+    if (ret < 0)
+        return ret;
+
+    if (frame->sample_aspect_ratio.num && !cs->keep_sar)
+        enc->sample_aspect_ratio = frame->sample_aspect_ratio;
+
+    ret = av_dict_copy(&opts, cs->opts, 0);
+    if (ret < 0)
+        return ret;
+
+    ret = avcodec_open2(enc, enc->codec, &opts);
+    av_dict_free(&opts);
+    if (ret < 0)
+        return ret;
+
+    /* all the chunks must be decodable with the stream parameters */
+    if (enc->extradata_size != ref->extradata_size ||
+        (ref->extradata_size &&
+         memcmp(enc->extradata, ref->extradata, ref->extradata_size))) {
+        av_log(ost, AV_LOG_ERROR, "Chunk encoder produced different global "
+               "headers, chunked encoding is not supported with these "
+               "encoder settings\n");
+        return AVERROR(ENOSYS);
+    }
+
+    return 0;
+}
+
+/* encode a frame, or flush the encoder when frame is NULL */
+static int enc_chunk_encode(EncChunks *cs, EncChunk *c, AVCodecContext *enc,
+                            const AVFrame *frame, AVPacket *pkt)
+{
+    int ret;
+
+    ret = avcodec_send_frame(enc, frame);
+    if (ret < 0 && !(ret == AVERROR_EOF && !frame))
+        return ret;
+
+    while (1) {
+        AVPacket *out;
+
+        ret = avcodec_receive_packet(enc, pkt);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+            return 0;
+        else if (ret < 0)
+            return ret;
+
+        pkt->time_base = enc->time_base;
+
+        out = av_packet_alloc();
+        if (!out)
+            return AVERROR(ENOMEM);
+        av_packet_move_ref(out, pkt);
+
+        pthread_mutex_lock(&cs->lock);
+        ret = av_fifo_write(c->packets, &out, 1);
+        pthread_cond_broadcast(&cs->cond);
+        pthread_mutex_unlock(&cs->lock);
+        if (ret < 0) {
+            av_packet_free(&out);
+            return ret;
+        }
+    }
+}
+
+static void *enc_chunk_thread(void *arg)
+{
+    EncChunkWorker    *w = arg;
+    EncChunks        *cs = w->cs;
+    OutputStream    *ost = cs->ost;
+    AVCodecContext  *enc = NULL;
+    AVFrame       *frame = av_frame_alloc();
+    AVPacket        *pkt = av_packet_alloc();
+    int64_t        chunk = w->index;
+    int ret = 0;
+
+    if (!frame || !pkt) {
+        ret = AVERROR(ENOMEM);
+        goto finish;
+    }
+
+    while (1) {
+        EncChunk *c = &cs->chunks[chunk % cs->nb_chunks];
+        int stream_idx, chunk_end;
+
+        ret = tq_receive(w->queue, &stream_idx, frame);
+        if (ret < 0) {
+            if (ret == AVERROR_EOF)
+                ret = 0;
+            break;
+        }
+
+        chunk_end = !frame->buf[0];
+        if (!chunk_end) {
+            if (!enc) {
+                ret = enc_chunk_open(cs, ost, &enc, frame);
+                if (ret < 0) {
+                    av_log(ost, AV_LOG_ERROR, "Error opening the encoder "
+                           "for chunk %"PRId64"\n", chunk);
+                    break;
+                }
+            }
+
+            ret = enc_chunk_encode(cs, c, enc, frame, pkt);
+            av_frame_unref(frame);
+        } else {
+            if (enc)
+                ret = enc_chunk_encode(cs, c, enc, NULL, pkt);
+            avcodec_free_context(&enc);
+
+            if (ret >= 0) {
+                pthread_mutex_lock(&cs->lock);
+                c->done = 1;
+                pthread_cond_broadcast(&cs->cond);
+                pthread_mutex_unlock(&cs->lock);
+            }
+        }
+        if (ret < 0) {
+            av_log(ost, AV_LOG_ERROR, "Error encoding chunk %"PRId64": %s\n",
+                   chunk, av_err2str(ret));
+            break;
+        }
+
+        if (chunk_end)
+            chunk += cs->nb_workers;
+    }
+
+finish:
+    if (ret < 0) {
+        pthread_mutex_lock(&cs->lock);
+        if (!cs->ret)
+            cs->ret = ret;
+        pthread_cond_broadcast(&cs->cond);
+        pthread_mutex_unlock(&cs->lock);
+    }
+
+    tq_receive_finish(w->queue, 0);
+
+    avcodec_free_context(&enc);
+    av_packet_free(&pkt);
+    av_frame_free(&frame);
+
+    return NULL;
+}
+
+static int enc_chunks_init(OutputStream *ost)
+{
+    AVCodecContext *enc_ctx = ost->enc_ctx;
+    EncChunks *cs;
+    int ret;
+
+    cs = av_mallocz(sizeof(*cs));
+    if (!cs)
+        return AVERROR(ENOMEM);
+    ost->enc->chunks = cs;
+
+    cs->ost      = ost;
+    cs->keep_sar = !!ost->frame_aspect_ratio.num;
+
+    ret = pthread_mutex_init(&cs->lock, NULL);
+    if (ret)
+        return AVERROR(ret);
+    ret = pthread_cond_init(&cs->cond, NULL);
+    if (ret) {
+        pthread_mutex_destroy(&cs->lock);
+        return AVERROR(ret);
+    }
+
+    cs->min_frames = FFMAX(av_rescale_q(ost->chunk_duration, AV_TIME_BASE_Q,
+                                        av_inv_q(ost->frame_rate)), 1);
+    cs->max_frames = 2 * cs->min_frames;
+
+    cs->frame = av_frame_alloc();
+    cs->base  = avcodec_alloc_context3(enc_ctx->codec);
+    if (!cs->frame || !cs->base)
+        return AVERROR(ENOMEM);
+
+    ret = enc_chunk_ctx_copy(cs->base, enc_ctx);
+    if (ret < 0)
+        return ret;
+    ret = av_dict_copy(&cs->opts, ost->encoder_opts, 0);
+    if (ret < 0)
+        return ret;
+
+    /* allow the chunks queued for a worker to be stitched in order while
+     * the other workers encode ahead */
+    cs->nb_chunks = 2 * ost->chunk_threads;
+    cs->chunks    = av_calloc(cs->nb_chunks, sizeof(*cs->chunks));
+    if (!cs->chunks)
+        return AVERROR(ENOMEM);
+    for (int i = 0; i < cs->nb_chunks; i++) {
+        cs->chunks[i].packets = av_fifo_alloc2(16, sizeof(AVPacket*),
+                                               AV_FIFO_FLAG_AUTO_GROW);
+        if (!cs->chunks[i].packets)
+            return AVERROR(ENOMEM);
+    }
+
+    cs->workers = av_calloc(ost->chunk_threads, sizeof(*cs->workers));
+    if (!cs->workers)
+        return AVERROR(ENOMEM);
+    cs->nb_workers = ost->chunk_threads;
+
+    for (int i = 0; i < cs->nb_workers; i++) {
+        EncChunkWorker *w = &cs->workers[i];
+        ObjPool *op;
+
+        w->cs    = cs;
+        w->index = i;
+
+        op = objpool_alloc_frames();
+        if (!op)
+            return AVERROR(ENOMEM);
+
+        /* room for a whole chunk plus its terminator, so that the frames
+         * can be handed off without waiting for the encoder */
+        w->queue = tq_alloc(1, cs->max_frames + 1, op, frame_move);
+        if (!w->queue) {
+            objpool_free(&op);
+            return AVERROR(ENOMEM);
+        }
+
+        ret = pthread_create(&w->thread, NULL, enc_chunk_thread, w);
+        if (ret)
+            return AVERROR(ret);
+        w->thread_started = 1;
+    }
+
+    av_log(ost, AV_LOG_VERBOSE, "Encoding in chunks of %"PRId64"-%"PRId64
+           " frames on %d threads\n", cs->min_frames, cs->max_frames,
+           cs->nb_workers);
+
+    return 0;
+}
+
 int enc_open(OutputStream *ost, AVFrame *frame)
 {
     InputStream *ist = ost->ist;
@@ -319,8 +719,10 @@ int enc_open(OutputStream *ost, AVFrame *frame)
     if (ost->bitexact)
         enc_ctx->flags |= AV_CODEC_FLAG_BITEXACT;
 
+    /* with chunked encoding the chunks already keep the cores busy */
     if (!av_dict_get(ost->encoder_opts, "threads", NULL, 0))
-        av_dict_set(&ost->encoder_opts, "threads", "auto", 0);
+        av_dict_set(&ost->encoder_opts, "threads",
+                    ost->chunk_threads > 1 ? "1" : "auto", 0);
 
     if (enc->capabilities & AV_CODEC_CAP_ENCODER_REORDERED_OPAQUE) {
         ret = av_dict_set(&ost->encoder_opts, "flags", "+copy_opaque", AV_DICT_MULTIKEY);
@@ -337,6 +739,18 @@ int enc_open(OutputStream *ost, AVFrame *frame)
         return ret;
     }
 
+    /* With chunked encoding, the main encoder below is still opened but never
+     * sent any frames: it provides the extradata and the codec parameters
+     * that the muxer and the chunk encoders are checked against. */
+    if (ost->chunk_threads > 1) {
+        ret = enc_chunks_init(ost);
+        if (ret < 0) {
+            av_log(ost, AV_LOG_ERROR, "Error setting up chunked encoding: %s\n",
+                   av_err2str(ret));
+            return ret;
+        }
+    }
+
     if ((ret = avcodec_open2(ost->enc_ctx, enc, &ost->encoder_opts)) < 0) {
         if (ret != AVERROR_EXPERIMENTAL)
             av_log(ost, AV_LOG_ERROR, "Error while opening encoder - maybe "
@@ -647,9 +1061,170 @@ static void update_video_stats(OutputStream *ost, const AVPacket *pkt, int write
     fprintf(vstats_file, "type= %c\n", av_get_picture_type_char(pict_type));
 }
 
-static int encode_frame(OutputFile *of, OutputStream *ost, AVFrame *frame)
+static void enc_packet_output(OutputFile *of, OutputStream *ost, AVPacket *pkt)
 {
     Encoder            *e = ost->enc;
+    AVCodecContext   *enc = ost->enc_ctx;
+    const char *type_desc = av_get_media_type_string(enc->codec_type);
+    int ret;
+
+    if (enc->codec_type == AVMEDIA_TYPE_VIDEO)
+        update_video_stats(ost, pkt, !!vstats_filename);
+    if (ost->enc_stats_post.io)
+        enc_stats_write(ost, &ost->enc_stats_post, NULL, pkt,
+                        e->packets_encoded);
+
+    if (debug_ts) {
+        av_log(ost, AV_LOG_INFO, "encoder -> type:%s "
+               "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s "
+               "duration:%s duration_time:%s\n",
+               type_desc,
+               av_ts2str(pkt->pts), av_ts2timestr(pkt->pts, &enc->time_base),
+               av_ts2str(pkt->dts), av_ts2timestr(pkt->dts, &enc->time_base),
+               av_ts2str(pkt->duration), av_ts2timestr(pkt->duration, &enc->time_base));
+    }
+
+    av_packet_rescale_ts(pkt, pkt->time_base, ost->mux_timebase);
+    pkt->time_base = ost->mux_timebase;
+
+    if (debug_ts) {
+        av_log(ost, AV_LOG_INFO, "encoder -> type:%s "
+               "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s "
+               "duration:%s duration_time:%s\n",
+               type_desc,
+               av_ts2str(pkt->pts), av_ts2timestr(pkt->pts, &enc->time_base),
+               av_ts2str(pkt->dts), av_ts2timestr(pkt->dts, &enc->time_base),
+               av_ts2str(pkt->duration), av_ts2timestr(pkt->duration, &enc->time_base));
+    }
+
+    if ((ret = trigger_fix_sub_duration_heartbeat(ost, pkt)) < 0) {
+        av_log(NULL, AV_LOG_ERROR,
+               "Subtitle heartbeat logic failed in %s! (%s)\n",
+               __func__, av_err2str(ret));
+        exit_program(1);
+    }
+
+    e->data_size += pkt->size;
+
+    e->packets_encoded++;
+
+    of_output_packet(of, pkt, ost, 0);
+}
+
+/**
+ * Output the packets of finished chunks in order, waiting for the encoders
+ * until all the chunks before wait_until have been output.
+ */
+static int enc_chunks_output(OutputFile *of, OutputStream *ost, int64_t wait_until)
+{
+    EncChunks *cs = ost->enc->chunks;
+
+    /* packets of the chunk still receiving frames can be output as well */
+    while (cs->chunk_out < cs->chunk_in + !!cs->chunk_frames) {
+        EncChunk *c = &cs->chunks[cs->chunk_out % cs->nb_chunks];
+        int block = cs->chunk_out < wait_until;
+        AVPacket *pkt = NULL;
+        int done, ret;
+
+        pthread_mutex_lock(&cs->lock);
+        while (block && !cs->ret && !c->done && !av_fifo_can_read(c->packets))
+            pthread_cond_wait(&cs->cond, &cs->lock);
+        av_fifo_read(c->packets, &pkt, 1);
+        done = c->done;
+        ret  = cs->ret;
+        if (!pkt && done)
+            c->done = 0;
+        pthread_mutex_unlock(&cs->lock);
+
+        if (ret < 0) {
+            av_packet_free(&pkt);
+            return ret;
+        }
+
+        if (pkt) {
+            enc_packet_output(of, ost, pkt);
+            av_packet_free(&pkt);
+        } else if (done) {
+            cs->chunk_out++;
+        } else
+            break;
+    }
+
+    return 0;
+}
+
+static int enc_chunks_end(OutputStream *ost)
+{
+    EncChunks *cs = ost->enc->chunks;
+    int ret;
+
+    /* an empty frame makes the worker flush the chunk encoder */
+    av_frame_unref(cs->frame);
+    ret = tq_send(cs->workers[cs->chunk_in % cs->nb_workers].queue, 0, cs->frame);
+    if (ret < 0)
+        return cs->ret < 0 ? cs->ret : ret;
+
+    cs->chunk_in++;
+    cs->chunk_frames = 0;
+
+    return 0;
+}
+
+static int enc_chunks_send(OutputFile *of, OutputStream *ost, AVFrame *frame)
+{
+    EncChunks *cs = ost->enc->chunks;
+    int ret;
+
+    if (!frame) {
+        if (cs->chunk_frames) {
+            ret = enc_chunks_end(ost);
+            if (ret < 0)
+                return ret;
+        }
+
+        for (int i = 0; i < cs->nb_workers; i++)
+            tq_send_finish(cs->workers[i].queue, 0);
+
+        ret = enc_chunks_output(of, ost, cs->chunk_in);
+        if (ret < 0)
+            return ret;
+
+        of_output_packet(of, ost->pkt, ost, 1);
+        return AVERROR_EOF;
+    }
+
+    /* new chunks start at a keyframe of the source or a forced keyframe */
+    if (cs->chunk_frames >= cs->max_frames ||
+        (cs->chunk_frames >= cs->min_frames &&
+         (frame->key_frame || frame->pict_type == AV_PICTURE_TYPE_I))) {
+        ret = enc_chunks_end(ost);
+        if (ret < 0)
+            return ret;
+    }
+
+    /* wait until the ring slot of the new chunk is free */
+    if (!cs->chunk_frames) {
+        ret = enc_chunks_output(of, ost, cs->chunk_in - cs->nb_chunks + 1);
+        if (ret < 0)
+            return ret;
+    }
+
+    ret = av_frame_ref(cs->frame, frame);
+    if (ret < 0)
+        return ret;
+
+    ret = tq_send(cs->workers[cs->chunk_in % cs->nb_workers].queue, 0, cs->frame);
+    if (ret < 0) {
+        av_frame_unref(cs->frame);
+        return cs->ret < 0 ? cs->ret : ret;
+    }
+    cs->chunk_frames++;
+
+    return enc_chunks_output(of, ost, 0);
+}
+
+static int encode_frame(OutputFile *of, OutputStream *ost, AVFrame *frame)
+{
     AVCodecContext   *enc = ost->enc_ctx;
     AVPacket         *pkt = ost->pkt;
     const char *type_desc = av_get_media_type_string(enc->codec_type);
@@ -676,6 +1251,13 @@ static int encode_frame(OutputFile *of, OutputStream *ost, AVFrame *frame)
             enc->sample_aspect_ratio = frame->sample_aspect_ratio;
     }
 
+    if (ost->enc->chunks) {
+        ret = enc_chunks_send(of, ost, frame);
+        if (ret < 0 && ret != AVERROR_EOF)
+            av_log(ost, AV_LOG_ERROR, "Chunked %s encoding failed\n", type_desc);
+        return ret;
+    }
+
     update_benchmark(NULL);
 
     ret = avcodec_send_frame(enc, frame);
@@ -707,47 +1289,7 @@ static int encode_frame(OutputFile *of, OutputStream *ost, AVFrame *frame)
             return ret;
         }
 
-        if (enc->codec_type == AVMEDIA_TYPE_VIDEO)
-            update_video_stats(ost, pkt, !!vstats_filename);
-        if (ost->enc_stats_post.io)
-            enc_stats_write(ost, &ost->enc_stats_post, NULL, pkt,
-                            e->packets_encoded);
-
-        if (debug_ts) {
-            av_log(ost, AV_LOG_INFO, "encoder -> type:%s "
-                   "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s "
-                   "duration:%s duration_time:%s\n",
-                   type_desc,
-                   av_ts2str(pkt->pts), av_ts2timestr(pkt->pts, &enc->time_base),
-                   av_ts2str(pkt->dts), av_ts2timestr(pkt->dts, &enc->time_base),
-                   av_ts2str(pkt->duration), av_ts2timestr(pkt->duration, &enc->time_base));
-        }
-
-        av_packet_rescale_ts(pkt, pkt->time_base, ost->mux_timebase);
-        pkt->time_base = ost->mux_timebase;
-
-        if (debug_ts) {
-            av_log(ost, AV_LOG_INFO, "encoder -> type:%s "
-                   "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s "
-                   "duration:%s duration_time:%s\n",
-                   type_desc,
-                   av_ts2str(pkt->pts), av_ts2timestr(pkt->pts, &enc->time_base),
-                   av_ts2str(pkt->dts), av_ts2timestr(pkt->dts, &enc->time_base),
-                   av_ts2str(pkt->duration), av_ts2timestr(pkt->duration, &enc->time_base));
-        }
-
-        if ((ret = trigger_fix_sub_duration_heartbeat(ost, pkt)) < 0) {
-            av_log(NULL, AV_LOG_ERROR,
-                   "Subtitle heartbeat logic failed in %s! (%s)\n",
-                   __func__, av_err2str(ret));
-            exit_program(1);
-        }
-
-        e->data_size += pkt->size;
-
-        e->packets_encoded++;
-
-        of_output_packet(of, pkt, ost, 0);
+        enc_packet_output(of, ost, pkt);
     }
 
     av_assert0(0);
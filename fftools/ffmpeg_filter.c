@@ -1254,6 +1254,12 @@ int configure_filtergraph(FilterGraph *fg)
         fg->graph->nb_threads = filter_complex_nbthreads;
     }
 
+    if (filter_pool_flags) {
+        ret = av_opt_set(fg->graph, "frame_pool_flags", filter_pool_flags, 0);
+        if (ret < 0)
+            goto fail;
+    }
+
     hw_device = hw_device_for_filter();
 
     if ((ret = graph_parse(fg->graph, graph_desc, &inputs, &outputs, hw_device)) < 0)
@@ -72,6 +72,8 @@ static const char *const opt_name_frame_aspect_ratios[]       = {"aspect", NULL}
 static const char *const opt_name_intra_matrices[]            = {"intra_matrix", NULL};
 static const char *const opt_name_inter_matrices[]            = {"inter_matrix", NULL};
 static const char *const opt_name_chroma_intra_matrices[]     = {"chroma_intra_matrix", NULL};
+static const char *const opt_name_chunk_durations[]           = {"chunk_duration", NULL};
+static const char *const opt_name_chunk_threads[]             = {"chunk_threads", NULL};
 static const char *const opt_name_max_frame_rates[]           = {"fpsmax", NULL};
 static const char *const opt_name_max_frames[]                = {"frames", "aframes", "vframes", "dframes", NULL};
 static const char *const opt_name_max_muxing_queue_size[]     = {"max_muxing_queue_size", NULL};
@@ -676,6 +678,25 @@ static void new_stream_video(Muxer *mux, const OptionsContext *o,
             }
         }
 
+        MATCH_PER_STREAM_OPT(chunk_threads, i, ost->chunk_threads, oc, st);
+        if (ost->chunk_threads > 1) {
+            double chunk_duration = 2.0;
+
+            if (do_pass) {
+                av_log(ost, AV_LOG_FATAL, "Chunked encoding cannot be combined "
+                       "with two-pass encoding.\n");
+                exit_program(1);
+            }
+
+            MATCH_PER_STREAM_OPT(chunk_durations, dbl, chunk_duration, oc, st);
+            if (!(chunk_duration > 0.0)) {
+                av_log(ost, AV_LOG_FATAL, "Invalid chunk duration: %g\n",
+                       chunk_duration);
+                exit_program(1);
+            }
+            ost->chunk_duration = llrint(chunk_duration * AV_TIME_BASE);
+        }
+
         MATCH_PER_STREAM_OPT(force_fps, i, ost->force_fps, oc, st);
 
         ost->top_field_first = -1;
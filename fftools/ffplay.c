@@ -1283,6 +1283,7 @@ static void do_exit(VideoState *is)
         printf("\n");
     SDL_Quit();
     av_log(NULL, AV_LOG_QUIET, "%s", "");
+    av_log_flush();
     exit(0);
 }
 
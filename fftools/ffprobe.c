@@ -28,6 +28,9 @@
 
 #include <string.h>
 #include <math.h>
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 
 #include "libavformat/avformat.h"
 #include "libavformat/version.h"
@@ -38,12 +41,14 @@
 #include "libavutil/avstring.h"
 #include "libavutil/bprint.h"
 #include "libavutil/channel_layout.h"
+#include "libavutil/cpu.h"
 #include "libavutil/display.h"
 #include "libavutil/hash.h"
 #include "libavutil/hdr_dynamic_metadata.h"
 #include "libavutil/mastering_display_metadata.h"
 #include "libavutil/hdr_dynamic_vivid_metadata.h"
 #include "libavutil/dovi_meta.h"
+#include "libavutil/fifo.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/spherical.h"
@@ -156,6 +161,9 @@ static ReadInterval *read_intervals;
 static int read_intervals_nb = 0;
 
 static int find_stream_info  = 1;
+#if HAVE_THREADS
+static int read_threads      = 1;
+#endif
 
 /* section structure definition */
 
@@ -486,10 +494,8 @@ struct WriterContext {
     const AVClass *class;           ///< class of the writer
     const Writer *writer;           ///< the Writer of which this is an instance
     AVIOContext *avio;              ///< the I/O context used to write
-
-    void (* writer_w8)(WriterContext *wctx, int b);
-    void (* writer_put_str)(WriterContext *wctx, const char *str);
-    void (* writer_printf)(WriterContext *wctx, const char *fmt, ...);
+    AVBPrint outbuf;                ///< output not yet written to avio or stdout
+    int flush;                      ///< write out the output after each section
 
     char *name;                     ///< name of this writer instance
     void *priv;                     ///< private data for use by the filter
@@ -534,6 +540,8 @@ static const AVOption writer_options[] = {
     { "fail",    NULL, 0, AV_OPT_TYPE_CONST, {.i64 = WRITER_STRING_VALIDATION_FAIL},    .unit = "sv" },
     { "string_validation_replacement", "set string validation replacement string", OFFSET(string_validation_replacement), AV_OPT_TYPE_STRING, {.str=""}},
     { "svr", "set string validation replacement string", OFFSET(string_validation_replacement), AV_OPT_TYPE_STRING, {.str="\xEF\xBF\xBD"}},
+    { "flush", "write out the output after each packet, frame or stream, -1 for only when printing to a terminal",
+      OFFSET(flush), AV_OPT_TYPE_BOOL, {.i64=-1}, -1, 1 },
     { NULL }
 };
 
@@ -553,6 +561,20 @@ static const AVClass writer_class = {
     .child_next = writer_child_next,
 };
 
+static void writer_flush(WriterContext *wctx)
+{
+    AVBPrint *buf = &wctx->outbuf;
+    unsigned len = FFMIN(buf->len, buf->size - 1);
+
+    if (!len)
+        return;
+    if (wctx->avio)
+        avio_write(wctx->avio, buf->str, len);
+    else
+        fwrite(buf->str, 1, len, stdout);
+    av_bprint_clear(buf);
+}
+
 static int writer_close(WriterContext **wctx)
 {
     int i;
@@ -563,6 +585,8 @@ static int writer_close(WriterContext **wctx)
 
     if ((*wctx)->writer->uninit)
         (*wctx)->writer->uninit(*wctx);
+    writer_flush(*wctx);
+    av_bprint_finalize(&(*wctx)->outbuf, NULL);
     for (i = 0; i < SECTION_MAX_NB_LEVELS; i++)
         av_bprint_finalize(&(*wctx)->section_pbuf[i], NULL);
     if ((*wctx)->writer->priv_class)
@@ -572,6 +596,8 @@ static int writer_close(WriterContext **wctx)
     if ((*wctx)->avio) {
         avio_flush((*wctx)->avio);
         ret = avio_close((*wctx)->avio);
+    } else {
+        fflush(stdout);
     }
     av_freep(wctx);
     return ret;
@@ -585,42 +611,65 @@ static void bprint_bytes(AVBPrint *bp, const uint8_t *ubuf, size_t ubuf_size)
         av_bprintf(bp, "%02X", ubuf[i]);
 }
 
-static inline void writer_w8_avio(WriterContext *wctx, int b)
+/* Output is collected in outbuf and written out in large blocks. */
+#define WRITER_BUF_SIZE (1 << 16)
+
+static inline void writer_check_flush(WriterContext *wctx)
 {
-    avio_w8(wctx->avio, b);
+    if (wctx->outbuf.len >= WRITER_BUF_SIZE)
+        writer_flush(wctx);
 }
 
-static inline void writer_put_str_avio(WriterContext *wctx, const char *str)
+/**
+ * Hand the output of a completed packet, frame or stream section over,
+ * if requested.
+ */
+static void writer_flush_section(WriterContext *wctx)
 {
-    avio_write(wctx->avio, str, strlen(str));
+    if (!wctx->flush)
+        return;
+    writer_flush(wctx);
+    if (wctx->avio)
+        avio_flush(wctx->avio);
+    else
+        fflush(stdout);
 }
 
-static inline void writer_printf_avio(WriterContext *wctx, const char *fmt, ...)
+static inline void writer_w8(WriterContext *wctx, int b)
 {
-    va_list ap;
-
-    va_start(ap, fmt);
-    avio_vprintf(wctx->avio, fmt, ap);
-    va_end(ap);
+    av_bprint_chars(&wctx->outbuf, b, 1);
+    writer_check_flush(wctx);
 }
 
-static inline void writer_w8_printf(WriterContext *wctx, int b)
+static inline void writer_put_str(WriterContext *wctx, const char *str)
 {
-    printf("%c", b);
+    av_bprint_append_data(&wctx->outbuf, str, strlen(str));
+    writer_check_flush(wctx);
 }
 
-static inline void writer_put_str_printf(WriterContext *wctx, const char *str)
+static void writer_put_int(WriterContext *wctx, long long int value)
 {
-    printf("%s", str);
+    char buf[24], *p = buf + sizeof(buf);
+    unsigned long long int v = value < 0 ? -(unsigned long long int)value : value;
+
+    do {
+        *--p = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    if (value < 0)
+        *--p = '-';
+    av_bprint_append_data(&wctx->outbuf, p, buf + sizeof(buf) - p);
+    writer_check_flush(wctx);
 }
 
-static inline void writer_printf_printf(WriterContext *wctx, const char *fmt, ...)
+static void writer_printf(WriterContext *wctx, const char *fmt, ...)
 {
     va_list ap;
 
     va_start(ap, fmt);
-    vprintf(fmt, ap);
+    av_vbprintf(&wctx->outbuf, fmt, ap);
     va_end(ap);
+    writer_check_flush(wctx);
 }
 
 static int writer_open(WriterContext **wctx, const Writer *writer, const char *args,
@@ -643,6 +692,7 @@ static int writer_open(WriterContext **wctx, const Writer *writer, const char *a
     (*wctx)->level = -1;
     (*wctx)->sections = sections;
     (*wctx)->nb_sections = nb_sections;
+    av_bprint_init(&(*wctx)->outbuf, 0, AV_BPRINT_SIZE_UNLIMITED);
 
     av_opt_set_defaults(*wctx);
 
@@ -695,19 +745,19 @@ static int writer_open(WriterContext **wctx, const Writer *writer, const char *a
         }
     }
 
-    if (!output_filename) {
-        (*wctx)->writer_w8 = writer_w8_printf;
-        (*wctx)->writer_put_str = writer_put_str_printf;
-        (*wctx)->writer_printf = writer_printf_printf;
-    } else {
+    if (output_filename) {
         if ((ret = avio_open(&(*wctx)->avio, output, AVIO_FLAG_WRITE)) < 0) {
             av_log(*wctx, AV_LOG_ERROR,
                    "Failed to open output '%s' with error: %s\n", output, av_err2str(ret));
             goto fail;
         }
-        (*wctx)->writer_w8 = writer_w8_avio;
-        (*wctx)->writer_put_str = writer_put_str_avio;
-        (*wctx)->writer_printf = writer_printf_avio;
+    }
+    if ((*wctx)->flush < 0) {
+#if HAVE_ISATTY
+        (*wctx)->flush = !output_filename && isatty(1);
+#else
+        (*wctx)->flush = 0;
+#endif
     }
 
     for (i = 0; i < SECTION_MAX_NB_LEVELS; i++)
@@ -977,10 +1027,6 @@ static void writer_print_integers(WriterContext *wctx, const char *name,
     av_bprint_finalize(&bp, NULL);
 }
 
-#define writer_w8(wctx_, b_) (wctx_)->writer_w8(wctx_, b_)
-#define writer_put_str(wctx_, str_) (wctx_)->writer_put_str(wctx_, str_)
-#define writer_printf(wctx_, fmt_, ...) (wctx_)->writer_printf(wctx_, fmt_, __VA_ARGS__)
-
 #define MAX_REGISTERED_WRITERS_NB 64
 
 static const Writer *registered_writers[MAX_REGISTERED_WRITERS_NB + 1];
@@ -1091,22 +1137,29 @@ static void default_print_section_footer(WriterContext *wctx)
         writer_printf(wctx, "[/%s]\n", upcase_string(buf, sizeof(buf), section->name));
 }
 
-static void default_print_str(WriterContext *wctx, const char *key, const char *value)
+static void default_print_key(WriterContext *wctx, const char *key)
 {
     DefaultContext *def = wctx->priv;
 
-    if (!def->nokey)
-        writer_printf(wctx, "%s%s=", wctx->section_pbuf[wctx->level].str, key);
-    writer_printf(wctx, "%s\n", value);
+    if (!def->nokey) {
+        writer_put_str(wctx, wctx->section_pbuf[wctx->level].str);
+        writer_put_str(wctx, key);
+        writer_w8(wctx, '=');
+    }
 }
 
-static void default_print_int(WriterContext *wctx, const char *key, long long int value)
+static void default_print_str(WriterContext *wctx, const char *key, const char *value)
 {
-    DefaultContext *def = wctx->priv;
+    default_print_key(wctx, key);
+    writer_put_str(wctx, value);
+    writer_w8(wctx, '\n');
+}
 
-    if (!def->nokey)
-        writer_printf(wctx, "%s%s=", wctx->section_pbuf[wctx->level].str, key);
-    writer_printf(wctx, "%lld\n", value);
+static void default_print_int(WriterContext *wctx, const char *key, long long int value)
+{
+    default_print_key(wctx, key);
+    writer_put_int(wctx, value);
+    writer_w8(wctx, '\n');
 }
 
 static const Writer default_writer = {
@@ -1127,20 +1180,28 @@ static const Writer default_writer = {
  */
 static const char *c_escape_str(AVBPrint *dst, const char *src, const char sep, void *log_ctx)
 {
-    const char *p;
+    const char *p = src;
+
+    while (*p) {
+        /* copy the characters which need no escaping in one go */
+        const char *run = p;
+        while (*p && *p != sep && *p != '\\' && (*p >= 32 || !strchr("\b\f\n\r", *p)))
+            p++;
+        av_bprint_append_data(dst, run, p - run);
+        if (!*p)
+            break;
 
-    for (p = src; *p; p++) {
         switch (*p) {
-        case '\b': av_bprintf(dst, "%s", "\\b");  break;
-        case '\f': av_bprintf(dst, "%s", "\\f");  break;
-        case '\n': av_bprintf(dst, "%s", "\\n");  break;
-        case '\r': av_bprintf(dst, "%s", "\\r");  break;
-        case '\\': av_bprintf(dst, "%s", "\\\\"); break;
+        case '\b': av_bprint_append_data(dst, "\\b",  2); break;
+        case '\f': av_bprint_append_data(dst, "\\f",  2); break;
+        case '\n': av_bprint_append_data(dst, "\\n",  2); break;
+        case '\r': av_bprint_append_data(dst, "\\r",  2); break;
+        case '\\': av_bprint_append_data(dst, "\\\\", 2); break;
         default:
-            if (*p == sep)
-                av_bprint_chars(dst, '\\', 1);
+            av_bprint_chars(dst, '\\', 1);
             av_bprint_chars(dst, *p, 1);
         }
+        p++;
     }
     return dst->str;
 }
@@ -1153,16 +1214,23 @@ static const char *csv_escape_str(AVBPrint *dst, const char *src, const char sep
     char meta_chars[] = { sep, '"', '\n', '\r', '\0' };
     int needs_quoting = !!src[strcspn(src, meta_chars)];
 
-    if (needs_quoting)
-        av_bprint_chars(dst, '"', 1);
+    if (!needs_quoting) {
+        av_bprint_append_data(dst, src, strlen(src));
+        return dst->str;
+    }
 
-    for (; *src; src++) {
-        if (*src == '"')
-            av_bprint_chars(dst, '"', 1);
-        av_bprint_chars(dst, *src, 1);
+    av_bprint_chars(dst, '"', 1);
+    while (*src) {
+        /* double the quotes, copying everything in between as is */
+        size_t len = strcspn(src, "\"");
+        av_bprint_append_data(dst, src, len);
+        src += len;
+        if (*src) {
+            av_bprint_append_data(dst, "\"\"", 2);
+            src++;
+        }
     }
-    if (needs_quoting)
-        av_bprint_chars(dst, '"', 1);
+    av_bprint_chars(dst, '"', 1);
     return dst->str;
 }
 
@@ -1271,8 +1339,11 @@ static void compact_print_str(WriterContext *wctx, const char *key, const char *
     AVBPrint buf;
 
     if (wctx->nb_item[wctx->level]) writer_w8(wctx, compact->item_sep);
-    if (!compact->nokey)
-        writer_printf(wctx, "%s%s=", wctx->section_pbuf[wctx->level].str, key);
+    if (!compact->nokey) {
+        writer_put_str(wctx, wctx->section_pbuf[wctx->level].str);
+        writer_put_str(wctx, key);
+        writer_w8(wctx, '=');
+    }
     av_bprint_init(&buf, 1, AV_BPRINT_SIZE_UNLIMITED);
     writer_put_str(wctx, compact->escape_str(&buf, value, compact->item_sep, wctx));
     av_bprint_finalize(&buf, NULL);
@@ -1283,9 +1354,12 @@ static void compact_print_int(WriterContext *wctx, const char *key, long long in
     CompactContext *compact = wctx->priv;
 
     if (wctx->nb_item[wctx->level]) writer_w8(wctx, compact->item_sep);
-    if (!compact->nokey)
-        writer_printf(wctx, "%s%s=", wctx->section_pbuf[wctx->level].str, key);
-    writer_printf(wctx, "%lld", value);
+    if (!compact->nokey) {
+        writer_put_str(wctx, wctx->section_pbuf[wctx->level].str);
+        writer_put_str(wctx, key);
+        writer_w8(wctx, '=');
+    }
+    writer_put_int(wctx, value);
 }
 
 static const Writer compact_writer = {
@@ -1428,7 +1502,11 @@ static void flat_print_section_header(WriterContext *wctx)
 
 static void flat_print_int(WriterContext *wctx, const char *key, long long int value)
 {
-    writer_printf(wctx, "%s%s=%lld\n", wctx->section_pbuf[wctx->level].str, key, value);
+    writer_put_str(wctx, wctx->section_pbuf[wctx->level].str);
+    writer_put_str(wctx, key);
+    writer_w8(wctx, '=');
+    writer_put_int(wctx, value);
+    writer_w8(wctx, '\n');
 }
 
 static void flat_print_str(WriterContext *wctx, const char *key, const char *value)
@@ -1546,7 +1624,10 @@ static void ini_print_str(WriterContext *wctx, const char *key, const char *valu
 
 static void ini_print_int(WriterContext *wctx, const char *key, long long int value)
 {
-    writer_printf(wctx, "%s=%lld\n", key, value);
+    writer_put_str(wctx, key);
+    writer_w8(wctx, '=');
+    writer_put_int(wctx, value);
+    writer_w8(wctx, '\n');
 }
 
 static const Writer ini_writer = {
@@ -1565,6 +1646,7 @@ typedef struct JSONContext {
     const AVClass *class;
     int indent_level;
     int compact;
+    int ndjson;
     const char *item_sep, *item_start_end;
 } JSONContext;
 
@@ -1574,6 +1656,8 @@ typedef struct JSONContext {
 static const AVOption json_options[]= {
     { "compact", "enable compact output", OFFSET(compact), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1 },
     { "c",       "enable compact output", OFFSET(compact), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1 },
+    { "ndjson",  "print one JSON object per line for each top-level element", OFFSET(ndjson), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1 },
+    { "nd",      "print one JSON object per line for each top-level element", OFFSET(ndjson), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1 },
     { NULL }
 };
 
@@ -1583,70 +1667,131 @@ static av_cold int json_init(WriterContext *wctx)
 {
     JSONContext *json = wctx->priv;
 
+    if (json->ndjson)
+        json->compact = 1;
     json->item_sep       = json->compact ? ", " : ",\n";
     json->item_start_end = json->compact ? " "  : "\n";
 
     return 0;
 }
 
+static inline int json_needs_escape(unsigned char c)
+{
+    return c < 32 || c == '"' || c == '\\';
+}
+
 static const char *json_escape_str(AVBPrint *dst, const char *src, void *log_ctx)
 {
     static const char json_escape[] = {'"', '\\', '\b', '\f', '\n', '\r', '\t', 0};
     static const char json_subst[]  = {'"', '\\',  'b',  'f',  'n',  'r',  't', 0};
-    const char *p;
+    const char *p = src;
 
-    for (p = src; *p; p++) {
-        char *s = strchr(json_escape, *p);
-        if (s) {
-            av_bprint_chars(dst, '\\', 1);
-            av_bprint_chars(dst, json_subst[s - json_escape], 1);
-        } else if ((unsigned char)*p < 32) {
-            av_bprintf(dst, "\\u00%02x", *p & 0xff);
-        } else {
-            av_bprint_chars(dst, *p, 1);
+    while (*p) {
+        /* copy the characters which need no escaping in one go */
+        const char *run = p;
+        while (!json_needs_escape(*p))
+            p++;
+        av_bprint_append_data(dst, run, p - run);
+        if (!*p)
+            break;
+
+        {
+            char *s = strchr(json_escape, *p);
+            if (s) {
+                char esc[2] = { '\\', json_subst[s - json_escape] };
+                av_bprint_append_data(dst, esc, 2);
+            } else {
+                av_bprintf(dst, "\\u00%02x", *p & 0xff);
+            }
         }
+        p++;
     }
     return dst->str;
 }
 
-#define JSON_INDENT() writer_printf(wctx, "%*c", json->indent_level * 4, ' ')
+/**
+ * Print a quoted and escaped string, escaping straight into the output.
+ */
+static void json_print_quoted(WriterContext *wctx, const char *str)
+{
+    writer_w8(wctx, '"');
+    json_escape_str(&wctx->outbuf, str, wctx);
+    writer_w8(wctx, '"');
+}
+
+static void json_indent(WriterContext *wctx)
+{
+    JSONContext *json = wctx->priv;
+
+    if (!json->ndjson)
+        av_bprint_chars(&wctx->outbuf, ' ', FFMAX(json->indent_level * 4, 1));
+}
+
+/**
+ * In NDJSON mode, the root section and the arrays it contains are not
+ * printed, each of their elements being printed on its own line instead.
+ */
+static int json_is_ndjson_hidden(WriterContext *wctx, int level)
+{
+    return level == 0 ||
+           (level == 1 && (wctx->section[1]->flags & SECTION_FLAG_IS_ARRAY));
+}
+
+static int json_is_ndjson_record(WriterContext *wctx)
+{
+    JSONContext *json = wctx->priv;
+
+    return json->ndjson && wctx->level &&
+           json_is_ndjson_hidden(wctx, wctx->level - 1) &&
+           !json_is_ndjson_hidden(wctx, wctx->level);
+}
 
 static void json_print_section_header(WriterContext *wctx)
 {
     JSONContext *json = wctx->priv;
-    AVBPrint buf;
     const struct section *section = wctx->section[wctx->level];
     const struct section *parent_section = wctx->level ?
         wctx->section[wctx->level-1] : NULL;
 
+    if (json->ndjson && json_is_ndjson_hidden(wctx, wctx->level))
+        return;
+    if (json_is_ndjson_record(wctx)) {
+        writer_put_str(wctx, "{ \"type\": ");
+        json_print_quoted(wctx, section->name);
+        wctx->nb_item[wctx->level]++;
+        return;
+    }
+
     if (wctx->level && wctx->nb_item[wctx->level-1])
-        writer_put_str(wctx, ",\n");
+        writer_put_str(wctx, json->ndjson ? ", " : ",\n");
 
     if (section->flags & SECTION_FLAG_IS_WRAPPER) {
         writer_put_str(wctx, "{\n");
         json->indent_level++;
     } else {
-        av_bprint_init(&buf, 1, AV_BPRINT_SIZE_UNLIMITED);
-        json_escape_str(&buf, section->name, wctx);
-        JSON_INDENT();
+        json_indent(wctx);
 
         json->indent_level++;
         if (section->flags & SECTION_FLAG_IS_ARRAY) {
-            writer_printf(wctx, "\"%s\": [\n", buf.str);
+            json_print_quoted(wctx, section->name);
+            writer_put_str(wctx, json->ndjson ? ": [" : ": [\n");
         } else if (parent_section && !(parent_section->flags & SECTION_FLAG_IS_ARRAY)) {
-            writer_printf(wctx, "\"%s\": {%s", buf.str, json->item_start_end);
+            json_print_quoted(wctx, section->name);
+            writer_put_str(wctx, ": {");
+            writer_put_str(wctx, json->item_start_end);
         } else {
-            writer_printf(wctx, "{%s", json->item_start_end);
+            writer_w8(wctx, '{');
+            writer_put_str(wctx, json->item_start_end);
 
             /* this is required so the parser can distinguish between packets and frames */
             if (parent_section && parent_section->id == SECTION_ID_PACKETS_AND_FRAMES) {
                 if (!json->compact)
-                    JSON_INDENT();
-                writer_printf(wctx, "\"type\": \"%s\"", section->name);
+                    json_indent(wctx);
+                writer_put_str(wctx, "\"type\": ");
+                json_print_quoted(wctx, section->name);
                 wctx->nb_item[wctx->level]++;
             }
         }
-        av_bprint_finalize(&buf, NULL);
     }
 }
 
@@ -1655,36 +1800,32 @@ static void json_print_section_footer(WriterContext *wctx)
     JSONContext *json = wctx->priv;
     const struct section *section = wctx->section[wctx->level];
 
+    if (json->ndjson && json_is_ndjson_hidden(wctx, wctx->level))
+        return;
+    if (json_is_ndjson_record(wctx)) {
+        writer_put_str(wctx, " }\n");
+        return;
+    }
+
     if (wctx->level == 0) {
         json->indent_level--;
         writer_put_str(wctx, "\n}\n");
     } else if (section->flags & SECTION_FLAG_IS_ARRAY) {
-        writer_w8(wctx, '\n');
+        if (!json->ndjson)
+            writer_w8(wctx, '\n');
         json->indent_level--;
-        JSON_INDENT();
+        json_indent(wctx);
         writer_w8(wctx, ']');
     } else {
         writer_put_str(wctx, json->item_start_end);
         json->indent_level--;
         if (!json->compact)
-            JSON_INDENT();
+            json_indent(wctx);
         writer_w8(wctx, '}');
     }
 }
 
-static inline void json_print_item_str(WriterContext *wctx,
-                                       const char *key, const char *value)
-{
-    AVBPrint buf;
-
-    av_bprint_init(&buf, 1, AV_BPRINT_SIZE_UNLIMITED);
-    writer_printf(wctx, "\"%s\":", json_escape_str(&buf, key,   wctx));
-    av_bprint_clear(&buf);
-    writer_printf(wctx, " \"%s\"", json_escape_str(&buf, value, wctx));
-    av_bprint_finalize(&buf, NULL);
-}
-
-static void json_print_str(WriterContext *wctx, const char *key, const char *value)
+static void json_print_item_key(WriterContext *wctx, const char *key)
 {
     JSONContext *json = wctx->priv;
     const struct section *parent_section = wctx->level ?
@@ -1693,25 +1834,21 @@ static void json_print_str(WriterContext *wctx, const char *key, const char *val
     if (wctx->nb_item[wctx->level] || (parent_section && parent_section->id == SECTION_ID_PACKETS_AND_FRAMES))
         writer_put_str(wctx, json->item_sep);
     if (!json->compact)
-        JSON_INDENT();
-    json_print_item_str(wctx, key, value);
+        json_indent(wctx);
+    json_print_quoted(wctx, key);
+    writer_put_str(wctx, ": ");
 }
 
-static void json_print_int(WriterContext *wctx, const char *key, long long int value)
+static void json_print_str(WriterContext *wctx, const char *key, const char *value)
 {
-    JSONContext *json = wctx->priv;
-    const struct section *parent_section = wctx->level ?
-        wctx->section[wctx->level-1] : NULL;
-    AVBPrint buf;
-
-    if (wctx->nb_item[wctx->level] || (parent_section && parent_section->id == SECTION_ID_PACKETS_AND_FRAMES))
-        writer_put_str(wctx, json->item_sep);
-    if (!json->compact)
-        JSON_INDENT();
+    json_print_item_key(wctx, key);
+    json_print_quoted(wctx, value);
+}
 
-    av_bprint_init(&buf, 1, AV_BPRINT_SIZE_UNLIMITED);
-    writer_printf(wctx, "\"%s\": %lld", json_escape_str(&buf, key, wctx), value);
-    av_bprint_finalize(&buf, NULL);
+static void json_print_int(WriterContext *wctx, const char *key, long long int value)
+{
+    json_print_item_key(wctx, key);
+    writer_put_int(wctx, value);
 }
 
 static const Writer json_writer = {
@@ -1866,7 +2003,10 @@ static void xml_print_int(WriterContext *wctx, const char *key, long long int va
 {
     if (wctx->nb_item[wctx->level])
         writer_w8(wctx, ' ');
-    writer_printf(wctx, "%s=\"%lld\"", key, value);
+    writer_put_str(wctx, key);
+    writer_put_str(wctx, "=\"");
+    writer_put_int(wctx, value);
+    writer_w8(wctx, '"');
 }
 
 static Writer xml_writer = {
@@ -2551,7 +2691,7 @@ static void show_packet(WriterContext *w, InputFile *ifile, AVPacket *pkt, int p
     writer_print_section_footer(w);
 
     av_bprint_finalize(&pbuf, NULL);
-    fflush(stdout);
+    writer_flush_section(w);
 }
 
 static void show_subtitle(WriterContext *w, AVSubtitle *sub, AVStream *stream,
@@ -2574,7 +2714,7 @@ static void show_subtitle(WriterContext *w, AVSubtitle *sub, AVStream *stream,
     writer_print_section_footer(w);
 
     av_bprint_finalize(&pbuf, NULL);
-    fflush(stdout);
+    writer_flush_section(w);
 }
 
 static void show_frame(WriterContext *w, AVFrame *frame, AVStream *stream,
@@ -2749,7 +2889,7 @@ static void show_frame(WriterContext *w, AVFrame *frame, AVStream *stream,
     writer_print_section_footer(w);
 
     av_bprint_finalize(&pbuf, NULL);
-    fflush(stdout);
+    writer_flush_section(w);
 }
 
 static av_always_inline int process_frame(WriterContext *w,
@@ -2960,6 +3100,661 @@ end:
     return ret;
 }
 
+static void close_input_file(InputFile *ifile)
+{
+    int i;
+
+    /* close decoder for each stream */
+    for (i = 0; i < ifile->nb_streams; i++)
+        avcodec_free_context(&ifile->streams[i].dec_ctx);
+
+    av_freep(&ifile->streams);
+    ifile->nb_streams = 0;
+
+    avformat_close_input(&ifile->fmt_ctx);
+}
+
+static int open_stream_decoder(InputStream *ist, AVFormatContext *fmt_ctx,
+                               const AVCodecParameters *par, const AVCodec *codec)
+{
+    AVStream *stream = ist->st;
+    const AVDictionaryEntry *t;
+    AVDictionary *opts = filter_codec_opts(codec_opts, par->codec_id,
+                                           fmt_ctx, stream, codec);
+    int err;
+
+    ist->dec_ctx = avcodec_alloc_context3(codec);
+    if (!ist->dec_ctx) {
+        err = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    err = avcodec_parameters_to_context(ist->dec_ctx, par);
+    if (err < 0)
+        goto end;
+
+    if (do_show_log) {
+        // For loging it is needed to disable at least frame threads as otherwise
+        // the log information would need to be reordered and matches up to contexts and frames
+        // That is in fact possible but not trivial
+        av_dict_set(&codec_opts, "threads", "1", 0);
+    }
+
+    av_dict_set(&opts, "flags", "+copy_opaque", AV_DICT_MULTIKEY);
+
+    ist->dec_ctx->pkt_timebase = stream->time_base;
+
+    if ((err = avcodec_open2(ist->dec_ctx, codec, &opts)) < 0) {
+        av_log(NULL, AV_LOG_WARNING, "Could not open codec for input stream %d\n",
+               stream->index);
+        goto end;
+    }
+
+    if ((t = av_dict_get(opts, "", NULL, AV_DICT_IGNORE_SUFFIX))) {
+        av_log(NULL, AV_LOG_ERROR, "Option %s for input stream %d not found\n",
+               t->key, stream->index);
+        err = AVERROR_OPTION_NOT_FOUND;
+    }
+
+end:
+    av_dict_free(&opts);
+    return err;
+}
+
+#if HAVE_THREADS
+typedef struct SegmentEvent {
+    int       stream_index;
+    AVPacket *pkt;              ///< demuxed packet, NULL for a decoded frame
+    AVFrame  *frame;            ///< properties of a decoded frame, without data
+} SegmentEvent;
+
+#define SEGMENT_STATE_IN_RANGE  1 ///< the last packet of the stream belongs to the segment
+#define SEGMENT_STATE_PKT_END   2 ///< a packet past the segment end was read
+#define SEGMENT_STATE_FRAME_END 4 ///< a frame past the segment end was decoded
+#define SEGMENT_STATE_DONE      8 ///< nothing more to read for the stream
+
+typedef struct SplitPoint {
+    int64_t pts;                ///< pts of the keyframe starting a segment
+    int64_t seek_ts;            ///< seek target landing on the preceding keyframe
+} SplitPoint;
+
+typedef struct ReadSegment {
+    InputFile *ifile;           ///< demuxer and decoders reading the segment
+    InputFile priv;             ///< private ifile of all but the first segment
+    int64_t start, end;         ///< keyframe pts bounds in the split stream time base
+    int64_t seek_ts;
+    /* coded picture numbers given by the decoder of the segment to the
+     * keyframes at start and end, to number them as when reading sequentially */
+    int start_picture, end_picture;
+    int *state;                 ///< SEGMENT_STATE_* flags for each stream
+    AVFifo *events;             ///< SegmentEvent, in the order they are to be printed
+    int ret;
+    int done;
+} ReadSegment;
+
+typedef struct ReadSegmentContext {
+    InputFile *ifile;
+    int split_idx;              ///< index of the stream whose keyframes delimit the segments
+    AVRational split_tb;
+    ReadSegment *segments;
+    int nb_segments;
+    int next_segment;           ///< next segment to be read by a worker
+    int cur_segment;            ///< segment being printed
+    int nb_workers;
+    int abort;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+} ReadSegmentContext;
+
+static int segment_ts_cmp(const ReadSegmentContext *rs, const ReadSegment *seg,
+                          int64_t ts, AVRational tb)
+{
+    if (seg->start != INT64_MIN && av_compare_ts(ts, tb, seg->start, rs->split_tb) < 0)
+        return -1;
+    if (seg->end != INT64_MAX && av_compare_ts(ts, tb, seg->end, rs->split_tb) >= 0)
+        return 1;
+    return 0;
+}
+
+static int segment_add_packet(ReadSegment *seg, const AVPacket *pkt)
+{
+    SegmentEvent ev = { .stream_index = pkt->stream_index };
+    int ret;
+
+    ev.pkt = av_packet_alloc();
+    if (!ev.pkt)
+        return AVERROR(ENOMEM);
+    /* keep the payload only when it is printed */
+    if (do_show_data || hash) {
+        ret = av_packet_ref(ev.pkt, pkt);
+    } else {
+        ret = av_packet_copy_props(ev.pkt, pkt);
+        ev.pkt->size = pkt->size;
+    }
+    if (ret >= 0)
+        ret = av_fifo_write(seg->events, &ev, 1);
+    if (ret < 0)
+        av_packet_free(&ev.pkt);
+    return ret;
+}
+
+static int segment_add_frame(ReadSegment *seg, int stream_index, const AVFrame *frame)
+{
+    SegmentEvent ev = { .stream_index = stream_index };
+    int ret;
+
+    /* do not hold on to the decoder buffers, only the properties are printed */
+    ev.frame = av_frame_alloc();
+    if (!ev.frame)
+        return AVERROR(ENOMEM);
+    ev.frame->format     = frame->format;
+    ev.frame->width      = frame->width;
+    ev.frame->height     = frame->height;
+    ev.frame->nb_samples = frame->nb_samples;
+    ret = av_channel_layout_copy(&ev.frame->ch_layout, &frame->ch_layout);
+    if (ret >= 0)
+        ret = av_frame_copy_props(ev.frame, frame);
+    if (ret >= 0)
+        ret = av_fifo_write(seg->events, &ev, 1);
+    if (ret < 0)
+        av_frame_free(&ev.frame);
+    return ret;
+}
+
+static int segment_decode(const ReadSegmentContext *rs, ReadSegment *seg,
+                          int stream_index, const AVPacket *pkt, AVFrame *frame)
+{
+    InputStream *ist = &seg->ifile->streams[stream_index];
+    int *state = &seg->state[stream_index];
+    int ret;
+
+    /* decoding errors are not fatal, as in read_interval_packets() */
+    ret = avcodec_send_packet(ist->dec_ctx, pkt);
+    if (ret < 0 && ret != AVERROR_EOF)
+        return 0;
+
+    while (avcodec_receive_frame(ist->dec_ctx, frame) >= 0) {
+        int64_t ts = frame->best_effort_timestamp;
+        int owned;
+
+        if (ts == AV_NOPTS_VALUE) {
+            owned = *state & SEGMENT_STATE_IN_RANGE;
+        } else {
+            int cmp = segment_ts_cmp(rs, seg, ts, ist->st->time_base);
+            if (cmp > 0)
+                *state |= SEGMENT_STATE_FRAME_END;
+            owned = !cmp;
+#if LIBAVUTIL_VERSION_MAJOR < 59
+            if (stream_index == rs->split_idx) {
+            AV_NOWARN_DEPRECATED(
+                if (ts == seg->start)
+                    seg->start_picture = frame->coded_picture_number;
+                if (ts == seg->end)
+                    seg->end_picture   = frame->coded_picture_number;
+            )
+            }
+#endif
+        }
+        ret = owned ? segment_add_frame(seg, stream_index, frame) : 0;
+        av_frame_unref(frame);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+
+static int read_segment(ReadSegmentContext *rs, ReadSegment *seg)
+{
+    InputFile *ifile = seg->ifile;
+    AVFormatContext *fmt_ctx = ifile->fmt_ctx;
+    AVPacket *pkt = NULL;
+    AVFrame *frame = NULL;
+    int i, ret = 0, nb_active = 0;
+
+    for (i = 0; i < ifile->nb_streams; i++) {
+        if (!selected_streams[i])
+            continue;
+        if (seg->start == INT64_MIN)
+            seg->state[i] |= SEGMENT_STATE_IN_RANGE;
+        /* attached pictures are only returned at the start of the file */
+        if (ifile->streams[i].st->disposition & AV_DISPOSITION_ATTACHED_PIC)
+            seg->state[i] |= SEGMENT_STATE_DONE;
+        else
+            nb_active++;
+    }
+
+    frame = av_frame_alloc();
+    pkt   = av_packet_alloc();
+    if (!frame || !pkt) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    /* read until every stream went past the segment end, both in demuxing
+     * and in presentation order */
+    while (nb_active > 0 && !av_read_frame(fmt_ctx, pkt)) {
+        int idx = pkt->stream_index;
+        int64_t ts = pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+        InputStream *ist;
+        int *state;
+
+        if (idx >= ifile->nb_streams || !selected_streams[idx]) {
+            av_packet_unref(pkt);
+            continue;
+        }
+        ist   = &ifile->streams[idx];
+        state = &seg->state[idx];
+
+        if (ts != AV_NOPTS_VALUE) {
+            int cmp = segment_ts_cmp(rs, seg, ts, ist->st->time_base);
+            if (cmp)
+                *state &= ~SEGMENT_STATE_IN_RANGE;
+            else
+                *state |=  SEGMENT_STATE_IN_RANGE;
+            if (cmp > 0)
+                *state |=  SEGMENT_STATE_PKT_END;
+        }
+
+        if (do_read_packets && *state & SEGMENT_STATE_IN_RANGE) {
+            ret = segment_add_packet(seg, pkt);
+            if (ret < 0)
+                goto end;
+        }
+        if (ist->dec_ctx) {
+            FrameData *fd;
+
+            pkt->opaque_ref = av_buffer_allocz(sizeof(*fd));
+            if (!pkt->opaque_ref) {
+                ret = AVERROR(ENOMEM);
+                goto end;
+            }
+            fd = (FrameData*)pkt->opaque_ref->data;
+            fd->pkt_pos  = pkt->pos;
+            fd->pkt_size = pkt->size;
+
+            ret = segment_decode(rs, seg, idx, pkt, frame);
+            if (ret < 0)
+                goto end;
+        }
+        av_packet_unref(pkt);
+
+        if (!(*state & SEGMENT_STATE_DONE) && *state & SEGMENT_STATE_PKT_END &&
+            (!ist->dec_ctx || *state & SEGMENT_STATE_FRAME_END)) {
+            *state |= SEGMENT_STATE_DONE;
+            nb_active--;
+        }
+    }
+
+    for (i = 0; i < ifile->nb_streams; i++) {
+        if (!selected_streams[i] || !ifile->streams[i].dec_ctx)
+            continue;
+        ret = segment_decode(rs, seg, i, NULL, frame);
+        if (ret < 0)
+            goto end;
+    }
+
+end:
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    close_input_file(&seg->priv);
+    return ret;
+}
+
+static void *read_segment_worker(void *arg)
+{
+    ReadSegmentContext *rs = arg;
+
+    pthread_mutex_lock(&rs->lock);
+    for (;;) {
+        ReadSegment *seg;
+        int ret;
+
+        /* bound the amount of results waiting to be printed */
+        while (!rs->abort && rs->next_segment < rs->nb_segments &&
+               rs->next_segment >= rs->cur_segment + 2 * rs->nb_workers)
+            pthread_cond_wait(&rs->cond, &rs->lock);
+        if (rs->abort || rs->next_segment >= rs->nb_segments)
+            break;
+        seg = &rs->segments[rs->next_segment++];
+        pthread_mutex_unlock(&rs->lock);
+
+        ret = read_segment(rs, seg);
+
+        pthread_mutex_lock(&rs->lock);
+        seg->ret  = ret;
+        seg->done = 1;
+        pthread_cond_broadcast(&rs->cond);
+    }
+    pthread_mutex_unlock(&rs->lock);
+
+    return NULL;
+}
+
+static int open_segment_input(InputFile *seg_ifile, const InputFile *ifile)
+{
+    AVFormatContext *fmt_ctx = NULL;
+    AVDictionary *opts = NULL;
+    int i, ret;
+
+    av_dict_copy(&opts, format_opts, 0);
+    av_dict_set(&opts, "scan_all_pmts", "1", AV_DICT_DONT_OVERWRITE);
+    ret = avformat_open_input(&fmt_ctx, input_filename, iformat, &opts);
+    av_dict_free(&opts);
+    if (ret < 0)
+        return ret;
+    seg_ifile->fmt_ctx = fmt_ctx;
+
+    if (fmt_ctx->nb_streams != ifile->nb_streams)
+        return AVERROR(EINVAL);
+
+    seg_ifile->streams = av_calloc(fmt_ctx->nb_streams, sizeof(*seg_ifile->streams));
+    if (!seg_ifile->streams)
+        return AVERROR(ENOMEM);
+    seg_ifile->nb_streams = fmt_ctx->nb_streams;
+
+    for (i = 0; i < fmt_ctx->nb_streams; i++) {
+        InputStream *ist = &seg_ifile->streams[i];
+        const InputStream *main_ist = &ifile->streams[i];
+
+        ist->st = fmt_ctx->streams[i];
+        if (!selected_streams[i]) {
+            ist->st->discard = AVDISCARD_ALL;
+            continue;
+        }
+        if (av_cmp_q(ist->st->time_base, main_ist->st->time_base))
+            return AVERROR(EINVAL);
+
+        /* the parameters found by avformat_find_stream_info() are also
+         * needed by the demuxer, e.g. to derive audio packet durations */
+        ret = avcodec_parameters_copy(ist->st->codecpar, main_ist->st->codecpar);
+        if (ret < 0)
+            return ret;
+
+        if (main_ist->dec_ctx) {
+            ret = open_stream_decoder(ist, fmt_ctx, ist->st->codecpar,
+                                      main_ist->dec_ctx->codec);
+            if (ret < 0)
+                return ret;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Seek to evenly spaced points of the input and pick the keyframe found
+ * there on the split stream, using the demuxer index when available.
+ * Points at or before the first keyframe of the split stream are dropped,
+ * as the first segment must contain it.
+ *
+ * @return the number of strictly increasing split points, or a negative
+ *         error code
+ */
+static int find_split_points(const ReadSegmentContext *rs, AVFormatContext *fmt_ctx,
+                             SplitPoint *points, int nb_points)
+{
+    const AVFormatContext *main_ctx = rs->ifile->fmt_ctx;
+    AVStream *st = fmt_ctx->streams[rs->split_idx];
+    int64_t start = main_ctx->start_time != AV_NOPTS_VALUE ? main_ctx->start_time : 0;
+    int64_t first_pts = AV_NOPTS_VALUE;
+    AVPacket *pkt;
+    int i, n = 0;
+
+    pkt = av_packet_alloc();
+    if (!pkt)
+        return AVERROR(ENOMEM);
+
+    /* fmt_ctx has not been read from yet */
+    while (!av_read_frame(fmt_ctx, pkt)) {
+        if (pkt->stream_index == rs->split_idx &&
+            pkt->flags & AV_PKT_FLAG_KEY && pkt->pts != AV_NOPTS_VALUE)
+            first_pts = pkt->pts;
+        av_packet_unref(pkt);
+        if (first_pts != AV_NOPTS_VALUE)
+            break;
+    }
+    if (first_pts == AV_NOPTS_VALUE)
+        nb_points = 0;
+
+    for (i = 1; i <= nb_points; i++) {
+        int64_t ts = start + av_rescale(main_ctx->duration, i, nb_points + 1);
+        const AVIndexEntry *e;
+
+        ts = av_rescale_q(ts, AV_TIME_BASE_Q, st->time_base);
+        e  = avformat_index_get_entry_from_timestamp(st, ts, AVSEEK_FLAG_BACKWARD);
+        if (e)
+            ts = e->timestamp;
+        if (avformat_seek_file(fmt_ctx, rs->split_idx, INT64_MIN, ts, ts, 0) < 0)
+            continue;
+
+        while (!av_read_frame(fmt_ctx, pkt)) {
+            if (pkt->stream_index == rs->split_idx &&
+                pkt->flags & AV_PKT_FLAG_KEY && pkt->pts != AV_NOPTS_VALUE)
+                break;
+            av_packet_unref(pkt);
+        }
+        if (!pkt->size)
+            break;
+
+        if (pkt->pts > (n ? points[n - 1].pts : first_pts)) {
+            points[n].pts     = pkt->pts;
+            points[n].seek_ts = (pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts) - 1;
+            n++;
+        }
+        av_packet_unref(pkt);
+    }
+
+    av_packet_free(&pkt);
+    return n;
+}
+
+/**
+ * Read the input as segments delimited by keyframes, decoded concurrently
+ * with separate demuxers and decoders, then print them in order.
+ *
+ * @return AVERROR(ENOSYS) if the input cannot be split, in which case
+ *         nothing has been read from ifile
+ */
+static int read_packets_parallel(WriterContext *w, InputFile *ifile, int nb_workers)
+{
+    AVFormatContext *fmt_ctx = ifile->fmt_ctx;
+    ReadSegmentContext rs = { .ifile = ifile, .split_idx = -1, .nb_workers = nb_workers };
+    pthread_t *workers = NULL;
+    SplitPoint *points = NULL;
+    int picture_offset = 0;
+    int i, ret = 0, nb_allocated = 0, nb_started = 0, nb_points, pkt_idx = 0;
+
+    if (fmt_ctx->ctx_flags & AVFMTCTX_NOHEADER || !fmt_ctx->pb ||
+        !(fmt_ctx->pb->seekable & AVIO_SEEKABLE_NORMAL) || fmt_ctx->duration <= 0)
+        return AVERROR(ENOSYS);
+
+    /* split on the keyframes of a video stream, preferably */
+    for (i = 0; i < ifile->nb_streams; i++) {
+        const InputStream *ist = &ifile->streams[i];
+        enum AVMediaType type = ist->st->codecpar->codec_type;
+
+        if (!selected_streams[i])
+            continue;
+        if (type != AVMEDIA_TYPE_VIDEO && type != AVMEDIA_TYPE_AUDIO)
+            return AVERROR(ENOSYS);
+        if (!ist->dec_ctx || ist->st->disposition & AV_DISPOSITION_ATTACHED_PIC)
+            continue;
+        if (rs.split_idx < 0 ||
+            (type == AVMEDIA_TYPE_VIDEO &&
+             ifile->streams[rs.split_idx].st->codecpar->codec_type != AVMEDIA_TYPE_VIDEO))
+            rs.split_idx = i;
+    }
+    if (rs.split_idx < 0)
+        return AVERROR(ENOSYS);
+    rs.split_tb = ifile->streams[rs.split_idx].st->time_base;
+
+    /* use more segments than workers to balance the load */
+    rs.nb_segments = 4 * nb_workers;
+    rs.segments = av_calloc(rs.nb_segments, sizeof(*rs.segments));
+    points      = av_malloc_array(rs.nb_segments - 1, sizeof(*points));
+    if (!rs.segments || !points) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    for (i = 0; i < rs.nb_segments; i++) {
+        ReadSegment *seg = &rs.segments[i];
+
+        nb_allocated++;
+        seg->state  = av_calloc(ifile->nb_streams, sizeof(*seg->state));
+        seg->events = av_fifo_alloc2(64, sizeof(SegmentEvent), AV_FIFO_FLAG_AUTO_GROW);
+        if (!seg->state || !seg->events) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        /* the first segment is read with the main demuxer and decoders,
+         * which have not been used yet */
+        if (!i)
+            continue;
+        ret = open_segment_input(&seg->priv, ifile);
+        if (ret < 0) {
+            av_log(NULL, AV_LOG_VERBOSE, "Could not open input segment: %s\n",
+                   av_err2str(ret));
+            ret = ret == AVERROR(ENOMEM) ? ret : AVERROR(ENOSYS);
+            goto end;
+        }
+    }
+
+    /* the last segment seeks to its own start anyway */
+    nb_points = find_split_points(&rs, rs.segments[rs.nb_segments - 1].priv.fmt_ctx,
+                                  points, rs.nb_segments - 1);
+    if (nb_points <= 0) {
+        ret = nb_points ? nb_points : AVERROR(ENOSYS);
+        goto end;
+    }
+    FFSWAP(ReadSegment, rs.segments[nb_points], rs.segments[rs.nb_segments - 1]);
+    rs.nb_segments = nb_points + 1;
+    for (i = 0; i < rs.nb_segments; i++) {
+        ReadSegment *seg = &rs.segments[i];
+
+        seg->ifile   = i             ? &seg->priv            : ifile;
+        seg->start   = i             ? points[i - 1].pts     : INT64_MIN;
+        seg->seek_ts = i             ? points[i - 1].seek_ts : AV_NOPTS_VALUE;
+        seg->end     = i < nb_points ? points[i].pts         : INT64_MAX;
+    }
+    for (i = rs.nb_segments; i < nb_allocated; i++)
+        close_input_file(&rs.segments[i].priv);
+
+    /* Start each segment from the keyframe preceding it, so that leading
+     * pictures of its first keyframe can be decoded and packets of other
+     * streams stored before it are not missed. This is done before reading
+     * anything, so that the input can still be read sequentially if the
+     * demuxer cannot seek there. */
+    for (i = 1; i < rs.nb_segments; i++) {
+        ReadSegment *seg = &rs.segments[i];
+
+        ret = avformat_seek_file(seg->priv.fmt_ctx, rs.split_idx, INT64_MIN,
+                                 seg->seek_ts, seg->seek_ts, 0);
+        if (ret < 0) {
+            av_log(NULL, AV_LOG_VERBOSE, "Could not seek to segment start %s: %s\n",
+                   av_ts2timestr(seg->start, &rs.split_tb), av_err2str(ret));
+            ret = AVERROR(ENOSYS);
+            goto end;
+        }
+    }
+
+    av_log(NULL, AV_LOG_VERBOSE, "Reading %d segments split on stream #%d with %d threads\n",
+           rs.nb_segments, rs.split_idx, nb_workers);
+
+    if ((ret = pthread_mutex_init(&rs.lock, NULL))) {
+        ret = AVERROR(ret);
+        goto end;
+    }
+    if ((ret = pthread_cond_init(&rs.cond, NULL))) {
+        pthread_mutex_destroy(&rs.lock);
+        ret = AVERROR(ret);
+        goto end;
+    }
+
+    workers = av_calloc(nb_workers, sizeof(*workers));
+    if (!workers)
+        ret = AVERROR(ENOMEM);
+    for (i = 0; workers && i < nb_workers; i++) {
+        if ((ret = pthread_create(&workers[i], NULL, read_segment_worker, &rs))) {
+            ret = AVERROR(ret);
+            break;
+        }
+        nb_started++;
+    }
+    if (nb_started)
+        ret = 0;
+
+    for (i = 0; nb_started && i < rs.nb_segments; i++) {
+        ReadSegment *seg = &rs.segments[i];
+        SegmentEvent ev;
+
+        pthread_mutex_lock(&rs.lock);
+        while (!seg->done)
+            pthread_cond_wait(&rs.cond, &rs.lock);
+        pthread_mutex_unlock(&rs.lock);
+
+        if ((ret = seg->ret) < 0)
+            break;
+        if (i)
+            picture_offset += rs.segments[i - 1].end_picture - seg->start_picture;
+
+        while (av_fifo_read(seg->events, &ev, 1) >= 0) {
+            if (ev.pkt) {
+                if (do_show_packets)
+                    show_packet(w, ifile, ev.pkt, pkt_idx++);
+                nb_streams_packets[ev.stream_index]++;
+                av_packet_free(&ev.pkt);
+            } else {
+                nb_streams_frames[ev.stream_index]++;
+#if LIBAVUTIL_VERSION_MAJOR < 59
+                if (ev.stream_index == rs.split_idx) {
+                AV_NOWARN_DEPRECATED(
+                    ev.frame->coded_picture_number += picture_offset;
+                )
+                }
+#endif
+                if (do_show_frames)
+                    show_frame(w, ev.frame, ifile->streams[ev.stream_index].st, fmt_ctx);
+                av_frame_free(&ev.frame);
+            }
+        }
+
+        pthread_mutex_lock(&rs.lock);
+        rs.cur_segment = i + 1;
+        pthread_cond_broadcast(&rs.cond);
+        pthread_mutex_unlock(&rs.lock);
+    }
+
+    pthread_mutex_lock(&rs.lock);
+    rs.abort = 1;
+    pthread_cond_broadcast(&rs.cond);
+    pthread_mutex_unlock(&rs.lock);
+    for (i = 0; i < nb_started; i++)
+        pthread_join(workers[i], NULL);
+
+    pthread_cond_destroy(&rs.cond);
+    pthread_mutex_destroy(&rs.lock);
+
+end:
+    for (i = 0; i < nb_allocated; i++) {
+        ReadSegment *seg = &rs.segments[i];
+        SegmentEvent ev;
+
+        close_input_file(&seg->priv);
+        while (seg->events && av_fifo_read(seg->events, &ev, 1) >= 0) {
+            av_packet_free(&ev.pkt);
+            av_frame_free(&ev.frame);
+        }
+        av_fifo_freep2(&seg->events);
+        av_freep(&seg->state);
+    }
+    av_freep(&rs.segments);
+    av_freep(&workers);
+    av_freep(&points);
+
+    return ret;
+}
+#endif
+
 static int read_packets(WriterContext *w, InputFile *ifile)
 {
     AVFormatContext *fmt_ctx = ifile->fmt_ctx;
@@ -2968,6 +3763,17 @@ static int read_packets(WriterContext *w, InputFile *ifile)
 
     if (read_intervals_nb == 0) {
         ReadInterval interval = (ReadInterval) { .has_start = 0, .has_end = 0 };
+#if HAVE_THREADS
+        int nb_threads = read_threads ? read_threads : av_cpu_count();
+
+        if (nb_threads > 1 && do_read_frames && !do_show_log) {
+            ret = read_packets_parallel(w, ifile, nb_threads);
+            if (ret != AVERROR(ENOSYS))
+                return ret;
+            av_log(NULL, AV_LOG_VERBOSE, "Input cannot be split in segments, "
+                   "reading it sequentially\n");
+        }
+#endif
         ret = read_interval_packets(w, ifile, &interval, &cur_ts);
     } else {
         for (i = 0; i < read_intervals_nb; i++) {
@@ -3198,7 +4004,7 @@ static int show_stream(WriterContext *w, AVFormatContext *fmt_ctx, int stream_id
 
     writer_print_section_footer(w);
     av_bprint_finalize(&pbuf, NULL);
-    fflush(stdout);
+    writer_flush_section(w);
 
     return ret;
 }
@@ -3321,7 +4127,7 @@ static int show_format(WriterContext *w, InputFile *ifile)
         ret = show_tags(w, fmt_ctx->metadata, SECTION_ID_FORMAT_TAGS);
 
     writer_print_section_footer(w);
-    fflush(stdout);
+    writer_flush_section(w);
     return ret;
 }
 
@@ -3409,61 +4215,17 @@ static int open_input_file(InputFile *ifile, const char *filename,
                     stream->codecpar->codec_id, stream->index);
             continue;
         }
-        {
-            AVDictionary *opts = filter_codec_opts(codec_opts, stream->codecpar->codec_id,
-                                                   fmt_ctx, stream, codec);
-
-            ist->dec_ctx = avcodec_alloc_context3(codec);
-            if (!ist->dec_ctx)
-                exit(1);
-
-            err = avcodec_parameters_to_context(ist->dec_ctx, stream->codecpar);
-            if (err < 0)
-                exit(1);
-
-            if (do_show_log) {
-                // For loging it is needed to disable at least frame threads as otherwise
-                // the log information would need to be reordered and matches up to contexts and frames
-                // That is in fact possible but not trivial
-                av_dict_set(&codec_opts, "threads", "1", 0);
-            }
-
-            av_dict_set(&opts, "flags", "+copy_opaque", AV_DICT_MULTIKEY);
-
-            ist->dec_ctx->pkt_timebase = stream->time_base;
-
-            if (avcodec_open2(ist->dec_ctx, codec, &opts) < 0) {
-                av_log(NULL, AV_LOG_WARNING, "Could not open codec for input stream %d\n",
-                       stream->index);
-                exit(1);
-            }
-
-            if ((t = av_dict_get(opts, "", NULL, AV_DICT_IGNORE_SUFFIX))) {
-                av_log(NULL, AV_LOG_ERROR, "Option %s for input stream %d not found\n",
-                       t->key, stream->index);
-                return AVERROR_OPTION_NOT_FOUND;
-            }
-        }
+        err = open_stream_decoder(ist, fmt_ctx, stream->codecpar, codec);
+        if (err == AVERROR_OPTION_NOT_FOUND)
+            return err;
+        else if (err < 0)
+            exit(1);
     }
 
     ifile->fmt_ctx = fmt_ctx;
     return 0;
 }
 
-static void close_input_file(InputFile *ifile)
-{
-    int i;
-
-    /* close decoder for each stream */
-    for (i = 0; i < ifile->nb_streams; i++)
-        avcodec_free_context(&ifile->streams[i].dec_ctx);
-
-    av_freep(&ifile->streams);
-    ifile->nb_streams = 0;
-
-    avformat_close_input(&ifile->fmt_ctx);
-}
-
 static int probe_file(WriterContext *wctx, const char *filename,
                       const char *print_filename)
 {
@@ -4052,6 +4814,10 @@ static const OptionDef real_options[] = {
     { "private",           OPT_BOOL, { &show_private_data }, "same as show_private_data" },
     { "bitexact", OPT_BOOL, {&do_bitexact}, "force bitexact output" },
     { "read_intervals", HAS_ARG, {.func_arg = opt_read_intervals}, "set read intervals", "read_intervals" },
+#if HAVE_THREADS
+    { "read_threads", OPT_INT | HAS_ARG, { &read_threads },
+      "set the number of threads decoding keyframe-aligned segments in parallel (0 for auto)", "count" },
+#endif
     { "i", HAS_ARG, {.func_arg = opt_input_file_i}, "read specified file", "input_file"},
     { "o", HAS_ARG, {.func_arg = opt_output_file_o}, "write to specified output", "output_file"},
     { "print_filename", HAS_ARG, {.func_arg = opt_print_filename}, "override the printed input filename", "print_file"},
@@ -4228,5 +4994,6 @@ end:
 
     avformat_network_deinit();
 
+    av_log_flush();
     return ret < 0;
 }
@@ -1082,6 +1082,15 @@ int opt_cpucount(void *optctx, const char *opt, const char *arg)
     return ret;
 }
 
+int opt_threads_affinity(void *optctx, const char *opt, const char *arg)
+{
+    int ret = av_cpu_set_thread_affinity(arg);
+    if (ret < 0)
+        av_log(NULL, AV_LOG_ERROR, "Could not set thread affinity '%s': %s\n",
+               arg, av_err2str(ret));
+    return ret;
+}
+
 static void expand_filename_template(AVBPrint *bp, const char *template,
                                      struct tm *tm)
 {
@@ -1269,6 +1278,18 @@ int opt_loglevel(void *optctx, const char *opt, const char *arg)
             } else {
                 flags |= AV_LOG_PRINT_LEVEL;
             }
+        } else if (av_strstart(token, "async", &arg)) {
+            if (cmd == '-') {
+                flags &= ~AV_LOG_ASYNC;
+            } else {
+                flags |= AV_LOG_ASYNC;
+            }
+        } else if (av_strstart(token, "json", &arg)) {
+            if (cmd == '-') {
+                flags &= ~AV_LOG_JSON;
+            } else {
+                flags |= AV_LOG_JSON;
+            }
         } else {
             break;
         }
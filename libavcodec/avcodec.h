@@ -2087,6 +2087,25 @@ typedef struct AVCodecContext {
      *   an error.
      */
     int64_t frame_num;
+
+    /**
+     * Restrict the threads created by the codec to a set of CPUs, e.g. to
+     * keep them on one NUMA node. See av_cpu_set_thread_affinity() for the
+     * syntax. NULL (the default) leaves them to the system scheduler.
+     *
+     * - encoding: Set by user.
+     * - decoding: Set by user.
+     */
+    char *thread_affinity;
+
+    /**
+     * AV_BUFFER_POOL_FLAG_* flags for the pools of the default get_buffer2()
+     * implementation, see av_buffer_pool_init_flags().
+     *
+     * - encoding: unused
+     * - decoding: Set by user.
+     */
+    int frame_pool_flags;
 } AVCodecContext;
 
 /**
@@ -25,6 +25,7 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/internal.h"
 #include "libavutil/samplefmt.h"
+#include "libavutil/thread.h"
 
 #include "avcodec.h"
 #include "codec_internal.h"
@@ -711,7 +712,16 @@ int ff_encode_preinit(AVCodecContext *avctx)
     }
 
     if (CONFIG_FRAME_THREAD_ENCODER) {
+        void *affinity;
+
+        ret = avpriv_thread_affinity_push(avctx->thread_affinity, &affinity);
+        if (ret < 0) {
+            av_log(avctx, AV_LOG_ERROR, "Could not set thread affinity '%s'\n",
+                   avctx->thread_affinity);
+            return ret;
+        }
         ret = ff_frame_thread_encoder_init(avctx);
+        avpriv_thread_affinity_pop(&affinity);
         if (ret < 0)
             return ret;
     }
@@ -152,10 +152,11 @@ FF_ENABLE_DEPRECATION_WARNINGS
                     ret = AVERROR(EINVAL);
                     goto fail;
                 }
-                pool->pools[i] = av_buffer_pool_init(size[i] + 16 + STRIDE_ALIGN - 1,
-                                                     CONFIG_MEMORY_POISONING ?
-                                                        NULL :
-                                                        av_buffer_allocz);
+                pool->pools[i] = av_buffer_pool_init_flags(size[i] + 16 + STRIDE_ALIGN - 1,
+                                                           CONFIG_MEMORY_POISONING ?
+                                                              NULL :
+                                                              av_buffer_allocz,
+                                                           avctx->frame_pool_flags);
                 if (!pool->pools[i]) {
                     ret = AVERROR(ENOMEM);
                     goto fail;
@@ -174,7 +175,8 @@ FF_ENABLE_DEPRECATION_WARNINGS
         if (ret < 0)
             goto fail;
 
-        pool->pools[0] = av_buffer_pool_init(pool->linesize[0], NULL);
+        pool->pools[0] = av_buffer_pool_init_flags(pool->linesize[0], NULL,
+                                                   avctx->frame_pool_flags);
         if (!pool->pools[0]) {
             ret = AVERROR(ENOMEM);
             goto fail;
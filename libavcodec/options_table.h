@@ -360,6 +360,11 @@ static const AVOption avcodec_options[] = {
 {"thread_type", "select multithreading type", OFFSET(thread_type), AV_OPT_TYPE_FLAGS, {.i64 = FF_THREAD_SLICE|FF_THREAD_FRAME }, 0, INT_MAX, V|A|E|D, "thread_type"},
 {"slice", NULL, 0, AV_OPT_TYPE_CONST, {.i64 = FF_THREAD_SLICE }, INT_MIN, INT_MAX, V|E|D, "thread_type"},
 {"frame", NULL, 0, AV_OPT_TYPE_CONST, {.i64 = FF_THREAD_FRAME }, INT_MIN, INT_MAX, V|E|D, "thread_type"},
+{"thread_affinity", "restrict the codec threads to a set of CPUs", OFFSET(thread_affinity), AV_OPT_TYPE_STRING, {.str = NULL }, 0, 0, V|A|E|D},
+{"frame_pool_flags", "allocation flags for the frame pools of the default get_buffer2()", OFFSET(frame_pool_flags), AV_OPT_TYPE_FLAGS, {.i64 = 0 }, 0, INT_MAX, V|A|D, "frame_pool_flags"},
+{"hugepage", "use transparent huge pages", 0, AV_OPT_TYPE_CONST, {.i64 = AV_BUFFER_POOL_FLAG_HUGEPAGE }, INT_MIN, INT_MAX, V|A|D, "frame_pool_flags"},
+{"hugetlb", "use explicit huge pages", 0, AV_OPT_TYPE_CONST, {.i64 = AV_BUFFER_POOL_FLAG_HUGETLB }, INT_MIN, INT_MAX, V|A|D, "frame_pool_flags"},
+{"numa_local", "fault in buffers in the allocating thread", 0, AV_OPT_TYPE_CONST, {.i64 = AV_BUFFER_POOL_FLAG_NUMA_LOCAL }, INT_MIN, INT_MAX, V|A|D, "frame_pool_flags"},
 {"audio_service_type", "audio service type", OFFSET(audio_service_type), AV_OPT_TYPE_INT, {.i64 = AV_AUDIO_SERVICE_TYPE_MAIN }, 0, AV_AUDIO_SERVICE_TYPE_NB-1, A|E, "audio_service_type"},
 {"ma", "Main Audio Service", 0, AV_OPT_TYPE_CONST, {.i64 = AV_AUDIO_SERVICE_TYPE_MAIN },              INT_MIN, INT_MAX, A|E, "audio_service_type"},
 {"ef", "Effects",            0, AV_OPT_TYPE_CONST, {.i64 = AV_AUDIO_SERVICE_TYPE_EFFECTS },           INT_MIN, INT_MAX, A|E, "audio_service_type"},
@@ -70,14 +70,31 @@ static void validate_thread_parameters(AVCodecContext *avctx)
 
 int ff_thread_init(AVCodecContext *avctx)
 {
+    void *affinity;
+    int ret;
+
     validate_thread_parameters(avctx);
 
+    if (!avctx->active_thread_type)
+        return 0;
+
+    /* the worker threads inherit the affinity of the thread creating them,
+     * and automatic thread counts are derived from it */
+    ret = avpriv_thread_affinity_push(avctx->thread_affinity, &affinity);
+    if (ret < 0) {
+        av_log(avctx, AV_LOG_ERROR, "Could not set thread affinity '%s'\n",
+               avctx->thread_affinity);
+        return ret;
+    }
+
     if (avctx->active_thread_type&FF_THREAD_SLICE)
-        return ff_slice_thread_init(avctx);
-    else if (avctx->active_thread_type&FF_THREAD_FRAME)
-        return ff_frame_thread_init(avctx);
+        ret = ff_slice_thread_init(avctx);
+    else
+        ret = ff_frame_thread_init(avctx);
+
+    avpriv_thread_affinity_pop(&affinity);
 
-    return 0;
+    return ret;
 }
 
 void ff_thread_free(AVCodecContext *avctx)
@@ -51,6 +51,11 @@
 #include <libv4l2.h>
 #endif
 
+#if CONFIG_LIBDRM
+#include <drm_fourcc.h>
+#include "libavutil/hwcontext_drm.h"
+#endif
+
 static const int desired_video_buffers = 256;
 
 #define V4L_ALLFORMATS  3
@@ -79,6 +84,21 @@ static const int desired_video_buffers = 256;
  */
 #define V4L_TS_CONVERT_READY V4L_TS_DEFAULT
 
+/**
+ * Return the captured images as packets for the rawvideo decoder.
+ */
+#define V4L_OUTPUT_PACKET    0
+/**
+ * Return the captured images as AVFrames referencing the mapped capture
+ * buffers, wrapped in AV_CODEC_ID_WRAPPED_AVFRAME packets.
+ */
+#define V4L_OUTPUT_FRAME     1
+/**
+ * Export the capture buffers as DMABUFs and return them as
+ * AV_PIX_FMT_DRM_PRIME frames, wrapped in AV_CODEC_ID_WRAPPED_AVFRAME packets.
+ */
+#define V4L_OUTPUT_DRM_PRIME 2
+
 struct video_data {
     AVClass *class;
     int fd;
@@ -87,6 +107,10 @@ struct video_data {
     int frame_size;
     int interlaced;
     int top_field_first;
+    int bytesperline;
+    enum AVPixelFormat pix_fmt;
+    int linesize[4];
+    size_t plane_offset[4];
     int ts_mode;
     TimeFilter *timefilter;
     int64_t last_time_m;
@@ -102,6 +126,17 @@ struct video_data {
     int list_format;    /**< Set by a private option. */
     int list_standard;  /**< Set by a private option. */
     char *framerate;    /**< Set by a private option. */
+    int output_mode;    /**< Set by a private option. */
+    char *drm_device;   /**< Set by a private option. */
+
+#if CONFIG_LIBDRM
+    AVBufferRef *device_ref;
+    AVBufferRef *frames_ref;
+    /* One AVDRMFrameDescriptor per capture buffer, referenced by every
+     * frame exported from that buffer, so that the DMABUF fds outlive the
+     * device as long as frames still use them. */
+    AVBufferRef **drm_desc;
+#endif
 
     int use_libv4l2;
     int (*open_f)(const char *file, int oflag, ...);
@@ -217,6 +252,7 @@ static int device_init(AVFormatContext *ctx, int *width, int *height,
        is not supported (even if type field is valid and supported) */
     if (v4l2_ioctl(s->fd, VIDIOC_S_FMT, &fmt) < 0)
         res = AVERROR(errno);
+    s->bytesperline = fmt.fmt.pix.bytesperline;
 
     if ((*width != fmt.fmt.pix.width) || (*height != fmt.fmt.pix.height)) {
         av_log(ctx, AV_LOG_INFO,
@@ -501,6 +537,134 @@ static int convert_timestamp(AVFormatContext *ctx, int64_t *ts)
     return 0;
 }
 
+static void free_wrapped_frame(void *opaque, uint8_t *data)
+{
+    AVFrame *frame = (AVFrame*)data;
+
+    av_frame_free(&frame);
+}
+
+static int mmap_read_avframe(AVFormatContext *ctx, AVPacket *pkt,
+                             struct v4l2_buffer *buf)
+{
+    struct video_data *s = ctx->priv_data;
+    uint8_t *start = s->buf_start[buf->index];
+    AVFrame *frame;
+    int i, res;
+
+    if (!buf->bytesused) {
+        /* Nothing usable was captured, give the buffer back to the driver */
+        res = enqueue_buffer(s, buf);
+        return res < 0 ? res : AVERROR(EAGAIN);
+    }
+
+    frame = av_frame_alloc();
+    if (!frame) {
+        enqueue_buffer(s, buf);
+        return AVERROR(ENOMEM);
+    }
+    frame->width  = s->width;
+    frame->height = s->height;
+
+    if (atomic_load(&s->buffers_queued) == FFMAX(s->buffers / 8, 1)) {
+        uint8_t *src[4] = { NULL };
+
+        if (s->output_mode == V4L_OUTPUT_DRM_PRIME) {
+            /* There is no way to copy into a new DMABUF, so the frame has to
+             * go to keep the capture running. */
+            av_log(ctx, AV_LOG_WARNING, "Too many buffers are held by the "
+                   "caller, dropping a frame.\n");
+            av_frame_free(&frame);
+            res = enqueue_buffer(s, buf);
+            return res < 0 ? res : AVERROR(EAGAIN);
+        }
+
+        /* when we start getting low on queued buffers, fall back on copying data */
+        frame->format = s->pix_fmt;
+        res = av_frame_get_buffer(frame, 0);
+        if (res < 0) {
+            av_log(ctx, AV_LOG_ERROR, "Error allocating a frame.\n");
+            av_frame_free(&frame);
+            enqueue_buffer(s, buf);
+            return res;
+        }
+        for (i = 0; i < 4 && s->linesize[i]; i++)
+            src[i] = start + s->plane_offset[i];
+        av_image_copy(frame->data, frame->linesize, (const uint8_t **)src,
+                      s->linesize, s->pix_fmt, s->width, s->height);
+
+        res = enqueue_buffer(s, buf);
+        if (res < 0) {
+            av_frame_free(&frame);
+            return res;
+        }
+    } else {
+        struct buff_data *buf_descriptor = av_malloc(sizeof(*buf_descriptor));
+
+        if (!buf_descriptor) {
+            av_log(ctx, AV_LOG_ERROR, "Failed to allocate a buffer descriptor\n");
+            av_frame_free(&frame);
+            enqueue_buffer(s, buf);
+            return AVERROR(ENOMEM);
+        }
+        buf_descriptor->index = buf->index;
+        buf_descriptor->s     = s;
+
+#if CONFIG_LIBDRM
+        if (s->output_mode == V4L_OUTPUT_DRM_PRIME) {
+            /* The descriptors are set up once per capture buffer and
+             * shared by all the frames using it, hence read-only. */
+            AVBufferRef *desc = s->drm_desc[buf->index];
+
+            frame->buf[0] = av_buffer_create(desc->data, desc->size,
+                                             mmap_release_buffer, buf_descriptor,
+                                             AV_BUFFER_FLAG_READONLY);
+            frame->data[0] = desc->data;
+            frame->format  = AV_PIX_FMT_DRM_PRIME;
+        } else
+#endif
+        {
+            frame->buf[0] = av_buffer_create(start, s->buf_len[buf->index],
+                                             mmap_release_buffer, buf_descriptor, 0);
+            for (i = 0; i < 4 && s->linesize[i]; i++) {
+                frame->data[i]     = start + s->plane_offset[i];
+                frame->linesize[i] = s->linesize[i];
+            }
+            frame->format = s->pix_fmt;
+        }
+        if (!frame->buf[0]) {
+            av_log(ctx, AV_LOG_ERROR, "Failed to create a buffer\n");
+            av_frame_free(&frame);
+            enqueue_buffer(s, buf);
+            av_freep(&buf_descriptor);
+            return AVERROR(ENOMEM);
+        }
+
+#if CONFIG_LIBDRM
+        if (s->output_mode == V4L_OUTPUT_DRM_PRIME) {
+            frame->buf[1]        = av_buffer_ref(s->drm_desc[buf->index]);
+            frame->hw_frames_ctx = av_buffer_ref(s->frames_ref);
+            if (!frame->buf[1] || !frame->hw_frames_ctx) {
+                av_frame_free(&frame);
+                return AVERROR(ENOMEM);
+            }
+        }
+#endif
+    }
+
+    pkt->buf = av_buffer_create((uint8_t*)frame, sizeof(*frame),
+                                free_wrapped_frame, NULL, 0);
+    if (!pkt->buf) {
+        av_frame_free(&frame);
+        return AVERROR(ENOMEM);
+    }
+    pkt->data   = (uint8_t*)frame;
+    pkt->size   = sizeof(*frame);
+    pkt->flags |= AV_PKT_FLAG_TRUSTED;
+
+    return 0;
+}
+
 static int mmap_read_frame(AVFormatContext *ctx, AVPacket *pkt)
 {
     struct video_data *s = ctx->priv_data;
@@ -558,7 +722,11 @@ static int mmap_read_frame(AVFormatContext *ctx, AVPacket *pkt)
     }
 
     /* Image is at s->buff_start[buf.index] */
-    if (atomic_load(&s->buffers_queued) == FFMAX(s->buffers / 8, 1)) {
+    if (s->output_mode != V4L_OUTPUT_PACKET) {
+        res = mmap_read_avframe(ctx, pkt, &buf);
+        if (res < 0)
+            return res;
+    } else if (atomic_load(&s->buffers_queued) == FFMAX(s->buffers / 8, 1)) {
         /* when we start getting low on queued buffers, fall back on copying data */
         res = av_new_packet(pkt, buf.bytesused);
         if (res < 0) {
@@ -657,6 +825,206 @@ static void mmap_close(struct video_data *s)
     av_freep(&s->buf_len);
 }
 
+static int frame_layout_init(AVFormatContext *ctx)
+{
+    struct video_data *s = ctx->priv_data;
+    ptrdiff_t linesizes[4];
+    size_t sizes[4];
+    size_t offset = 0;
+    int i, ret;
+
+    ret = av_image_fill_linesizes(s->linesize, s->pix_fmt, s->width);
+    if (ret < 0)
+        return ret;
+
+    /* V4L2 derives the stride of the chroma planes from the luma one */
+    if (s->bytesperline > s->linesize[0]) {
+        for (i = 1; i < 4; i++)
+            s->linesize[i] = (int64_t)s->linesize[i] * s->bytesperline /
+                             s->linesize[0];
+        s->linesize[0] = s->bytesperline;
+    }
+
+    for (i = 0; i < 4; i++)
+        linesizes[i] = s->linesize[i];
+    ret = av_image_fill_plane_sizes(sizes, s->pix_fmt, s->height, linesizes);
+    if (ret < 0)
+        return ret;
+
+    for (i = 0; i < 4 && sizes[i]; i++) {
+        s->plane_offset[i] = offset;
+        offset            += sizes[i];
+    }
+    if (offset > INT_MAX)
+        return AVERROR(EINVAL);
+
+    /* The chroma planes are stored as V, U for these */
+    if (s->pixelformat == V4L2_PIX_FMT_YVU420 ||
+        s->pixelformat == V4L2_PIX_FMT_YVU410)
+        FFSWAP(size_t, s->plane_offset[1], s->plane_offset[2]);
+
+    s->frame_size = offset;
+    return 0;
+}
+
+#if CONFIG_LIBDRM
+static const struct {
+    uint32_t v4l2_fmt;
+    uint32_t drm_format;
+} drm_formats[] = {
+    { V4L2_PIX_FMT_GREY,   DRM_FORMAT_R8       },
+    { V4L2_PIX_FMT_RGB565, DRM_FORMAT_RGB565   },
+    { V4L2_PIX_FMT_RGB24,  DRM_FORMAT_BGR888   },
+    { V4L2_PIX_FMT_BGR24,  DRM_FORMAT_RGB888   },
+    { V4L2_PIX_FMT_BGR32,  DRM_FORMAT_XRGB8888 },
+    { V4L2_PIX_FMT_RGB32,  DRM_FORMAT_BGRX8888 },
+#ifdef V4L2_PIX_FMT_XBGR32
+    { V4L2_PIX_FMT_XBGR32, DRM_FORMAT_XRGB8888 },
+    { V4L2_PIX_FMT_ABGR32, DRM_FORMAT_ARGB8888 },
+    { V4L2_PIX_FMT_XRGB32, DRM_FORMAT_BGRX8888 },
+    { V4L2_PIX_FMT_ARGB32, DRM_FORMAT_BGRA8888 },
+#endif
+    { V4L2_PIX_FMT_YUYV,   DRM_FORMAT_YUYV     },
+    { V4L2_PIX_FMT_YVYU,   DRM_FORMAT_YVYU     },
+    { V4L2_PIX_FMT_UYVY,   DRM_FORMAT_UYVY     },
+    { V4L2_PIX_FMT_NV12,   DRM_FORMAT_NV12     },
+    { V4L2_PIX_FMT_NV21,   DRM_FORMAT_NV21     },
+    { V4L2_PIX_FMT_NV16,   DRM_FORMAT_NV16     },
+    { V4L2_PIX_FMT_YUV420, DRM_FORMAT_YUV420   },
+    { V4L2_PIX_FMT_YUV422P, DRM_FORMAT_YUV422  },
+};
+
+static void drm_desc_free(void *opaque, uint8_t *data)
+{
+    AVDRMFrameDescriptor *desc = (AVDRMFrameDescriptor*)data;
+    int i;
+
+    for (i = 0; i < desc->nb_objects; i++)
+        close(desc->objects[i].fd);
+    av_free(desc);
+}
+
+static void drm_uninit(struct video_data *s)
+{
+    int i;
+
+    /* Frames still in use keep their descriptor and its fds alive */
+    if (s->drm_desc) {
+        for (i = 0; i < s->buffers; i++)
+            av_buffer_unref(&s->drm_desc[i]);
+        av_freep(&s->drm_desc);
+    }
+    av_buffer_unref(&s->frames_ref);
+    av_buffer_unref(&s->device_ref);
+}
+
+static int drm_init(AVFormatContext *ctx)
+{
+    struct video_data *s = ctx->priv_data;
+    AVHWFramesContext *frames;
+    uint32_t drm_format = 0;
+    int i, j, res;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(drm_formats); i++) {
+        if (drm_formats[i].v4l2_fmt == s->pixelformat) {
+            drm_format = drm_formats[i].drm_format;
+            break;
+        }
+    }
+    if (!drm_format) {
+        av_log(ctx, AV_LOG_ERROR, "Pixel format %s cannot be exported as "
+               "DRM PRIME frames.\n", av_get_pix_fmt_name(s->pix_fmt));
+        return AVERROR(ENOSYS);
+    }
+
+    if (s->drm_device) {
+        res = av_hwdevice_ctx_create(&s->device_ref, AV_HWDEVICE_TYPE_DRM,
+                                     s->drm_device, NULL, 0);
+        if (res < 0) {
+            av_log(ctx, AV_LOG_ERROR, "Failed to open DRM device.\n");
+            return res;
+        }
+    } else {
+        /* The frames only carry DMABUF fds, a KMS device is not needed */
+        s->device_ref = av_hwdevice_ctx_alloc(AV_HWDEVICE_TYPE_DRM);
+        if (!s->device_ref)
+            return AVERROR(ENOMEM);
+        ((AVDRMDeviceContext*)((AVHWDeviceContext*)s->device_ref->data)->hwctx)->fd = -1;
+        res = av_hwdevice_ctx_init(s->device_ref);
+        if (res < 0)
+            return res;
+    }
+
+    s->frames_ref = av_hwframe_ctx_alloc(s->device_ref);
+    if (!s->frames_ref)
+        return AVERROR(ENOMEM);
+    frames = (AVHWFramesContext*)s->frames_ref->data;
+    frames->format    = AV_PIX_FMT_DRM_PRIME;
+    frames->sw_format = s->pix_fmt;
+    frames->width     = s->width;
+    frames->height    = s->height;
+    res = av_hwframe_ctx_init(s->frames_ref);
+    if (res < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Failed to initialise hardware frames "
+               "context: %s.\n", av_err2str(res));
+        return res;
+    }
+
+    s->drm_desc = av_calloc(s->buffers, sizeof(*s->drm_desc));
+    if (!s->drm_desc)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < s->buffers; i++) {
+        AVDRMFrameDescriptor *desc;
+        AVDRMLayerDescriptor *layer;
+        struct v4l2_exportbuffer expbuf = {
+            .type  = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+            .index = i,
+            .flags = O_RDONLY,
+        };
+
+#ifdef O_CLOEXEC
+        expbuf.flags |= O_CLOEXEC;
+#endif
+
+        desc = av_mallocz(sizeof(*desc));
+        if (!desc)
+            return AVERROR(ENOMEM);
+        s->drm_desc[i] = av_buffer_create((uint8_t*)desc, sizeof(*desc),
+                                          drm_desc_free, NULL,
+                                          AV_BUFFER_FLAG_READONLY);
+        if (!s->drm_desc[i]) {
+            av_free(desc);
+            return AVERROR(ENOMEM);
+        }
+        layer = &desc->layers[0];
+
+        if (v4l2_ioctl(s->fd, VIDIOC_EXPBUF, &expbuf) < 0) {
+            res = AVERROR(errno);
+            av_log(ctx, AV_LOG_ERROR, "ioctl(VIDIOC_EXPBUF): %s\n",
+                   av_err2str(res));
+            return res;
+        }
+
+        desc->nb_objects = 1;
+        desc->objects[0].fd              = expbuf.fd;
+        desc->objects[0].size            = s->buf_len[i];
+        desc->objects[0].format_modifier = DRM_FORMAT_MOD_LINEAR;
+
+        desc->nb_layers  = 1;
+        layer->format    = drm_format;
+        layer->nb_planes = av_pix_fmt_count_planes(s->pix_fmt);
+        for (j = 0; j < layer->nb_planes; j++) {
+            layer->planes[j].object_index = 0;
+            layer->planes[j].offset       = s->plane_offset[j];
+            layer->planes[j].pitch        = s->linesize[j];
+        }
+    }
+
+    return 0;
+}
+#endif
+
 static int v4l2_set_parameters(AVFormatContext *ctx)
 {
     struct video_data *s = ctx->priv_data;
@@ -961,10 +1329,47 @@ static int v4l2_read_header(AVFormatContext *ctx)
         s->frame_size = av_image_get_buffer_size(st->codecpar->format,
                                                  s->width, s->height, 1);
 
+    if (s->output_mode != V4L_OUTPUT_PACKET) {
+        if (codec_id != AV_CODEC_ID_RAWVIDEO ||
+            st->codecpar->format == AV_PIX_FMT_NONE) {
+            av_log(ctx, AV_LOG_ERROR, "Frame output is only supported for "
+                   "raw video formats.\n");
+            res = AVERROR(EINVAL);
+            goto fail;
+        }
+        s->pix_fmt = st->codecpar->format;
+        if ((res = frame_layout_init(ctx)) < 0)
+            goto fail;
+    }
+    if (s->output_mode == V4L_OUTPUT_DRM_PRIME) {
+#if CONFIG_LIBDRM && defined(VIDIOC_EXPBUF)
+        if (s->use_libv4l2) {
+            av_log(ctx, AV_LOG_ERROR, "DRM PRIME output cannot be used "
+                   "together with libv4l2.\n");
+            res = AVERROR(EINVAL);
+            goto fail;
+        }
+#else
+        av_log(ctx, AV_LOG_ERROR, "DRM PRIME output requires libdrm and "
+               "VIDIOC_EXPBUF support.\n");
+        res = AVERROR(ENOSYS);
+        goto fail;
+#endif
+    }
+
     if ((res = mmap_init(ctx)) ||
         (res = mmap_start(ctx)) < 0)
             goto fail;
 
+#if CONFIG_LIBDRM && defined(VIDIOC_EXPBUF)
+    if (s->output_mode == V4L_OUTPUT_DRM_PRIME &&
+        (res = drm_init(ctx)) < 0) {
+        drm_uninit(s);
+        mmap_close(s);
+        goto fail;
+    }
+#endif
+
     s->top_field_first = first_field(s);
 
     st->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
@@ -979,6 +1384,13 @@ static int v4l2_read_header(AVFormatContext *ctx)
         st->codecpar->codec_tag = MKTAG('Y', 'V', '1', '2');
     else if (desired_format == V4L2_PIX_FMT_YVU410)
         st->codecpar->codec_tag = MKTAG('Y', 'V', 'U', '9');
+    if (s->output_mode != V4L_OUTPUT_PACKET) {
+        ctx->video_codec_id     = AV_CODEC_ID_WRAPPED_AVFRAME;
+        st->codecpar->codec_id  = AV_CODEC_ID_WRAPPED_AVFRAME;
+        st->codecpar->codec_tag = 0;
+        if (s->output_mode == V4L_OUTPUT_DRM_PRIME)
+            st->codecpar->format = AV_PIX_FMT_DRM_PRIME;
+    }
     st->codecpar->width = s->width;
     st->codecpar->height = s->height;
     if (st->avg_frame_rate.den)
@@ -1011,6 +1423,9 @@ static int v4l2_read_close(AVFormatContext *ctx)
                "close.\n");
 
     mmap_close(s);
+#if CONFIG_LIBDRM
+    drm_uninit(s);
+#endif
 
     ff_timefilter_destroy(s->timefilter);
     v4l2_close(s->fd);
@@ -1123,6 +1538,11 @@ static const AVOption options[] = {
     { "abs",          "use absolute timestamps (wall clock)",                     OFFSET(ts_mode),      AV_OPT_TYPE_CONST,  {.i64 = V4L_TS_ABS      }, 0, 2, DEC, "timestamps" },
     { "mono2abs",     "force conversion from monotonic to absolute timestamps",   OFFSET(ts_mode),      AV_OPT_TYPE_CONST,  {.i64 = V4L_TS_MONO2ABS }, 0, 2, DEC, "timestamps" },
     { "use_libv4l2",  "use libv4l2 (v4l-utils) conversion functions",             OFFSET(use_libv4l2),  AV_OPT_TYPE_BOOL,   {.i64 = 0}, 0, 1, DEC },
+    { "output_mode",  "set how the captured images are returned",                 OFFSET(output_mode),  AV_OPT_TYPE_INT,    {.i64 = V4L_OUTPUT_PACKET }, 0, 2, DEC, "output_mode" },
+    { "packet",       "return raw video packets",                                 OFFSET(output_mode),  AV_OPT_TYPE_CONST,  {.i64 = V4L_OUTPUT_PACKET    }, 0, 2, DEC, "output_mode" },
+    { "frame",        "return frames referencing the capture buffers",            OFFSET(output_mode),  AV_OPT_TYPE_CONST,  {.i64 = V4L_OUTPUT_FRAME     }, 0, 2, DEC, "output_mode" },
+    { "drm_prime",    "return DRM PRIME frames exported from the capture buffers", OFFSET(output_mode), AV_OPT_TYPE_CONST,  {.i64 = V4L_OUTPUT_DRM_PRIME }, 0, 2, DEC, "output_mode" },
+    { "drm_device",   "set the DRM device used for DRM PRIME output",             OFFSET(drm_device),   AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, DEC },
     { NULL },
 };
 
@@ -18,17 +18,223 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <poll.h>
+
+#include "libavutil/frame.h"
 #include "libavutil/imgutils.h"
+#include "libavutil/mathematics.h"
+#include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 #include "libavformat/avformat.h"
 #include "libavformat/mux.h"
 #include "v4l2-common.h"
 
+#define V4L2_IO_WRITE 0
+#define V4L2_IO_MMAP  1
+
+/* how long to wait for each queued buffer when draining at the end */
+#define V4L2_DRAIN_TIMEOUT_MS 1000
+
 typedef struct {
     AVClass *class;
     int fd;
+    int io_mode;        /**< Set by a private option. */
+    int nb_buffers;     /**< Set by a private option. */
+
+    enum AVPixelFormat pix_fmt;
+    int width, height;
+    int linesize[4];
+    size_t plane_offset[4];
+    unsigned int frame_size;
+
+    int buffers;
+    int buffers_used;   /**< number of buffers handed to the driver at least once */
+    int buffers_queued; /**< number of buffers currently owned by the driver */
+    int streaming;
+    void **buf_start;
+    unsigned int *buf_len;
+
+    uint8_t *frame_buf;
+    unsigned int frame_buf_size;
 } V4L2Context;
 
+/**
+ * Compute the plane layout of an image in a device buffer, which may use
+ * a larger stride than the image itself.
+ */
+static int image_layout_init(AVFormatContext *s1, int bytesperline)
+{
+    V4L2Context *s = s1->priv_data;
+    ptrdiff_t linesizes[4];
+    size_t sizes[4];
+    size_t offset = 0;
+    int i, ret;
+
+    ret = av_image_fill_linesizes(s->linesize, s->pix_fmt, s->width);
+    if (ret < 0)
+        return ret;
+
+    /* V4L2 derives the stride of the chroma planes from the luma one */
+    if (bytesperline > s->linesize[0]) {
+        for (i = 1; i < 4; i++)
+            s->linesize[i] = (int64_t)s->linesize[i] * bytesperline /
+                             s->linesize[0];
+        s->linesize[0] = bytesperline;
+    }
+
+    for (i = 0; i < 4; i++)
+        linesizes[i] = s->linesize[i];
+    ret = av_image_fill_plane_sizes(sizes, s->pix_fmt, s->height, linesizes);
+    if (ret < 0)
+        return ret;
+
+    for (i = 0; i < 4 && sizes[i]; i++) {
+        s->plane_offset[i] = offset;
+        offset            += sizes[i];
+    }
+    if (offset > INT_MAX)
+        return AVERROR(EINVAL);
+    s->frame_size = offset;
+
+    return 0;
+}
+
+static int mmap_init(AVFormatContext *s1)
+{
+    V4L2Context *s = s1->priv_data;
+    struct v4l2_requestbuffers req = {
+        .type   = V4L2_BUF_TYPE_VIDEO_OUTPUT,
+        .count  = s->nb_buffers,
+        .memory = V4L2_MEMORY_MMAP
+    };
+    int i, res;
+
+    if (ioctl(s->fd, VIDIOC_REQBUFS, &req) < 0) {
+        res = AVERROR(errno);
+        av_log(s1, AV_LOG_ERROR, "ioctl(VIDIOC_REQBUFS): %s\n", av_err2str(res));
+        return res;
+    }
+    if (req.count < 1) {
+        av_log(s1, AV_LOG_ERROR, "Insufficient buffer memory\n");
+        return AVERROR(ENOMEM);
+    }
+    if (req.count != s->nb_buffers)
+        av_log(s1, AV_LOG_VERBOSE, "The driver allocated %d buffers instead "
+               "of %d\n", req.count, s->nb_buffers);
+
+    s->buf_start = av_calloc(req.count, sizeof(*s->buf_start));
+    s->buf_len   = av_calloc(req.count, sizeof(*s->buf_len));
+    if (!s->buf_start || !s->buf_len)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < req.count; i++) {
+        struct v4l2_buffer buf = {
+            .type   = V4L2_BUF_TYPE_VIDEO_OUTPUT,
+            .index  = i,
+            .memory = V4L2_MEMORY_MMAP
+        };
+
+        if (ioctl(s->fd, VIDIOC_QUERYBUF, &buf) < 0) {
+            res = AVERROR(errno);
+            av_log(s1, AV_LOG_ERROR, "ioctl(VIDIOC_QUERYBUF): %s\n", av_err2str(res));
+            return res;
+        }
+
+        s->buf_start[i] = mmap(NULL, buf.length, PROT_READ | PROT_WRITE,
+                               MAP_SHARED, s->fd, buf.m.offset);
+        if (s->buf_start[i] == MAP_FAILED) {
+            s->buf_start[i] = NULL;
+            res = AVERROR(errno);
+            av_log(s1, AV_LOG_ERROR, "mmap: %s\n", av_err2str(res));
+            return res;
+        }
+        s->buf_len[i] = buf.length;
+        s->buffers++;
+    }
+
+    return 0;
+}
+
+/**
+ * Wait until a buffer can be dequeued.
+ *
+ * @param timeout timeout in milliseconds, negative to wait indefinitely
+ * @return 0 on success, AVERROR(ETIMEDOUT) on timeout, a negative
+ *         AVERROR on error
+ */
+static int wait_buffer(AVFormatContext *s1, int timeout)
+{
+    V4L2Context *s = s1->priv_data;
+    struct pollfd p = { .fd = s->fd, .events = POLLOUT };
+    int res;
+
+    while ((res = poll(&p, 1, timeout)) < 0 && errno == EINTR);
+    if (res < 0) {
+        res = AVERROR(errno);
+        av_log(s1, AV_LOG_ERROR, "poll: %s\n", av_err2str(res));
+        return res;
+    }
+    if (!res)
+        return AVERROR(ETIMEDOUT);
+    if (p.revents & (POLLERR | POLLHUP | POLLNVAL))
+        return AVERROR(EIO);
+    return 0;
+}
+
+static int dequeue_buffer(AVFormatContext *s1, struct v4l2_buffer *buf)
+{
+    V4L2Context *s = s1->priv_data;
+    int res;
+
+    while ((res = ioctl(s->fd, VIDIOC_DQBUF, buf)) < 0 && errno == EINTR);
+    if (res < 0)
+        return AVERROR(errno);
+    s->buffers_queued--;
+    return 0;
+}
+
+/**
+ * Wait for the driver to be done with all queued buffers, so that the
+ * last frames are not dropped when streaming is stopped.
+ */
+static void mmap_drain(AVFormatContext *s1)
+{
+    V4L2Context *s = s1->priv_data;
+
+    while (s->buffers_queued > 0) {
+        struct v4l2_buffer buf = {
+            .type   = V4L2_BUF_TYPE_VIDEO_OUTPUT,
+            .memory = V4L2_MEMORY_MMAP
+        };
+        int res = wait_buffer(s1, V4L2_DRAIN_TIMEOUT_MS);
+
+        if (res >= 0)
+            res = dequeue_buffer(s1, &buf);
+        if (res < 0) {
+            av_log(s1, AV_LOG_WARNING, "%d queued frames may not have been "
+                   "output: %s\n", s->buffers_queued, av_err2str(res));
+            return;
+        }
+    }
+}
+
+static void mmap_close(AVFormatContext *s1)
+{
+    V4L2Context *s = s1->priv_data;
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    int i;
+
+    if (s->streaming) {
+        mmap_drain(s1);
+        ioctl(s->fd, VIDIOC_STREAMOFF, &type);
+    }
+    for (i = 0; i < s->buffers; i++)
+        munmap(s->buf_start[i], s->buf_len[i]);
+    s->buffers = 0;
+    av_freep(&s->buf_start);
+    av_freep(&s->buf_len);
+}
+
 static av_cold int write_header(AVFormatContext *s1)
 {
     int res = 0, flags = O_RDWR;
@@ -58,7 +264,8 @@ static av_cold int write_header(AVFormatContext *s1)
 
     par = s1->streams[0]->codecpar;
 
-    if(par->codec_id == AV_CODEC_ID_RAWVIDEO) {
+    if (par->codec_id == AV_CODEC_ID_RAWVIDEO ||
+        par->codec_id == AV_CODEC_ID_WRAPPED_AVFRAME) {
         v4l2_pixfmt = ff_fmt_ff2v4l(par->format, AV_CODEC_ID_RAWVIDEO);
     } else {
         v4l2_pixfmt = ff_fmt_ff2v4l(AV_PIX_FMT_NONE, par->codec_id);
@@ -87,27 +294,244 @@ static av_cold int write_header(AVFormatContext *s1)
         return res;
     }
 
+    if (par->codec_id == AV_CODEC_ID_RAWVIDEO ||
+        par->codec_id == AV_CODEC_ID_WRAPPED_AVFRAME) {
+        s->pix_fmt = par->format;
+        s->width   = par->width;
+        s->height  = par->height;
+        /* The write() interface takes tightly packed images */
+        res = image_layout_init(s1, s->io_mode == V4L2_IO_MMAP ?
+                                    fmt.fmt.pix.bytesperline : 0);
+        if (res < 0)
+            return res;
+    }
+
+    if (s->io_mode == V4L2_IO_MMAP)
+        return mmap_init(s1);
+
     return res;
 }
 
-static int write_packet(AVFormatContext *s1, AVPacket *pkt)
+/**
+ * Get a buffer to fill, either one which was never queued or one
+ * which the driver is done with.
+ */
+static int get_buffer(AVFormatContext *s1, int *index)
 {
-    const V4L2Context *s = s1->priv_data;
-    if (write(s->fd, pkt->data, pkt->size) == -1)
-        return AVERROR(errno);
+    V4L2Context *s = s1->priv_data;
+    struct v4l2_buffer buf = {
+        .type   = V4L2_BUF_TYPE_VIDEO_OUTPUT,
+        .memory = V4L2_MEMORY_MMAP
+    };
+    int res;
+
+    if (s->buffers_used < s->buffers) {
+        *index = s->buffers_used++;
+        return 0;
+    }
+
+    /* The muxing API does not retry a packet on EAGAIN, so block until
+     * the driver releases a buffer, even on a non-blocking device. */
+    while ((res = dequeue_buffer(s1, &buf)) == AVERROR(EAGAIN)) {
+        if ((res = wait_buffer(s1, -1)) < 0)
+            break;
+    }
+    if (res < 0) {
+        av_log(s1, AV_LOG_ERROR, "ioctl(VIDIOC_DQBUF): %s\n", av_err2str(res));
+        return res;
+    }
+    if (buf.index >= s->buffers) {
+        av_log(s1, AV_LOG_ERROR, "Invalid buffer index received.\n");
+        return AVERROR(EINVAL);
+    }
+
+    *index = buf.index;
+    return 0;
+}
+
+static int queue_buffer(AVFormatContext *s1, int index, unsigned int size,
+                        int64_t pts)
+{
+    V4L2Context *s = s1->priv_data;
+    struct v4l2_buffer buf = {
+        .type      = V4L2_BUF_TYPE_VIDEO_OUTPUT,
+        .memory    = V4L2_MEMORY_MMAP,
+        .index     = index,
+        .bytesused = size,
+        .field     = V4L2_FIELD_NONE,
+    };
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    int res;
+
+    if (pts != AV_NOPTS_VALUE) {
+        pts = av_rescale_q(pts, s1->streams[0]->time_base, AV_TIME_BASE_Q);
+        buf.timestamp.tv_sec  = pts / AV_TIME_BASE;
+        buf.timestamp.tv_usec = pts % AV_TIME_BASE;
+    }
+
+    if (ioctl(s->fd, VIDIOC_QBUF, &buf) < 0) {
+        res = AVERROR(errno);
+        av_log(s1, AV_LOG_ERROR, "ioctl(VIDIOC_QBUF): %s\n", av_err2str(res));
+        return res;
+    }
+    s->buffers_queued++;
+
+    if (!s->streaming) {
+        if (ioctl(s->fd, VIDIOC_STREAMON, &type) < 0) {
+            res = AVERROR(errno);
+            av_log(s1, AV_LOG_ERROR, "ioctl(VIDIOC_STREAMON): %s\n", av_err2str(res));
+            return res;
+        }
+        s->streaming = 1;
+    }
+
     return 0;
 }
 
+/**
+ * Check that a frame matches the format the device was configured with,
+ * since it is copied with that format's layout.
+ */
+static int check_frame(AVFormatContext *s1, const AVFrame *frame)
+{
+    V4L2Context *s = s1->priv_data;
+
+    if (frame->format != s->pix_fmt ||
+        frame->width  != s->width   ||
+        frame->height != s->height) {
+        av_log(s1, AV_LOG_ERROR, "Frame %dx%d %s does not match the configured "
+               "%dx%d %s; the format cannot change mid-stream\n",
+               frame->width, frame->height,
+               (char *)av_x_if_null(av_get_pix_fmt_name(frame->format), "none"),
+               s->width, s->height,
+               (char *)av_x_if_null(av_get_pix_fmt_name(s->pix_fmt), "none"));
+        return AVERROR(EINVAL);
+    }
+    return 0;
+}
+
+static int write_picture(AVFormatContext *s1, const uint8_t *data[4],
+                         const int linesize[4], int64_t pts)
+{
+    V4L2Context *s = s1->priv_data;
+    uint8_t *dst[4] = { NULL };
+    int dst_linesize[4];
+    int i, index, res;
+
+    if (s->io_mode == V4L2_IO_WRITE) {
+        av_fast_malloc(&s->frame_buf, &s->frame_buf_size, s->frame_size);
+        if (!s->frame_buf)
+            return AVERROR(ENOMEM);
+        res = av_image_copy_to_buffer(s->frame_buf, s->frame_size, data, linesize,
+                                      s->pix_fmt, s->width, s->height, 1);
+        if (res < 0)
+            return res;
+        if (write(s->fd, s->frame_buf, s->frame_size) == -1)
+            return AVERROR(errno);
+        return 0;
+    }
+
+    if ((res = get_buffer(s1, &index)) < 0)
+        return res;
+    if (s->frame_size > s->buf_len[index])
+        return AVERROR(EINVAL);
+
+    /* Render straight into the device buffer */
+    for (i = 0; i < 4 && s->linesize[i]; i++) {
+        dst[i]          = (uint8_t *)s->buf_start[index] + s->plane_offset[i];
+        dst_linesize[i] = s->linesize[i];
+    }
+    av_image_copy(dst, dst_linesize, data, linesize,
+                  s->pix_fmt, s->width, s->height);
+
+    return queue_buffer(s1, index, s->frame_size, pts);
+}
+
+static int write_packet(AVFormatContext *s1, AVPacket *pkt)
+{
+    V4L2Context *s = s1->priv_data;
+    AVCodecParameters *par = s1->streams[0]->codecpar;
+    int index, res;
+
+    if (par->codec_id == AV_CODEC_ID_WRAPPED_AVFRAME) {
+        AVFrame *frame = (AVFrame *)pkt->data;
+        if ((res = check_frame(s1, frame)) < 0)
+            return res;
+        return write_picture(s1, (const uint8_t **)frame->data,
+                             frame->linesize, pkt->pts);
+    }
+
+    if (s->io_mode == V4L2_IO_WRITE) {
+        if (write(s->fd, pkt->data, pkt->size) == -1)
+            return AVERROR(errno);
+        return 0;
+    }
+
+    if (par->codec_id == AV_CODEC_ID_RAWVIDEO &&
+        s->linesize[0] != av_image_get_linesize(s->pix_fmt, s->width, 0)) {
+        uint8_t *data[4];
+        int linesize[4];
+
+        res = av_image_fill_arrays(data, linesize, pkt->data, s->pix_fmt,
+                                   s->width, s->height, 1);
+        if (res < 0)
+            return res;
+        if (res > pkt->size)
+            return AVERROR(EINVAL);
+        return write_picture(s1, (const uint8_t **)data, linesize, pkt->pts);
+    }
+
+    if ((res = get_buffer(s1, &index)) < 0)
+        return res;
+    if (pkt->size > s->buf_len[index]) {
+        av_log(s1, AV_LOG_ERROR, "Packet of %d bytes does not fit in a %u "
+               "bytes buffer\n", pkt->size, s->buf_len[index]);
+        return AVERROR(EINVAL);
+    }
+    memcpy(s->buf_start[index], pkt->data, pkt->size);
+
+    return queue_buffer(s1, index, pkt->size, pkt->pts);
+}
+
+static int write_frame(AVFormatContext *s1, int stream_index, AVFrame **frame,
+                       unsigned flags)
+{
+    V4L2Context *s = s1->priv_data;
+    int res;
+
+    if (flags & AV_WRITE_UNCODED_FRAME_QUERY)
+        return s->frame_size ? 0 : AVERROR(ENOSYS);
+    if ((res = check_frame(s1, *frame)) < 0)
+        return res;
+    return write_picture(s1, (const uint8_t **)(*frame)->data,
+                         (*frame)->linesize, (*frame)->pts);
+}
+
 static int write_trailer(AVFormatContext *s1)
 {
-    const V4L2Context *s = s1->priv_data;
+    V4L2Context *s = s1->priv_data;
+
+    mmap_close(s1);
+    av_freep(&s->frame_buf);
     close(s->fd);
     return 0;
 }
 
+#define OFFSET(x) offsetof(V4L2Context, x)
+#define ENC AV_OPT_FLAG_ENCODING_PARAM
+
+static const AVOption options[] = {
+    { "io_mode", "set the I/O method used to pass frames to the device", OFFSET(io_mode),    AV_OPT_TYPE_INT, {.i64 = V4L2_IO_WRITE}, 0, 1,   ENC, "io_mode" },
+    { "write",   "write() each frame to the device",                     OFFSET(io_mode),    AV_OPT_TYPE_CONST, {.i64 = V4L2_IO_WRITE}, 0, 0, ENC, "io_mode" },
+    { "mmap",    "queue memory mapped streaming buffers",                OFFSET(io_mode),    AV_OPT_TYPE_CONST, {.i64 = V4L2_IO_MMAP},  0, 0, ENC, "io_mode" },
+    { "buffers", "set the number of streaming buffers to request",       OFFSET(nb_buffers), AV_OPT_TYPE_INT, {.i64 = 4}, 1, 32, ENC },
+    { NULL },
+};
+
 static const AVClass v4l2_class = {
     .class_name = "V4L2 outdev",
     .item_name  = av_default_item_name,
+    .option     = options,
     .version    = LIBAVUTIL_VERSION_INT,
     .category   = AV_CLASS_CATEGORY_DEVICE_VIDEO_OUTPUT,
 };
@@ -120,6 +544,7 @@ const FFOutputFormat ff_v4l2_muxer = {
     .p.video_codec  = AV_CODEC_ID_RAWVIDEO,
     .write_header   = write_header,
     .write_packet   = write_packet,
+    .write_uncoded_frame = write_frame,
     .write_trailer  = write_trailer,
     .p.flags        = AVFMT_NOFILE,
     .p.priv_class   = &v4l2_class,
@@ -49,6 +49,12 @@
 #define INPUT_ON       1    /**< input is active */
 #define INPUT_EOF      2    /**< input has reached EOF (may still be active) */
 
+/* Mixing all the inputs block by block keeps the output in the L1 cache, but
+ * reads each input in as many pieces as there are blocks, which only pays
+ * off for a few inputs. */
+#define BLOCKED_MAX_INPUTS 4
+#define BLOCK_SIZE         8192     /**< bytes per plane of a block */
+
 #define DURATION_LONGEST  0
 #define DURATION_SHORTEST 1
 #define DURATION_FIRST    2
@@ -169,6 +175,7 @@ typedef struct MixContext {
     int nb_channels;            /**< number of channels */
     int sample_rate;            /**< sample rate */
     int planar;
+    int block_samples;          /**< samples mixed per block with few inputs */
     AVAudioFifo **fifos;        /**< audio fifo for each input */
     uint8_t *input_state;       /**< current state of each input */
     float *input_scale;         /**< mixing scale factor for each input */
@@ -262,6 +269,8 @@ static int config_output(AVFilterLink *outlink)
         return AVERROR(ENOMEM);
 
     s->nb_channels = outlink->ch_layout.nb_channels;
+    s->block_samples = FFMAX(BLOCK_SIZE / (av_get_bytes_per_sample(outlink->format) *
+                                           (s->planar ? 1 : s->nb_channels)) & ~15, 16);
     for (i = 0; i < s->nb_inputs; i++) {
         s->fifos[i] = av_audio_fifo_alloc(outlink->format, s->nb_channels, 1024);
         if (!s->fifos[i])
@@ -291,6 +300,31 @@ static int config_output(AVFilterLink *outlink)
     return 0;
 }
 
+/**
+ * Add nb_samples samples of in, scaled, to out from sample offset on.
+ */
+static void mix_samples(MixContext *s, AVFrame *out, const AVFrame *in,
+                        float scale, int offset, int nb_samples)
+{
+    int planes = s->planar ? s->nb_channels : 1;
+    int stride = s->planar ? 1 : s->nb_channels;
+    int len    = FFALIGN(nb_samples * stride, 16);
+    int p;
+
+    if (out->format == AV_SAMPLE_FMT_FLT ||
+        out->format == AV_SAMPLE_FMT_FLTP) {
+        for (p = 0; p < planes; p++)
+            s->fdsp->vector_fmac_scalar((float *)out->extended_data[p] + offset * stride,
+                                        (const float *)in->extended_data[p],
+                                        scale, len);
+    } else {
+        for (p = 0; p < planes; p++)
+            s->fdsp->vector_dmac_scalar((double *)out->extended_data[p] + offset * stride,
+                                        (const double *)in->extended_data[p],
+                                        scale, len);
+    }
+}
+
 /**
  * Read samples from the input FIFOs, mix, and write to the output link.
  */
@@ -299,7 +333,7 @@ static int output_frame(AVFilterLink *outlink)
     AVFilterContext *ctx = outlink->src;
     MixContext      *s = ctx->priv;
     AVFrame *out_buf, *in_buf;
-    int nb_samples, ns, i;
+    int nb_samples, ns, i, start, block;
 
     if (s->input_state[0] & INPUT_ON) {
         /* first input live: use the corresponding frame size */
@@ -344,39 +378,28 @@ static int output_frame(AVFilterLink *outlink)
     if (!out_buf)
         return AVERROR(ENOMEM);
 
-    in_buf = ff_get_audio_buffer(outlink, nb_samples);
+    block  = s->nb_inputs <= BLOCKED_MAX_INPUTS ? s->block_samples : nb_samples;
+    in_buf = ff_get_audio_buffer(outlink, FFMIN(block, nb_samples));
     if (!in_buf) {
         av_frame_free(&out_buf);
         return AVERROR(ENOMEM);
     }
 
-    for (i = 0; i < s->nb_inputs; i++) {
-        if (s->input_state[i] & INPUT_ON) {
-            int planes, plane_size, p;
-
-            av_audio_fifo_read(s->fifos[i], (void **)in_buf->extended_data,
-                               nb_samples);
-
-            planes     = s->planar ? s->nb_channels : 1;
-            plane_size = nb_samples * (s->planar ? 1 : s->nb_channels);
-            plane_size = FFALIGN(plane_size, 16);
+    for (start = 0; start < nb_samples; start += block) {
+        int n = FFMIN(block, nb_samples - start);
 
-            if (out_buf->format == AV_SAMPLE_FMT_FLT ||
-                out_buf->format == AV_SAMPLE_FMT_FLTP) {
-                for (p = 0; p < planes; p++) {
-                    s->fdsp->vector_fmac_scalar((float *)out_buf->extended_data[p],
-                                                (float *) in_buf->extended_data[p],
-                                                s->input_scale[i], plane_size);
-                }
-            } else {
-                for (p = 0; p < planes; p++) {
-                    s->fdsp->vector_dmac_scalar((double *)out_buf->extended_data[p],
-                                                (double *) in_buf->extended_data[p],
-                                                s->input_scale[i], plane_size);
-                }
+        for (i = 0; i < s->nb_inputs; i++) {
+            if (s->input_state[i] & INPUT_ON) {
+                av_audio_fifo_peek_at(s->fifos[i], (void **)in_buf->extended_data,
+                                      n, start);
+                mix_samples(s, out_buf, in_buf, s->input_scale[i], start, n);
             }
         }
     }
+    for (i = 0; i < s->nb_inputs; i++) {
+        if (s->input_state[i] & INPUT_ON)
+            av_audio_fifo_drain(s->fifos[i], nb_samples);
+    }
     av_frame_free(&in_buf);
 
     out_buf->pts = s->next_pts;
@@ -433,7 +456,7 @@ static int activate(AVFilterContext *ctx)
     AVFilterLink *outlink = ctx->outputs[0];
     MixContext *s = ctx->priv;
     AVFrame *buf = NULL;
-    int i, ret;
+    int i, ret, consumed = 0;
 
     FF_FILTER_FORWARD_STATUS_BACK_ALL(outlink, ctx);
 
@@ -441,6 +464,7 @@ static int activate(AVFilterContext *ctx)
         AVFilterLink *inlink = ctx->inputs[i];
 
         if ((ret = ff_inlink_consume_frame(ctx->inputs[i], &buf)) > 0) {
+            consumed = 1;
             if (i == 0) {
                 int64_t pts = av_rescale_q(buf->pts, inlink->time_base,
                                            outlink->time_base);
@@ -459,13 +483,18 @@ static int activate(AVFilterContext *ctx)
             }
 
             av_frame_free(&buf);
-
-            ret = output_frame(outlink);
-            if (ret < 0)
-                return ret;
         }
     }
 
+    /* Mix once after gathering the new frames of all inputs rather than
+     * after each of them, as output_frame() has to check every input. */
+    if (consumed) {
+        ret = output_frame(outlink);
+        if (ret < 0)
+            return ret;
+        ff_filter_set_ready(ctx, 10);
+    }
+
     for (i = 0; i < s->nb_inputs; i++) {
         int64_t pts;
         int status;
@@ -141,6 +141,11 @@ static int config_output(AVFilterLink *outlink)
     if (ret < 0)
         return ret;
 
+    /* Only use the graph threads if they were requested for this filter,
+     * most audio streams are too light to benefit from them. */
+    if (ctx->nb_threads > 0)
+        av_opt_set_int(aresample->swr, "threads", ff_filter_get_nb_threads(ctx), 0);
+
     ret = swr_init(aresample->swr);
     if (ret < 0)
         return ret;
@@ -63,6 +63,9 @@ typedef struct LoudNormContext {
     int linear;
     int dual_mono;
     enum PrintFormat print_format;
+    int64_t lookahead;
+    int lookahead_frames;
+    int gauss_radius;
 
     double *buf;
     int buf_size;
@@ -120,6 +123,7 @@ static const AVOption loudnorm_options[] = {
     {     "none",         0,                                   0,                        AV_OPT_TYPE_CONST,   {.i64 =  NONE},     0,         0,  FLAGS, "print_format" },
     {     "json",         0,                                   0,                        AV_OPT_TYPE_CONST,   {.i64 =  JSON},     0,         0,  FLAGS, "print_format" },
     {     "summary",      0,                                   0,                        AV_OPT_TYPE_CONST,   {.i64 =  SUMMARY},  0,         0,  FLAGS, "print_format" },
+    { "lookahead",        "set dynamic mode lookahead",        OFFSET(lookahead),        AV_OPT_TYPE_DURATION, {.i64 = 3000000}, 400000, 3000000, FLAGS },
     { NULL }
 };
 
@@ -134,32 +138,36 @@ static inline int frame_size(int sample_rate, int frame_len_msec)
 static void init_gaussian_filter(LoudNormContext *s)
 {
     double total_weight = 0.0;
-    const double sigma = 3.5;
+    const double sigma = 3.5 * s->gauss_radius / 10.;
     double adjust;
     int i;
 
-    const int offset = 21 / 2;
+    const int offset = s->gauss_radius;
     const double c1 = 1.0 / (sigma * sqrt(2.0 * M_PI));
     const double c2 = 2.0 * pow(sigma, 2.0);
 
-    for (i = 0; i < 21; i++) {
+    for (i = 0; i < 2 * offset + 1; i++) {
         const int x = i - offset;
         s->weights[i] = c1 * exp(-(pow(x, 2.0) / c2));
         total_weight += s->weights[i];
     }
 
     adjust = 1.0 / total_weight;
-    for (i = 0; i < 21; i++)
+    for (i = 0; i < 2 * offset + 1; i++)
         s->weights[i] *= adjust;
 }
 
-static double gaussian_filter(LoudNormContext *s, int index)
+/**
+ * Smooth the gain deltas with a window starting offset frames after the
+ * frame being output, which lags lookahead_frames behind the newest delta.
+ */
+static double gaussian_filter(LoudNormContext *s, int offset)
 {
     double result = 0.;
-    int i;
+    int index, i;
 
-    index = index - 10 > 0 ? index - 10 : index + 20;
-    for (i = 0; i < 21; i++)
+    index = (s->index + 30 - s->lookahead_frames + offset) % 30;
+    for (i = 0; i < 2 * s->gauss_radius + 1; i++)
         result += s->delta[((index + i) < 30) ? (index + i) : (index + i - 30)] * s->weights[i];
 
     return result;
@@ -442,7 +450,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 
     ff_ebur128_add_frames_double(s->r128_in, src, in->nb_samples);
 
-    if (s->frame_type == FIRST_FRAME && in->nb_samples < frame_size(inlink->sample_rate, 3000)) {
+    if (s->frame_type == FIRST_FRAME && in->nb_samples < frame_size(inlink->sample_rate, s->lookahead_frames * 100)) {
         double offset, offset_tp, true_peak;
 
         ff_ebur128_loudness_global(s->r128_in, &global);
@@ -469,7 +477,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
             s->buf_index += inlink->ch_layout.nb_channels;
         }
 
-        ff_ebur128_loudness_shortterm(s->r128_in, &shortterm);
+        ff_ebur128_loudness_window(s->r128_in, s->lookahead_frames * 100, &shortterm);
 
         if (shortterm < s->measured_thresh) {
             s->above_threshold = 0;
@@ -507,8 +515,8 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
         break;
 
     case INNER_FRAME:
-        gain      = gaussian_filter(s, s->index + 10 < 30 ? s->index + 10 : s->index + 10 - 30);
-        gain_next = gaussian_filter(s, s->index + 11 < 30 ? s->index + 11 : s->index + 11 - 30);
+        gain      = gaussian_filter(s, 0);
+        gain_next = gaussian_filter(s, 1);
 
         for (n = 0; n < in->nb_samples; n++) {
             for (c = 0; c < inlink->ch_layout.nb_channels; c++) {
@@ -568,7 +576,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
         break;
 
     case FINAL_FRAME:
-        gain = gaussian_filter(s, s->index + 10 < 30 ? s->index + 10 : s->index + 10 - 30);
+        gain = gaussian_filter(s, 0);
         s->limiter_buf_index = 0;
         src_index = 0;
 
@@ -689,7 +697,7 @@ static int activate(AVFilterContext *ctx)
         int nb_samples;
 
         if (s->frame_type == FIRST_FRAME) {
-            nb_samples = frame_size(inlink->sample_rate, 3000);
+            nb_samples = frame_size(inlink->sample_rate, s->lookahead_frames * 100);
         } else {
             nb_samples = frame_size(inlink->sample_rate, 100);
         }
@@ -770,7 +778,7 @@ static int config_input(AVFilterLink *inlink)
         ff_ebur128_set_channel(s->r128_out, 0, FF_EBUR128_DUAL_MONO);
     }
 
-    s->buf_size = frame_size(inlink->sample_rate, 3000) * inlink->ch_layout.nb_channels;
+    s->buf_size = frame_size(inlink->sample_rate, s->lookahead_frames * 100) * inlink->ch_layout.nb_channels;
     s->buf = av_malloc_array(s->buf_size, sizeof(*s->buf));
     if (!s->buf)
         return AVERROR(ENOMEM);
@@ -805,6 +813,9 @@ static av_cold int init(AVFilterContext *ctx)
     LoudNormContext *s = ctx->priv;
     s->frame_type = FIRST_FRAME;
 
+    s->lookahead_frames = s->lookahead / 100000;
+    s->gauss_radius = s->lookahead_frames / 3;
+
     if (s->linear) {
         double offset, offset_tp;
         offset    = s->target_i - s->measured_i;
@@ -28,6 +28,7 @@
 #include "libavutil/eval.h"
 #include "libavutil/frame.h"
 #include "libavutil/hwcontext.h"
+#include "libavutil/imgutils.h"
 #include "libavutil/internal.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
@@ -203,7 +204,18 @@ void avfilter_link_free(AVFilterLink **link)
 
 void ff_filter_set_ready(AVFilterContext *filter, unsigned priority)
 {
-    filter->ready = FFMAX(filter->ready, priority);
+    AVFilterGraph *graph = filter->graph;
+
+    if (!graph) {
+        filter->ready = FFMAX(filter->ready, priority);
+        return;
+    }
+    ff_graph_lock(graph);
+    if (priority > filter->ready) {
+        filter->ready = priority;
+        ff_filter_graph_update_ready(graph, filter);
+    }
+    ff_graph_unlock(graph);
 }
 
 /**
@@ -537,13 +549,25 @@ static int set_enable_expr(AVFilterContext *ctx, const char *expr)
 
 void ff_update_link_current_pts(AVFilterLink *link, int64_t pts)
 {
+    int64_t pts_us;
+
     if (pts == AV_NOPTS_VALUE)
         return;
-    link->current_pts = pts;
-    link->current_pts_us = av_rescale_q(pts, link->time_base, AV_TIME_BASE_Q);
+    pts_us = av_rescale_q(pts, link->time_base, AV_TIME_BASE_Q);
+    if (!link->graph) {
+        link->current_pts    = pts;
+        link->current_pts_us = pts_us;
+        return;
+    }
+    /* Sink links are the keys of the graph heap, which other graph workers
+     * reorder during a batch: update them under the same lock. */
+    ff_graph_lock(link->graph);
+    link->current_pts    = pts;
+    link->current_pts_us = pts_us;
     /* TODO use duration */
-    if (link->graph && link->age_index >= 0)
+    if (link->age_index >= 0)
         ff_avfilter_graph_update_heap(link->graph, link);
+    ff_graph_unlock(link->graph);
 }
 
 int avfilter_process_command(AVFilterContext *filter, const char *cmd, const char *arg, char *res, int res_len, int flags)
@@ -560,6 +584,11 @@ int avfilter_process_command(AVFilterContext *filter, const char *cmd, const cha
             av_log(filter, AV_LOG_INFO, "%s", res);
         return 0;
     }else if(!strcmp(cmd, "enable")) {
+        if (filter->internal->fuse) {
+            int ret = filter->internal->fuse(filter, NULL);
+            if (ret < 0)
+                return ret;
+        }
         return set_enable_expr(filter, arg);
     }else if(filter->filter->process_command) {
         return filter->filter->process_command(filter, cmd, arg, res, res_len, flags);
@@ -671,6 +700,7 @@ AVFilterContext *ff_filter_alloc(const AVFilter *filter, const char *inst_name)
     if (!ret->internal)
         goto err;
     ret->internal->execute = default_execute;
+    ret->internal->ready_index = -1;
 
     ret->nb_inputs  = filter->nb_inputs;
     if (ret->nb_inputs ) {
@@ -1248,7 +1278,8 @@ static int ff_filter_activate_default(AVFilterContext *filter)
      ff_avfilter_link_set_out_status().
 
    Filters are activated according to the ready field, set using the
-   ff_filter_set_ready(). Eventually, a priority queue will be used.
+   ff_filter_set_ready() function, which keeps the graph ready queue up to
+   date.
    ff_filter_set_ready() is called whenever anything could cause progress to
    be possible. Marking a filter ready when it is not is not a problem,
    except for the small overhead it causes.
@@ -1317,7 +1348,14 @@ int ff_filter_activate(AVFilterContext *filter)
     /* Generic timeline support is not yet implemented but should be easy */
     av_assert1(!(filter->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC &&
                  filter->filter->activate));
-    filter->ready = 0;
+    if (filter->graph) {
+        ff_graph_lock(filter->graph);
+        filter->ready = 0;
+        ff_filter_graph_update_ready(filter->graph, filter);
+        ff_graph_unlock(filter->graph);
+    } else {
+        filter->ready = 0;
+    }
     ret = filter->filter->activate ? filter->filter->activate(filter) :
           ff_filter_activate_default(filter);
     if (ret == FFERROR_NOT_READY)
@@ -1415,6 +1453,62 @@ AVFrame *ff_inlink_peek_frame(AVFilterLink *link, size_t idx)
     return ff_framequeue_peek(&link->fifo, idx);
 }
 
+/* frames smaller than this are copied by the calling thread */
+#define SLICE_COPY_MIN_SIZE (1 << 20)
+
+typedef struct CopyThreadData {
+    AVFrame *dst;
+    const AVFrame *src;
+} CopyThreadData;
+
+static int copy_video_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const CopyThreadData *td = arg;
+    const AVFrame *src = td->src;
+    AVFrame *dst = td->dst;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(src->format);
+    int planes = av_pix_fmt_count_planes(src->format);
+
+    for (int i = 0; i < planes; i++) {
+        int h     = (i == 1 || i == 2) ? AV_CEIL_RSHIFT(src->height, desc->log2_chroma_h)
+                                       : src->height;
+        int start = (h *  jobnr     ) / nb_jobs;
+        int end   = (h * (jobnr + 1)) / nb_jobs;
+
+        av_image_copy_plane(dst->data[i] + start * dst->linesize[i], dst->linesize[i],
+                            src->data[i] + start * src->linesize[i], src->linesize[i],
+                            av_image_get_linesize(src->format, src->width, i),
+                            end - start);
+    }
+
+    return 0;
+}
+
+/**
+ * Same as av_frame_copy(), but split large video frames in horizontal bands
+ * copied by the slice threads of the graph.
+ */
+static int frame_copy(AVFilterLink *link, AVFrame *dst, const AVFrame *src)
+{
+    AVFilterContext *ctx = link->dst;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(src->format);
+    int nb_jobs = ff_filter_get_nb_threads(ctx);
+    CopyThreadData td = { .dst = dst, .src = src };
+
+    if (link->type != AVMEDIA_TYPE_VIDEO || nb_jobs <= 1 ||
+        !ctx->graph->internal->thread_execute || !desc ||
+        desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL) ||
+        src->hw_frames_ctx || dst->hw_frames_ctx || dst->format != src->format ||
+        dst->width < src->width || dst->height < src->height ||
+        (int64_t)FFABS(src->linesize[0]) * src->height < SLICE_COPY_MIN_SIZE)
+        return av_frame_copy(dst, src);
+
+    nb_jobs = FFMIN(nb_jobs, AV_CEIL_RSHIFT(src->height, desc->log2_chroma_h));
+    ctx->graph->internal->thread_execute(ctx, copy_video_slice, &td, NULL, nb_jobs);
+
+    return 0;
+}
+
 int ff_inlink_make_frame_writable(AVFilterLink *link, AVFrame **rframe)
 {
     AVFrame *frame = *rframe;
@@ -1444,7 +1538,7 @@ int ff_inlink_make_frame_writable(AVFilterLink *link, AVFrame **rframe)
         return ret;
     }
 
-    ret = av_frame_copy(out, frame);
+    ret = frame_copy(link, out, frame);
     if (ret < 0) {
         av_frame_free(&out);
         return ret;
@@ -917,6 +917,38 @@ typedef struct AVFilterGraph {
 
     char *aresample_swr_opts; ///< swr options to use for the auto-inserted aresample filters, Access ONLY through AVOptions
 
+    /**
+     * Maximum number of filters of this graph that may be activated
+     * concurrently. Independent branches and the successive stages of a
+     * linear chain then run in parallel with each other. May be set by the
+     * caller before calling avfilter_graph_config(). 1 (the default) disables
+     * graph-level parallelism, zero means that the number of threads is
+     * determined automatically.
+     *
+     * This is independent from, and can be combined with, slice threading;
+     * filters activated concurrently run their slice jobs sequentially.
+     * It is not available with a custom @ref AVFilterGraph.execute callback.
+     *
+     * Commands sent by filters such as sendcmd while other filters run are
+     * processed once these have finished, and return no reply.
+     */
+    int nb_graph_threads;
+
+    /**
+     * AV_BUFFER_POOL_FLAG_* flags used for the pools of the default video
+     * buffer allocator, e.g. to back large frames with huge pages. May be set
+     * by the caller before calling avfilter_graph_config().
+     */
+    int frame_pool_flags;
+
+    /**
+     * Restrict the threads of this graph to a set of CPUs, see
+     * av_cpu_set_thread_affinity() for the syntax. May be set by the caller
+     * before adding any filters to the graph. NULL (the default) leaves them
+     * to the system scheduler. Access ONLY through AVOptions.
+     */
+    char *thread_affinity;
+
     /**
      * Private fields
      *
@@ -1442,6 +1474,9 @@ void avfilter_graph_segment_free(AVFilterGraphSegment **seg);
  *
  * @returns >=0 on success otherwise an error code.
  *              AVERROR(ENOSYS) on unsupported commands
+ *              AVERROR(EAGAIN) if filters of the graph are being activated
+ *              in parallel: the command is then queued, sent once they have
+ *              completed, and res is left empty
  */
 int avfilter_graph_send_command(AVFilterGraph *graph, const char *target, const char *cmd, const char *arg, char *res, int res_len, int flags);
 
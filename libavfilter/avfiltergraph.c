@@ -26,6 +26,7 @@
 
 #include "libavutil/avassert.h"
 #include "libavutil/bprint.h"
+#include "libavutil/buffer.h"
 #include "libavutil/channel_layout.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/opt.h"
@@ -55,6 +56,16 @@ static const AVOption filtergraph_options[] = {
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|V },
     {"aresample_swr_opts"   , "default aresample filter options"    , OFFSET(aresample_swr_opts)    ,
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|A },
+    { "graph_threads", "Maximum number of filters activated concurrently", OFFSET(nb_graph_threads), AV_OPT_TYPE_INT,
+        { .i64 = 1 }, 0, INT_MAX, F|V|A, "graph_threads" },
+        {"auto", "autodetect a suitable number of threads to use", 0, AV_OPT_TYPE_CONST, {.i64 = 0 }, .flags = F|V|A, .unit = "graph_threads"},
+    { "frame_pool_flags", "Allocation flags for video frame pools", OFFSET(frame_pool_flags), AV_OPT_TYPE_FLAGS,
+        { .i64 = 0 }, 0, INT_MAX, F|V, "frame_pool_flags" },
+        { "hugepage",   "use transparent huge pages", 0, AV_OPT_TYPE_CONST, { .i64 = AV_BUFFER_POOL_FLAG_HUGEPAGE },   .flags = F|V, .unit = "frame_pool_flags" },
+        { "hugetlb",    "use explicit huge pages",    0, AV_OPT_TYPE_CONST, { .i64 = AV_BUFFER_POOL_FLAG_HUGETLB },    .flags = F|V, .unit = "frame_pool_flags" },
+        { "numa_local", "fault in buffers in the allocating thread", 0, AV_OPT_TYPE_CONST, { .i64 = AV_BUFFER_POOL_FLAG_NUMA_LOCAL }, .flags = F|V, .unit = "frame_pool_flags" },
+    { "thread_affinity", "Restrict the filter threads to a set of CPUs", OFFSET(thread_affinity), AV_OPT_TYPE_STRING,
+        { .str = NULL }, 0, 0, F|V|A },
     { NULL },
 };
 
@@ -77,8 +88,44 @@ int ff_graph_thread_init(AVFilterGraph *graph)
     graph->nb_threads  = 1;
     return 0;
 }
+
+int ff_graph_parallel_init(AVFilterGraph *graph)
+{
+    graph->nb_graph_threads = 1;
+    return 0;
+}
+
+int ff_graph_parallel_execute(AVFilterGraph *graph,
+                              AVFilterContext **filters, int nb_filters)
+{
+    return AVERROR_BUG;
+}
+
+void ff_graph_parallel_free(AVFilterGraph *graph)
+{
+}
 #endif
 
+typedef struct FFGraphCommand {
+    char *target;
+    char *command;
+    char *arg;
+    int flags;
+    struct FFGraphCommand *next;
+} FFGraphCommand;
+
+static void graph_command_free(FFGraphCommand **pcmd)
+{
+    FFGraphCommand *cmd = *pcmd;
+
+    if (!cmd)
+        return;
+    av_freep(&cmd->target);
+    av_freep(&cmd->command);
+    av_freep(&cmd->arg);
+    av_freep(pcmd);
+}
+
 AVFilterGraph *avfilter_graph_alloc(void)
 {
     AVFilterGraph *ret = av_mallocz(sizeof(*ret));
@@ -92,6 +139,12 @@ AVFilterGraph *avfilter_graph_alloc(void)
     }
 
     ret->av_class = &filtergraph_class;
+    if (ff_mutex_init(&ret->internal->batch_lock, NULL)) {
+        av_freep(&ret->internal);
+        av_freep(&ret);
+        return NULL;
+    }
+
     av_opt_set_defaults(ret);
     ff_framequeue_global_init(&ret->internal->frame_queues);
 
@@ -103,9 +156,19 @@ void ff_filter_graph_remove_filter(AVFilterGraph *graph, AVFilterContext *filter
     int i, j;
     for (i = 0; i < graph->nb_filters; i++) {
         if (graph->filters[i] == filter) {
+            if (filter->ready) {
+                filter->ready = 0;
+                ff_filter_graph_update_ready(graph, filter);
+            }
             FFSWAP(AVFilterContext*, graph->filters[i],
                    graph->filters[graph->nb_filters - 1]);
             graph->nb_filters--;
+            if (i < graph->nb_filters) {
+                AVFilterContext *moved = graph->filters[i];
+                moved->internal->graph_index = i;
+                if (moved->internal->ready_index >= 0)
+                    ff_filter_graph_update_ready(graph, moved);
+            }
             filter->graph = NULL;
             for (j = 0; j<filter->nb_outputs; j++)
                 if (filter->outputs[j])
@@ -124,6 +187,7 @@ void avfilter_graph_free(AVFilterGraph **graph)
     while ((*graph)->nb_filters)
         avfilter_free((*graph)->filters[0]);
 
+    ff_graph_parallel_free(*graph);
     ff_graph_thread_free(*graph);
 
     av_freep(&(*graph)->sink_links);
@@ -131,6 +195,13 @@ void avfilter_graph_free(AVFilterGraph **graph)
     av_opt_free(*graph);
 
     av_freep(&(*graph)->filters);
+    av_freep(&(*graph)->internal->ready_heap);
+    while ((*graph)->internal->deferred_commands) {
+        FFGraphCommand *cmd = (*graph)->internal->deferred_commands;
+        (*graph)->internal->deferred_commands = cmd->next;
+        graph_command_free(&cmd);
+    }
+    ff_mutex_destroy(&(*graph)->internal->batch_lock);
     av_freep(&(*graph)->internal);
     av_freep(graph);
 }
@@ -166,7 +237,7 @@ AVFilterContext *avfilter_graph_alloc_filter(AVFilterGraph *graph,
                                              const AVFilter *filter,
                                              const char *name)
 {
-    AVFilterContext **filters, *s;
+    AVFilterContext **filters, **ready_heap, *s;
 
     if (graph->thread_type && !graph->internal->thread_execute) {
         if (graph->execute) {
@@ -185,10 +256,17 @@ AVFilterContext *avfilter_graph_alloc_filter(AVFilterGraph *graph,
         return NULL;
     graph->filters = filters;
 
+    ready_heap = av_realloc_array(graph->internal->ready_heap,
+                                  graph->nb_filters + 1, sizeof(*ready_heap));
+    if (!ready_heap)
+        return NULL;
+    graph->internal->ready_heap = ready_heap;
+
     s = ff_filter_alloc(filter, name);
     if (!s)
         return NULL;
 
+    s->internal->graph_index = graph->nb_filters;
     graph->filters[graph->nb_filters++] = s;
 
     s->graph = graph;
@@ -280,6 +358,43 @@ static int graph_check_links(AVFilterGraph *graph, void *log_ctx)
     return 0;
 }
 
+static int can_fuse(const AVFilterContext *f, const AVFilterContext *next)
+{
+    return f->internal->fuse && f->internal->fuse == next->internal->fuse &&
+           f->nb_outputs == 1 && next->nb_inputs == 1 && next->nb_outputs == 1 &&
+           !f->enable_str && !next->enable_str;
+}
+
+/**
+ * Merge chains of adjacent filters sharing the same fuse callback, such as
+ * successive lut filters or successive curves filters, so that each frame is
+ * read and written only once by the whole chain. Filters of different kinds
+ * (e.g. lut followed by curves) are not merged.
+ */
+static int graph_fuse_filters(AVFilterGraph *graph, void *log_ctx)
+{
+    AVFilterContext *f, *next;
+    unsigned i;
+    int ret;
+
+    for (i = 0; i < graph->nb_filters; i++) {
+        f = graph->filters[i];
+        if (!f->internal->fuse)
+            continue;
+        /* only start from the head of a chain */
+        if (f->nb_inputs == 1 && f->inputs[0] && can_fuse(f->inputs[0]->src, f))
+            continue;
+        while (f->nb_outputs == 1 && f->outputs[0] &&
+               (next = f->outputs[0]->dst) && can_fuse(f, next)) {
+            ret = f->internal->fuse(f, next);
+            if (ret < 0)
+                return ret;
+            f = next;
+        }
+    }
+    return 0;
+}
+
 AVFilterContext *avfilter_graph_get_filter(AVFilterGraph *graph, const char *name)
 {
     int i;
@@ -1176,12 +1291,71 @@ int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
         return ret;
     if ((ret = graph_check_links(graphctx, log_ctx)))
         return ret;
+    if ((ret = graph_fuse_filters(graphctx, log_ctx)))
+        return ret;
     if ((ret = graph_config_pointers(graphctx, log_ctx)))
         return ret;
+    if ((ret = ff_graph_parallel_init(graphctx)) < 0)
+        return ret;
 
     return 0;
 }
 
+static int graph_defer_command(AVFilterGraph *graph, const char *target,
+                               const char *command, const char *arg, int flags)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    FFGraphCommand *cmd = av_mallocz(sizeof(*cmd));
+
+    if (!cmd)
+        return AVERROR(ENOMEM);
+    cmd->target  = av_strdup(target);
+    cmd->command = av_strdup(command);
+    cmd->arg     = av_strdup(arg);
+    cmd->flags   = flags;
+    if (!cmd->target || !cmd->command || (arg && !cmd->arg)) {
+        graph_command_free(&cmd);
+        return AVERROR(ENOMEM);
+    }
+
+    ff_graph_lock(graph);
+    if (!gi->deferred_commands_tail)
+        gi->deferred_commands_tail = &gi->deferred_commands;
+    *gi->deferred_commands_tail = cmd;
+    gi->deferred_commands_tail  = &cmd->next;
+    ff_graph_unlock(graph);
+
+    return 0;
+}
+
+/**
+ * Run the commands deferred while a batch was running, in the order in
+ * which they were sent. Must be called while no batch is running.
+ */
+static void graph_run_deferred_commands(AVFilterGraph *graph)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+
+    av_assert1(!gi->batch_running);
+    while (gi->deferred_commands) {
+        FFGraphCommand *cmd = gi->deferred_commands;
+        char res[256] = { 0 };
+        int ret;
+
+        gi->deferred_commands = cmd->next;
+        if (!gi->deferred_commands)
+            gi->deferred_commands_tail = &gi->deferred_commands;
+
+        ret = avfilter_graph_send_command(graph, cmd->target, cmd->command,
+                                          cmd->arg, res, sizeof(res), cmd->flags);
+        av_log(graph, ret < 0 ? AV_LOG_WARNING : AV_LOG_DEBUG,
+               "Deferred command %s %s to %s: %s%s\n",
+               cmd->command, cmd->arg ? cmd->arg : "", cmd->target,
+               ret < 0 ? av_err2str(ret) : "ok ", res);
+        graph_command_free(&cmd);
+    }
+}
+
 int avfilter_graph_send_command(AVFilterGraph *graph, const char *target, const char *cmd, const char *arg, char *res, int res_len, int flags)
 {
     int i, r = AVERROR(ENOSYS);
@@ -1189,6 +1363,16 @@ int avfilter_graph_send_command(AVFilterGraph *graph, const char *target, const
     if (!graph)
         return r;
 
+    /* The target may be activating concurrently on another graph worker:
+     * defer the command until the batch has completed. No reply is
+     * available in that case. */
+    if (graph->internal->batch_running) {
+        if (res_len && res)
+            res[0] = 0;
+        r = graph_defer_command(graph, target, cmd, arg, flags);
+        return r < 0 ? r : AVERROR(EAGAIN);
+    }
+
     if ((flags & AVFILTER_CMD_FLAG_ONE) && !(flags & AVFILTER_CMD_FLAG_FAST)) {
         r = avfilter_graph_send_command(graph, target, cmd, arg, res, res_len, flags | AVFILTER_CMD_FLAG_FAST);
         if (r != AVERROR(ENOSYS))
@@ -1337,17 +1521,149 @@ int avfilter_graph_request_oldest(AVFilterGraph *graph)
     return 0;
 }
 
-int ff_filter_graph_run_once(AVFilterGraph *graph)
+/**
+ * Return 1 if filter a must be activated before filter b:
+ * higher ready value first, then lower position in the graph.
+ */
+static int ready_before(const AVFilterContext *a, const AVFilterContext *b)
+{
+    if (a->ready != b->ready)
+        return a->ready > b->ready;
+    return a->internal->graph_index < b->internal->graph_index;
+}
+
+static void ready_bubble_up(AVFilterGraphInternal *gi,
+                            AVFilterContext *filter, int index)
+{
+    AVFilterContext **heap = gi->ready_heap;
+
+    while (index) {
+        int parent = (index - 1) >> 1;
+        if (!ready_before(filter, heap[parent]))
+            break;
+        heap[index] = heap[parent];
+        heap[index]->internal->ready_index = index;
+        index = parent;
+    }
+    heap[index] = filter;
+    filter->internal->ready_index = index;
+}
+
+static void ready_bubble_down(AVFilterGraphInternal *gi,
+                              AVFilterContext *filter, int index)
+{
+    AVFilterContext **heap = gi->ready_heap;
+
+    while (1) {
+        int child = 2 * index + 1;
+        if (child >= gi->nb_ready)
+            break;
+        if (child + 1 < gi->nb_ready &&
+            ready_before(heap[child + 1], heap[child]))
+            child++;
+        if (!ready_before(heap[child], filter))
+            break;
+        heap[index] = heap[child];
+        heap[index]->internal->ready_index = index;
+        index = child;
+    }
+    heap[index] = filter;
+    filter->internal->ready_index = index;
+}
+
+static void ready_remove(AVFilterGraphInternal *gi, AVFilterContext *filter)
+{
+    int index = filter->internal->ready_index;
+    AVFilterContext *last = gi->ready_heap[--gi->nb_ready];
+
+    filter->internal->ready_index = -1;
+    if (last != filter) {
+        ready_bubble_up  (gi, last, index);
+        ready_bubble_down(gi, last, last->internal->ready_index);
+    }
+}
+
+void ff_filter_graph_update_ready(AVFilterGraph *graph, AVFilterContext *filter)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    int index = filter->internal->ready_index;
+
+    if (!filter->ready) {
+        /* Not ready any more: remove it from the queue */
+        if (index >= 0)
+            ready_remove(gi, filter);
+        return;
+    }
+    if (index < 0) {
+        av_assert1(gi->nb_ready < graph->nb_filters);
+        index = gi->nb_ready++;
+    }
+    ready_bubble_up  (gi, filter, index);
+    ready_bubble_down(gi, filter, filter->internal->ready_index);
+}
+
+static void batch_mark_neighbours(AVFilterContext *filter, unsigned id, int depth)
 {
-    AVFilterContext *filter;
     unsigned i;
 
+    filter->internal->batch_mark = id;
+    if (!depth--)
+        return;
+    for (i = 0; i < filter->nb_inputs; i++)
+        if (filter->inputs[i] && filter->inputs[i]->src)
+            batch_mark_neighbours(filter->inputs[i]->src, id, depth);
+    for (i = 0; i < filter->nb_outputs; i++)
+        if (filter->outputs[i] && filter->outputs[i]->dst)
+            batch_mark_neighbours(filter->outputs[i]->dst, id, depth);
+}
+
+/**
+ * Activate a batch of ready filters concurrently.
+ *
+ * Activating a filter touches its links, the ready state of its direct
+ * neighbours and the outputs of the filters it sends frames to. Filters
+ * selected in a batch are therefore at least three links apart, which
+ * gives each of them exclusive access to everything it can touch except
+ * the ready queue and the sink heap, which are protected by batch_lock.
+ * This lets independent branches and successive stages of a linear chain
+ * run at the same time.
+ */
+static int run_batch(AVFilterGraph *graph)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    int nb_batch = 0, nb_deferred = 0, i, ret;
+    unsigned id = ++gi->batch_id;
+
+    while (gi->nb_ready && nb_batch < gi->graph_batch_max &&
+           nb_batch + nb_deferred < 2 * gi->graph_batch_max) {
+        AVFilterContext *filter = gi->ready_heap[0];
+
+        ready_remove(gi, filter);
+        if (filter->internal->batch_mark == id) {
+            gi->batch_deferred[nb_deferred++] = filter;
+        } else {
+            gi->batch[nb_batch++] = filter;
+            batch_mark_neighbours(filter, id, 2);
+        }
+    }
+    for (i = 0; i < nb_deferred; i++) {
+        AVFilterContext *filter = gi->batch_deferred[i];
+        ready_bubble_up(gi, filter, gi->nb_ready++);
+    }
+
+    if (nb_batch == 1)
+        return ff_filter_activate(gi->batch[0]);
+    ret = ff_graph_parallel_execute(graph, gi->batch, nb_batch);
+    graph_run_deferred_commands(graph);
+    return ret;
+}
+
+int ff_filter_graph_run_once(AVFilterGraph *graph)
+{
     av_assert0(graph->nb_filters);
-    filter = graph->filters[0];
-    for (i = 1; i < graph->nb_filters; i++)
-        if (graph->filters[i]->ready > filter->ready)
-            filter = graph->filters[i];
-    if (!filter->ready)
+    if (!graph->internal->nb_ready)
         return AVERROR(EAGAIN);
-    return ff_filter_activate(filter);
+    if (graph->internal->graph_thread)
+        return run_batch(graph);
+    return ff_filter_activate(graph->internal->ready_heap[0]);
 }
@@ -434,9 +434,9 @@ void ff_blend_rectangle(FFDrawContext *draw, FFDrawColor *color,
     }
 }
 
-static void blend_pixel16(uint8_t *dst, unsigned src, unsigned alpha,
-                          const uint8_t *mask, int mask_linesize, int l2depth,
-                          unsigned w, unsigned h, unsigned shift, unsigned xm0)
+static av_always_inline void blend_pixel16(uint8_t *dst, unsigned src, unsigned alpha,
+                                           const uint8_t *mask, int mask_linesize, int l2depth,
+                                           unsigned w, unsigned h, unsigned shift, unsigned xm0)
 {
     unsigned xm, x, y, t = 0;
     unsigned xmshf = 3 - l2depth;
@@ -458,9 +458,9 @@ static void blend_pixel16(uint8_t *dst, unsigned src, unsigned alpha,
     AV_WL16(dst, ((0x10001 - alpha) * value + alpha * src) >> 16);
 }
 
-static void blend_pixel(uint8_t *dst, unsigned src, unsigned alpha,
-                        const uint8_t *mask, int mask_linesize, int l2depth,
-                        unsigned w, unsigned h, unsigned shift, unsigned xm0)
+static av_always_inline void blend_pixel(uint8_t *dst, unsigned src, unsigned alpha,
+                                         const uint8_t *mask, int mask_linesize, int l2depth,
+                                         unsigned w, unsigned h, unsigned shift, unsigned xm0)
 {
     unsigned xm, x, y, t = 0;
     unsigned xmshf = 3 - l2depth;
@@ -481,11 +481,11 @@ static void blend_pixel(uint8_t *dst, unsigned src, unsigned alpha,
     *dst = ((0x1010101 - alpha) * *dst + alpha * src) >> 24;
 }
 
-static void blend_line_hv16(uint8_t *dst, int dst_delta,
-                            unsigned src, unsigned alpha,
-                            const uint8_t *mask, int mask_linesize, int l2depth, int w,
-                            unsigned hsub, unsigned vsub,
-                            int xm, int left, int right, int hband)
+static av_always_inline void blend_line_hv16_c(uint8_t *dst, int dst_delta,
+                                               unsigned src, unsigned alpha,
+                                               const uint8_t *mask, int mask_linesize, int l2depth, int w,
+                                               unsigned hsub, unsigned vsub,
+                                               int xm, int left, int right, int hband)
 {
     int x;
 
@@ -506,11 +506,11 @@ static void blend_line_hv16(uint8_t *dst, int dst_delta,
                       right, hband, hsub + vsub, xm);
 }
 
-static void blend_line_hv(uint8_t *dst, int dst_delta,
-                          unsigned src, unsigned alpha,
-                          const uint8_t *mask, int mask_linesize, int l2depth, int w,
-                          unsigned hsub, unsigned vsub,
-                          int xm, int left, int right, int hband)
+static av_always_inline void blend_line_hv_c(uint8_t *dst, int dst_delta,
+                                             unsigned src, unsigned alpha,
+                                             const uint8_t *mask, int mask_linesize, int l2depth, int w,
+                                             unsigned hsub, unsigned vsub,
+                                             int xm, int left, int right, int hband)
 {
     int x;
 
@@ -531,6 +531,64 @@ static void blend_line_hv(uint8_t *dst, int dst_delta,
                     right, hband, hsub + vsub, xm);
 }
 
+/*
+ * Fully transparent mask pixels leave the destination untouched, so they
+ * are skipped; for the common case of 8-bit masks on non-subsampled planes
+ * the coverage is read directly instead of going through blend_pixel().
+ */
+static void blend_line_hv16(uint8_t *dst, int dst_delta,
+                            unsigned src, unsigned alpha,
+                            const uint8_t *mask, int mask_linesize, int l2depth, int w,
+                            unsigned hsub, unsigned vsub,
+                            int xm, int left, int right, int hband)
+{
+    int x;
+
+    if (l2depth == 3 && !hsub && !vsub) {
+        mask += xm;
+        for (x = 0; x < w; x++) {
+            if (mask[x]) {
+                unsigned a = mask[x] * alpha;
+                uint16_t value = AV_RL16(dst);
+                AV_WL16(dst, ((0x10001 - a) * value + a * src) >> 16);
+            }
+            dst += dst_delta;
+        }
+    } else if (l2depth == 3) {
+        blend_line_hv16_c(dst, dst_delta, src, alpha, mask, mask_linesize, 3, w,
+                          hsub, vsub, xm, left, right, hband);
+    } else {
+        blend_line_hv16_c(dst, dst_delta, src, alpha, mask, mask_linesize, l2depth, w,
+                          hsub, vsub, xm, left, right, hband);
+    }
+}
+
+static void blend_line_hv(uint8_t *dst, int dst_delta,
+                          unsigned src, unsigned alpha,
+                          const uint8_t *mask, int mask_linesize, int l2depth, int w,
+                          unsigned hsub, unsigned vsub,
+                          int xm, int left, int right, int hband)
+{
+    int x;
+
+    if (l2depth == 3 && !hsub && !vsub) {
+        mask += xm;
+        for (x = 0; x < w; x++) {
+            if (mask[x]) {
+                unsigned a = mask[x] * alpha;
+                *dst = ((0x1010101 - a) * *dst + a * src) >> 24;
+            }
+            dst += dst_delta;
+        }
+    } else if (l2depth == 3) {
+        blend_line_hv_c(dst, dst_delta, src, alpha, mask, mask_linesize, 3, w,
+                        hsub, vsub, xm, left, right, hband);
+    } else {
+        blend_line_hv_c(dst, dst_delta, src, alpha, mask, mask_linesize, l2depth, w,
+                        hsub, vsub, xm, left, right, hband);
+    }
+}
+
 void ff_blend_mask(FFDrawContext *draw, FFDrawColor *color,
                    uint8_t *dst[], int dst_linesize[], int dst_w, int dst_h,
                    const uint8_t *mask,  int mask_linesize, int mask_w, int mask_h,
@@ -72,6 +72,10 @@ struct FFEBUR128StateInternal {
     size_t audio_data_frames;
     /** Current index for audio_data. */
     size_t audio_data_index;
+    /** Weighted energy of each 100ms block of audio_data. */
+    double *block_energies;
+    /** Index in audio_data of the first block missing from block_energies. */
+    size_t block_energies_index;
     /** How many frames are needed for a gating block. Will correspond to 400ms
      *  of audio at initialization, and 100ms after the first block (75% overlap
      *  as specified in the 2011 revision of BS1770). */
@@ -257,6 +261,11 @@ FFEBUR128State *ff_ebur128_init(unsigned int channels,
         (double *) av_calloc(st->d->audio_data_frames,
                              st->channels * sizeof(*st->d->audio_data));
     CHECK_ERROR(!st->d->audio_data, 0, free_sample_peak)
+    st->d->block_energies =
+        av_calloc(st->d->audio_data_frames / st->d->samples_in_100ms,
+                  sizeof(*st->d->block_energies));
+    CHECK_ERROR(!st->d->block_energies, 0, free_audio_data)
+    st->d->block_energies_index = 0;
 
     ebur128_init_filter(st);
 
@@ -288,6 +297,7 @@ free_short_term_block_energy_histogram:
 free_block_energy_histogram:
     av_free(st->d->block_energy_histogram);
 free_audio_data:
+    av_free(st->d->block_energies);
     av_free(st->d->audio_data);
 free_sample_peak:
     av_free(st->d->sample_peak);
@@ -306,6 +316,7 @@ void ff_ebur128_destroy(FFEBUR128State ** st)
     av_free((*st)->d->block_energy_histogram);
     av_free((*st)->d->short_term_block_energy_histogram);
     av_free((*st)->d->audio_data);
+    av_free((*st)->d->block_energies);
     av_free((*st)->d->channel_map);
     av_free((*st)->d->sample_peak);
     av_free((*st)->d->data_ptrs);
@@ -319,6 +330,10 @@ static void ebur128_filter_##type(FFEBUR128State* st, const type** srcs,
                                   size_t src_index, size_t frames,                 \
                                   int stride) {                                    \
     double* audio_data = st->d->audio_data + st->d->audio_data_index;              \
+    const double a1 = st->d->a[1], a2 = st->d->a[2],                               \
+                 a3 = st->d->a[3], a4 = st->d->a[4];                               \
+    const double b0 = st->d->b[0], b1 = st->d->b[1], b2 = st->d->b[2],             \
+                 b3 = st->d->b[3], b4 = st->d->b[4];                               \
     size_t i, c;                                                                   \
                                                                                    \
     if ((st->mode & FF_EBUR128_MODE_SAMPLE_PEAK) == FF_EBUR128_MODE_SAMPLE_PEAK) { \
@@ -337,30 +352,34 @@ static void ebur128_filter_##type(FFEBUR128State* st, const type** srcs,
         }                                                                          \
     }                                                                              \
     for (c = 0; c < st->channels; ++c) {                                           \
+        const type *src = srcs[c] + src_index;                                     \
+        double *v;                                                                 \
+        double v1, v2, v3, v4;                                                     \
         int ci = st->d->channel_map[c] - 1;                                        \
         if (ci < 0) continue;                                                      \
         else if (ci == FF_EBUR128_DUAL_MONO - 1) ci = 0; /*dual mono */            \
+        /* keep the filter state in registers, it cannot alias audio_data */       \
+        v  = st->d->v[ci];                                                         \
+        v1 = v[1];                                                                 \
+        v2 = v[2];                                                                 \
+        v3 = v[3];                                                                 \
+        v4 = v[4];                                                                 \
         for (i = 0; i < frames; ++i) {                                             \
-            st->d->v[ci][0] = (double) (srcs[c][src_index + i * stride] / scaling_factor) \
-                         - st->d->a[1] * st->d->v[ci][1]                           \
-                         - st->d->a[2] * st->d->v[ci][2]                           \
-                         - st->d->a[3] * st->d->v[ci][3]                           \
-                         - st->d->a[4] * st->d->v[ci][4];                          \
+            const double v0 = (double) (src[i * stride] / scaling_factor)          \
+                            - a1 * v1 - a2 * v2 - a3 * v3 - a4 * v4;               \
             audio_data[i * st->channels + c] =                                     \
-                           st->d->b[0] * st->d->v[ci][0]                           \
-                         + st->d->b[1] * st->d->v[ci][1]                           \
-                         + st->d->b[2] * st->d->v[ci][2]                           \
-                         + st->d->b[3] * st->d->v[ci][3]                           \
-                         + st->d->b[4] * st->d->v[ci][4];                          \
-            st->d->v[ci][4] = st->d->v[ci][3];                                     \
-            st->d->v[ci][3] = st->d->v[ci][2];                                     \
-            st->d->v[ci][2] = st->d->v[ci][1];                                     \
-            st->d->v[ci][1] = st->d->v[ci][0];                                     \
+                b0 * v0 + b1 * v1 + b2 * v2 + b3 * v3 + b4 * v4;                   \
+            v4 = v3;                                                               \
+            v3 = v2;                                                               \
+            v2 = v1;                                                               \
+            v1 = v0;                                                               \
         }                                                                          \
-        st->d->v[ci][4] = fabs(st->d->v[ci][4]) < DBL_MIN ? 0.0 : st->d->v[ci][4]; \
-        st->d->v[ci][3] = fabs(st->d->v[ci][3]) < DBL_MIN ? 0.0 : st->d->v[ci][3]; \
-        st->d->v[ci][2] = fabs(st->d->v[ci][2]) < DBL_MIN ? 0.0 : st->d->v[ci][2]; \
-        st->d->v[ci][1] = fabs(st->d->v[ci][1]) < DBL_MIN ? 0.0 : st->d->v[ci][1]; \
+        if (frames)                                                                \
+            v[0] = v1;                                                             \
+        v[4] = fabs(v4) < DBL_MIN ? 0.0 : v4;                                      \
+        v[3] = fabs(v3) < DBL_MIN ? 0.0 : v3;                                      \
+        v[2] = fabs(v2) < DBL_MIN ? 0.0 : v2;                                      \
+        v[1] = fabs(v1) < DBL_MIN ? 0.0 : v1;                                      \
     }                                                                              \
 }
 EBUR128_FILTER(double, 1.0)
@@ -388,13 +407,73 @@ static size_t find_histogram_index(double energy)
     return index_min;
 }
 
+static double ebur128_channel_weight(const FFEBUR128State * st, size_t c)
+{
+    if (st->d->channel_map[c] == FF_EBUR128_Mp110 ||
+        st->d->channel_map[c] == FF_EBUR128_Mm110 ||
+        st->d->channel_map[c] == FF_EBUR128_Mp060 ||
+        st->d->channel_map[c] == FF_EBUR128_Mm060 ||
+        st->d->channel_map[c] == FF_EBUR128_Mp090 ||
+        st->d->channel_map[c] == FF_EBUR128_Mm090) {
+        return 1.41;
+    } else if (st->d->channel_map[c] == FF_EBUR128_DUAL_MONO) {
+        return 2.0;
+    }
+    return 1.0;
+}
+
+/* Store the energy of the 100ms blocks completed since the last call. */
+static void ebur128_calc_block_energies(FFEBUR128State * st)
+{
+    const size_t block_size = st->d->samples_in_100ms * st->channels;
+    const size_t data_size  = st->d->audio_data_frames * st->channels;
+    const size_t end = st->d->audio_data_index % data_size;
+    size_t i, c;
+
+    while (st->d->block_energies_index != end) {
+        const double *data = st->d->audio_data + st->d->block_energies_index;
+        double sum = 0.0;
+
+        for (c = 0; c < st->channels; ++c) {
+            double channel_sum = 0.0;
+            if (st->d->channel_map[c] == FF_EBUR128_UNUSED)
+                continue;
+            for (i = 0; i < st->d->samples_in_100ms; ++i)
+                channel_sum += data[i * st->channels + c] *
+                               data[i * st->channels + c];
+            sum += channel_sum * ebur128_channel_weight(st, c);
+        }
+        st->d->block_energies[st->d->block_energies_index / block_size] = sum;
+
+        st->d->block_energies_index += block_size;
+        if (st->d->block_energies_index == data_size)
+            st->d->block_energies_index = 0;
+    }
+}
+
 static void ebur128_calc_gating_block(FFEBUR128State * st,
                                       size_t frames_per_block,
                                       double *optional_output)
 {
+    const size_t block_size = st->d->samples_in_100ms * st->channels;
+    const size_t data_size  = st->d->audio_data_frames * st->channels;
     size_t i, c;
     double sum = 0.0;
     double channel_sum;
+
+    /* Blocks made of whole 100ms blocks ending at the current position are
+     * summed from the stored block energies. */
+    if (!(frames_per_block % st->d->samples_in_100ms) &&
+        st->d->block_energies_index == st->d->audio_data_index % data_size) {
+        const size_t nb_blocks = st->d->audio_data_frames / st->d->samples_in_100ms;
+        const size_t nb = frames_per_block / st->d->samples_in_100ms;
+        size_t b = st->d->block_energies_index / block_size + nb_blocks - nb;
+
+        for (i = 0; i < nb; ++i, ++b)
+            sum += st->d->block_energies[b < nb_blocks ? b : b - nb_blocks];
+        goto done;
+    }
+
     for (c = 0; c < st->channels; ++c) {
         if (st->d->channel_map[c] == FF_EBUR128_UNUSED)
             continue;
@@ -422,18 +501,9 @@ static void ebur128_calc_gating_block(FFEBUR128State * st,
                                                              c];
             }
         }
-        if (st->d->channel_map[c] == FF_EBUR128_Mp110 ||
-            st->d->channel_map[c] == FF_EBUR128_Mm110 ||
-            st->d->channel_map[c] == FF_EBUR128_Mp060 ||
-            st->d->channel_map[c] == FF_EBUR128_Mm060 ||
-            st->d->channel_map[c] == FF_EBUR128_Mp090 ||
-            st->d->channel_map[c] == FF_EBUR128_Mm090) {
-            channel_sum *= 1.41;
-        } else if (st->d->channel_map[c] == FF_EBUR128_DUAL_MONO) {
-            channel_sum *= 2.0;
-        }
-        sum += channel_sum;
+        sum += channel_sum * ebur128_channel_weight(st, c);
     }
+done:
     sum /= (double) frames_per_block;
     if (optional_output) {
         *optional_output = sum;
@@ -467,6 +537,7 @@ static void ebur128_add_frames_planar_##type(FFEBUR128State* st, const type** sr
             src_index += st->d->needed_frames * stride;                                \
             frames -= st->d->needed_frames;                                            \
             st->d->audio_data_index += st->d->needed_frames * st->channels;            \
+            ebur128_calc_block_energies(st);                                           \
             /* calculate the new gating block */                                       \
             if ((st->mode & FF_EBUR128_MODE_I) == FF_EBUR128_MODE_I) {                 \
                 ebur128_calc_gating_block(st, st->d->samples_in_100ms * 4, NULL);      \
@@ -628,6 +699,27 @@ int ff_ebur128_loudness_shortterm(FFEBUR128State * st, double *out)
     return 0;
 }
 
+int ff_ebur128_loudness_window(FFEBUR128State * st,
+                               unsigned long window, double *out)
+{
+    double energy;
+    size_t interval_frames;
+    int error;
+
+    if (window > st->d->window)
+        return AVERROR(EINVAL);
+    interval_frames = st->samplerate * window / 1000;
+    error = ebur128_energy_in_interval(st, interval_frames, &energy);
+    if (error) {
+        return error;
+    } else if (energy <= 0.0) {
+        *out = -HUGE_VAL;
+        return 0;
+    }
+    *out = ebur128_energy_to_loudness(energy);
+    return 0;
+}
+
 /* EBU - TECH 3342 */
 int ff_ebur128_loudness_range_multiple(FFEBUR128State ** sts, size_t size,
                                        double *out)
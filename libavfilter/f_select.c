@@ -151,25 +151,23 @@ typedef struct SelectContext {
     AVExpr *expr;
     double var_values[VAR_VARS_NB];
     int bitdepth;
-    int nb_planes;
-    ptrdiff_t width[4];
-    ptrdiff_t height[4];
     int do_scene_detect;            ///< 1 if the expression requires scene detection variables, 0 otherwise
-    ff_scene_sad_fn sad;            ///< Sum of the absolute difference function (scene detect only)
+    FFSceneSADContext sad;          ///< frame difference engine                 (scene detect only)
     double prev_mafd;               ///< previous MAFD                           (scene detect only)
-    AVFrame *prev_picref;           ///< previous frame                          (scene detect only)
+    int lowres;                     ///< compare frames downscaled by 2^lowres   (scene detect only)
     double select;
     int select_out;                 ///< mark the selected output pad index
     int nb_outputs;
 } SelectContext;
 
 #define OFFSET(x) offsetof(SelectContext, x)
-#define DEFINE_OPTIONS(filt_name, FLAGS)                            \
+#define DEFINE_OPTIONS(filt_name, FLAGS, ...)                       \
 static const AVOption filt_name##_options[] = {                     \
     { "expr", "set an expression to use for selecting frames", OFFSET(expr_str), AV_OPT_TYPE_STRING, { .str = "1" }, .flags=FLAGS }, \
     { "e",    "set an expression to use for selecting frames", OFFSET(expr_str), AV_OPT_TYPE_STRING, { .str = "1" }, .flags=FLAGS }, \
     { "outputs", "set the number of outputs", OFFSET(nb_outputs), AV_OPT_TYPE_INT, {.i64 = 1}, 1, INT_MAX, .flags=FLAGS }, \
     { "n",       "set the number of outputs", OFFSET(nb_outputs), AV_OPT_TYPE_INT, {.i64 = 1}, 1, INT_MAX, .flags=FLAGS }, \
+    __VA_ARGS__                                                         \
     { NULL }                                                            \
 }
 
@@ -214,16 +212,17 @@ static int config_input(AVFilterLink *inlink)
     int is_yuv = !(desc->flags & AV_PIX_FMT_FLAG_RGB) &&
                  (desc->flags & AV_PIX_FMT_FLAG_PLANAR) &&
                  desc->nb_components >= 3;
+    int nb_planes = is_yuv ? 1 : av_pix_fmt_count_planes(inlink->format);
+    ptrdiff_t width[4], height[4];
 
     select->bitdepth = desc->comp[0].depth;
-    select->nb_planes = is_yuv ? 1 : av_pix_fmt_count_planes(inlink->format);
 
-    for (int plane = 0; plane < select->nb_planes; plane++) {
+    for (int plane = 0; plane < nb_planes; plane++) {
         ptrdiff_t line_size = av_image_get_linesize(inlink->format, inlink->w, plane);
         int vsub = desc->log2_chroma_h;
 
-        select->width[plane] = line_size >> (select->bitdepth > 8);
-        select->height[plane] = plane == 1 || plane == 2 ?  AV_CEIL_RSHIFT(inlink->h, vsub) : inlink->h;
+        width[plane]  = line_size >> (select->bitdepth > 8);
+        height[plane] = plane == 1 || plane == 2 ?  AV_CEIL_RSHIFT(inlink->h, vsub) : inlink->h;
     }
 
     select->var_values[VAR_N]          = 0.0;
@@ -264,45 +263,29 @@ static int config_input(AVFilterLink *inlink)
     select->var_values[VAR_SAMPLE_RATE] =
         inlink->type == AVMEDIA_TYPE_AUDIO ? inlink->sample_rate : NAN;
 
-    if (CONFIG_SELECT_FILTER && select->do_scene_detect) {
-        select->sad = ff_scene_sad_get_fn(select->bitdepth == 8 ? 8 : 16);
-        if (!select->sad)
-            return AVERROR(EINVAL);
-    }
+    if (CONFIG_SELECT_FILTER && select->do_scene_detect)
+        return ff_scene_sad_init(&select->sad, inlink->dst, desc, nb_planes,
+                                 width, height, select->lowres);
     return 0;
 }
 
-static double get_scene_score(AVFilterContext *ctx, AVFrame *frame)
+static int get_scene_score(AVFilterContext *ctx, AVFrame *frame)
 {
-    double ret = 0;
     SelectContext *select = ctx->priv;
-    AVFrame *prev_picref = select->prev_picref;
-
-    if (prev_picref &&
-        frame->height == prev_picref->height &&
-        frame->width  == prev_picref->width) {
-        uint64_t sad = 0;
-        double mafd, diff;
-        uint64_t count = 0;
-
-        for (int plane = 0; plane < select->nb_planes; plane++) {
-            uint64_t plane_sad;
-            select->sad(prev_picref->data[plane], prev_picref->linesize[plane],
-                    frame->data[plane], frame->linesize[plane],
-                    select->width[plane], select->height[plane], &plane_sad);
-            sad += plane_sad;
-            count += select->width[plane] * select->height[plane];
-        }
+    uint64_t sad, count;
+    double mafd, diff;
+    int ret;
 
-        emms_c();
-        mafd = (double)sad / count / (1ULL << (select->bitdepth - 8));
-        diff = fabs(mafd - select->prev_mafd);
-        ret  = av_clipf(FFMIN(mafd, diff) / 100., 0, 1);
-        select->prev_mafd = mafd;
-        av_frame_free(&prev_picref);
-    }
-    select->prev_picref = av_frame_clone(frame);
-    return ret;
+    select->var_values[VAR_SCENE] = 0;
+    ret = ff_scene_sad_next(&select->sad, frame, &sad, &count);
+    if (ret <= 0)
+        return ret;
+
+    mafd = (double)sad / count / (1ULL << (select->bitdepth - 8));
+    diff = fabs(mafd - select->prev_mafd);
+    select->var_values[VAR_SCENE] = av_clipf(FFMIN(mafd, diff) / 100., 0, 1);
+    select->prev_mafd = mafd;
+    return 0;
 }
 
 static double get_concatdec_select(AVFrame *frame, int64_t pts)
@@ -327,11 +310,12 @@ static double get_concatdec_select(AVFrame *frame, int64_t pts)
     return NAN;
 }
 
-static void select_frame(AVFilterContext *ctx, AVFrame *frame)
+static int select_frame(AVFilterContext *ctx, AVFrame *frame)
 {
     SelectContext *select = ctx->priv;
     AVFilterLink *inlink = ctx->inputs[0];
     double res;
+    int ret;
 
     if (isnan(select->var_values[VAR_START_PTS]))
         select->var_values[VAR_START_PTS] = TS2D(frame->pts);
@@ -359,9 +343,10 @@ FF_ENABLE_DEPRECATION_WARNINGS
             !frame->interlaced_frame ? INTERLACE_TYPE_P :
         frame->top_field_first ? INTERLACE_TYPE_T : INTERLACE_TYPE_B;
         select->var_values[VAR_PICT_TYPE] = frame->pict_type;
-        if (select->do_scene_detect) {
+        if (CONFIG_SELECT_FILTER && select->do_scene_detect) {
             char buf[32];
-            select->var_values[VAR_SCENE] = get_scene_score(ctx, frame);
+            if ((ret = get_scene_score(ctx, frame)) < 0)
+                return ret;
             // TODO: document metadata
             snprintf(buf, sizeof(buf), "%f", select->var_values[VAR_SCENE]);
             av_dict_set(&frame->metadata, "lavfi.scene_score", buf, 0);
@@ -413,14 +398,21 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
     select->var_values[VAR_PREV_PTS] = select->var_values[VAR_PTS];
     select->var_values[VAR_PREV_T]   = select->var_values[VAR_T];
+
+    return 0;
 }
 
 static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
 {
     AVFilterContext *ctx = inlink->dst;
     SelectContext *select = ctx->priv;
+    int ret;
 
-    select_frame(ctx, frame);
+    ret = select_frame(ctx, frame);
+    if (ret < 0) {
+        av_frame_free(&frame);
+        return ret;
+    }
     if (select->select)
         return ff_filter_frame(ctx->outputs[select->select_out], frame);
 
@@ -442,14 +434,13 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_expr_free(select->expr);
     select->expr = NULL;
 
-    if (select->do_scene_detect) {
-        av_frame_free(&select->prev_picref);
-    }
+    if (CONFIG_SELECT_FILTER && select->do_scene_detect)
+        ff_scene_sad_uninit(&select->sad);
 }
 
 #if CONFIG_ASELECT_FILTER
 
-DEFINE_OPTIONS(aselect, AV_OPT_FLAG_AUDIO_PARAM|AV_OPT_FLAG_FILTERING_PARAM);
+DEFINE_OPTIONS(aselect, AV_OPT_FLAG_AUDIO_PARAM|AV_OPT_FLAG_FILTERING_PARAM, );
 AVFILTER_DEFINE_CLASS(aselect);
 
 static av_cold int aselect_init(AVFilterContext *ctx)
@@ -510,7 +501,9 @@ static int query_formats(AVFilterContext *ctx)
     }
 }
 
-DEFINE_OPTIONS(select, AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM);
+DEFINE_OPTIONS(select, AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM,
+    { "lowres", "compare frames downscaled by 2^lowres for scene detection", OFFSET(lowres), AV_OPT_TYPE_INT, {.i64 = 0}, 0, SCENE_SAD_MAX_LOWRES, .flags=AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM },
+);
 AVFILTER_DEFINE_CLASS(select);
 
 static av_cold int select_init(AVFilterContext *ctx)
@@ -541,6 +534,7 @@ const AVFilter ff_vf_select = {
     .priv_class    = &select_class,
     FILTER_INPUTS(avfilter_vf_select_inputs),
     FILTER_QUERY_FUNC(query_formats),
-    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS | AVFILTER_FLAG_METADATA_ONLY,
+    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS | AVFILTER_FLAG_METADATA_ONLY |
+                     AVFILTER_FLAG_SLICE_THREADS,
 };
 #endif /* CONFIG_SELECT_FILTER */
@@ -52,7 +52,8 @@ FFFramePool *ff_frame_pool_video_init(AVBufferRef* (*alloc)(size_t size),
                                       int width,
                                       int height,
                                       enum AVPixelFormat format,
-                                      int align)
+                                      int align,
+                                      int pool_flags)
 {
     int i, ret;
     FFFramePool *pool;
@@ -99,7 +100,8 @@ FFFramePool *ff_frame_pool_video_init(AVBufferRef* (*alloc)(size_t size),
     for (i = 0; i < 4 && sizes[i]; i++) {
         if (sizes[i] > SIZE_MAX - align)
             goto fail;
-        pool->pools[i] = av_buffer_pool_init(sizes[i] + align, alloc);
+        pool->pools[i] = av_buffer_pool_init_flags(sizes[i] + align, alloc,
+                                                   pool_flags);
         if (!pool->pools[i])
             goto fail;
     }
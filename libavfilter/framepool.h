@@ -42,13 +42,15 @@ typedef struct FFFramePool FFFramePool;
  * @param height height of each frame in this pool
  * @param format format of each frame in this pool
  * @param align buffers alignement of each frame in this pool
+ * @param pool_flags AV_BUFFER_POOL_FLAG_* flags for the buffer pools
  * @return newly created video frame pool on success, NULL on error.
  */
 FFFramePool *ff_frame_pool_video_init(AVBufferRef* (*alloc)(size_t size),
                                       int width,
                                       int height,
                                       enum AVPixelFormat format,
-                                      int align);
+                                      int align,
+                                      int pool_flags);
 
 /**
  * Allocate and initialize an audio frame pool.
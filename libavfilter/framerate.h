@@ -48,7 +48,7 @@ typedef struct FrameRateContext {
     AVRational srce_time_base;          ///< timebase of source
     AVRational dest_time_base;          ///< timebase of destination
 
-    ff_scene_sad_fn sad;                ///< Sum of the absolute difference function (scene detect only)
+    FFSceneSADContext sad;              ///< frame difference engine                 (scene detect only)
     double prev_mafd;                   ///< previous MAFD                           (scene detect only)
 
     int blend_factor_max;
@@ -25,6 +25,7 @@
  */
 
 #include "libavutil/internal.h"
+#include "libavutil/thread.h"
 #include "avfilter.h"
 #include "formats.h"
 #include "framequeue.h"
@@ -43,6 +44,12 @@ typedef struct AVFilterCommand {
  */
 void ff_avfilter_graph_update_heap(AVFilterGraph *graph, AVFilterLink *link);
 
+/**
+ * Update the position of a filter in the ready queue after its ready
+ * field changed, inserting or removing it as necessary.
+ */
+void ff_filter_graph_update_ready(AVFilterGraph *graph, AVFilterContext *filter);
+
 /**
  * A filter pad used for either input or output.
  */
@@ -133,6 +140,51 @@ struct AVFilterGraphInternal {
     void *thread;
     avfilter_execute_func *thread_execute;
     FFFrameQueueGlobal frame_queues;
+
+    /**
+     * Binary max-heap of the filters with a non-zero ready field, ordered
+     * by ready and then by position in graph->filters.
+     * Allocated alongside graph->filters so that it never has to grow
+     * while the graph is running.
+     */
+    AVFilterContext **ready_heap;
+    int nb_ready;
+
+    /**
+     * Graph-level executor activating independent filters concurrently,
+     * NULL if disabled.
+     */
+    void *graph_thread;
+
+    /**
+     * Scratch arrays used to select the filters of a parallel batch,
+     * holding up to graph_batch_max and 2 * graph_batch_max entries.
+     */
+    AVFilterContext **batch;
+    AVFilterContext **batch_deferred;
+    int graph_batch_max;
+    unsigned batch_id;
+
+    /**
+     * Nonzero while several filters are being activated concurrently.
+     * Only changed by the thread driving the graph, while no batch runs.
+     */
+    int batch_running;
+
+    /**
+     * Commands sent with avfilter_graph_send_command() while a batch runs,
+     * e.g. by sendcmd or zmq. Their target may be activating on another
+     * thread, so they are run once the batch has completed.
+     * Protected by batch_lock.
+     */
+    struct FFGraphCommand *deferred_commands;
+    struct FFGraphCommand **deferred_commands_tail;
+
+    /**
+     * Protects the ready queue, the ready fields, the sink links heap and
+     * the deferred commands while batch_running is set.
+     */
+    AVMutex batch_lock;
 };
 
 struct AVFilterInternal {
@@ -141,8 +193,56 @@ struct AVFilterInternal {
     // 1 when avfilter_init_*() was successfully called on this filter
     // 0 otherwise
     int initialized;
+
+    /**
+     * Position of the filter in graph->filters.
+     */
+    unsigned graph_index;
+
+    /**
+     * Position of the filter in the graph ready queue, -1 if not queued.
+     */
+    int ready_index;
+
+    /**
+     * Last batch in which the filter was within two links of a filter
+     * selected for parallel activation.
+     */
+    unsigned batch_mark;
+    /**
+     * Merge the processing of the next filter into this one. Set by the
+     * filters supporting it in their init callback.
+     *
+     * Called once the graph links are configured, for pairs of directly
+     * linked filters sharing this callback, each with a single input and
+     * output and without timeline support enabled. Filters with different
+     * callbacks are never merged, so only adjacent filters of the same
+     * implementation (e.g. lut/lutyuv/lutrgb, or curves) are fused. If ctx was itself merged
+     * into a previous filter, it must forward the request to that filter.
+     * On success, the filter applying the merged processing does it in the
+     * same pass over the frame, and next passes its input frames through.
+     *
+     * Called with next set to NULL before the timeline of ctx is changed at
+     * runtime; the filters merged with ctx must then go back to processing
+     * frames separately.
+     *
+     * @return 1 if next was merged, 0 if not, a negative AVERROR on error
+     */
+    int (*fuse)(AVFilterContext *ctx, AVFilterContext *next);
 };
 
+static av_always_inline void ff_graph_lock(AVFilterGraph *graph)
+{
+    if (graph->internal->batch_running)
+        ff_mutex_lock(&graph->internal->batch_lock);
+}
+
+static av_always_inline void ff_graph_unlock(AVFilterGraph *graph)
+{
+    if (graph->internal->batch_running)
+        ff_mutex_unlock(&graph->internal->batch_lock);
+}
+
 static av_always_inline int ff_filter_execute(AVFilterContext *ctx, avfilter_action_func *func,
                                               void *arg, int *ret, int nb_jobs)
 {
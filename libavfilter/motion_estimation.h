@@ -21,8 +21,12 @@
 #ifndef AVFILTER_MOTION_ESTIMATION_H
 #define AVFILTER_MOTION_ESTIMATION_H
 
+#include <stddef.h>
 #include <stdint.h>
 
+#include "libavutil/common.h"
+#include "libavutil/pixelutils.h"
+
 #define AV_ME_METHOD_ESA        1
 #define AV_ME_METHOD_TSS        2
 #define AV_ME_METHOD_TDLS       3
@@ -59,8 +63,37 @@ typedef struct AVMotionEstContext {
 
     uint64_t (*get_cost)(struct AVMotionEstContext *me_ctx, int x_mb, int y_mb,
                          int mv_x, int mv_y);
+
+    av_pixelutils_sad_fn sad[6]; ///< block SAD functions indexed by log2 of the block size
 } AVMotionEstContext;
 
+/**
+ * Sum of absolute differences between two size x size blocks with the
+ * context's linesize. Uses the pixelutils functions when available.
+ */
+static inline uint64_t ff_me_block_sad(const AVMotionEstContext *me_ctx,
+                                       const uint8_t *src1, const uint8_t *src2,
+                                       int size)
+{
+    const ptrdiff_t linesize = me_ctx->linesize;
+    const int log2_size = av_log2(size);
+    uint64_t sad = 0;
+    int i, j;
+
+    if (size == 1 << log2_size && log2_size < FF_ARRAY_ELEMS(me_ctx->sad) &&
+        me_ctx->sad[log2_size])
+        return me_ctx->sad[log2_size](src1, linesize, src2, linesize);
+
+    for (j = 0; j < size; j++) {
+        for (i = 0; i < size; i++)
+            sad += FFABS(src1[i] - src2[i]);
+        src1 += linesize;
+        src2 += linesize;
+    }
+
+    return sad;
+}
+
 void ff_me_init_context(AVMotionEstContext *me_ctx, int mb_size, int search_param,
                         int width, int height, int x_min, int x_max, int y_min, int y_max);
 
@@ -24,9 +24,11 @@
 #include <stddef.h>
 
 #include "libavutil/error.h"
+#include "libavutil/log.h"
 #include "libavutil/macros.h"
 #include "libavutil/mem.h"
 #include "libavutil/slicethread.h"
+#include "libavutil/thread.h"
 
 #include "avfilter.h"
 #include "internal.h"
@@ -56,13 +58,40 @@ static void slice_thread_uninit(ThreadContext *c)
     avpriv_slicethread_free(&c->thread);
 }
 
+typedef struct GraphThreadContext {
+    AVSliceThread *thread;
+
+    /* per-execute parameters */
+    AVFilterContext **filters;
+    int   *rets;
+} GraphThreadContext;
+
+static void graph_worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    GraphThreadContext *c = priv;
+    c->rets[jobnr] = ff_filter_activate(c->filters[jobnr]);
+}
+
 static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
                           void *arg, int *ret, int nb_jobs)
 {
     ThreadContext *c = ctx->graph->internal->thread;
+    int i;
 
     if (nb_jobs <= 0)
         return 0;
+
+    /* The slice threads cannot be shared by concurrently activated filters:
+     * run the jobs in the calling graph worker instead. */
+    if (ctx->graph->internal->batch_running) {
+        for (i = 0; i < nb_jobs; i++) {
+            int r = func(ctx, arg, i, nb_jobs);
+            if (ret)
+                ret[i] = r;
+        }
+        return 0;
+    }
+
     c->ctx         = ctx;
     c->arg         = arg;
     c->func        = func;
@@ -80,8 +109,18 @@ static int thread_init_internal(ThreadContext *c, int nb_threads)
     return FFMAX(nb_threads, 1);
 }
 
+static int graph_affinity_push(AVFilterGraph *graph, void **saved)
+{
+    int ret = avpriv_thread_affinity_push(graph->thread_affinity, saved);
+    if (ret < 0)
+        av_log(graph, AV_LOG_ERROR, "Could not set thread affinity '%s'\n",
+               graph->thread_affinity);
+    return ret;
+}
+
 int ff_graph_thread_init(AVFilterGraph *graph)
 {
+    void *affinity;
     int ret;
 
     if (graph->nb_threads == 1) {
@@ -93,7 +132,11 @@ int ff_graph_thread_init(AVFilterGraph *graph)
     if (!graph->internal->thread)
         return AVERROR(ENOMEM);
 
-    ret = thread_init_internal(graph->internal->thread, graph->nb_threads);
+    ret = graph_affinity_push(graph, &affinity);
+    if (ret >= 0) {
+        ret = thread_init_internal(graph->internal->thread, graph->nb_threads);
+        avpriv_thread_affinity_pop(&affinity);
+    }
     if (ret <= 1) {
         av_freep(&graph->internal->thread);
         graph->thread_type = 0;
@@ -113,3 +156,80 @@ void ff_graph_thread_free(AVFilterGraph *graph)
         slice_thread_uninit(graph->internal->thread);
     av_freep(&graph->internal->thread);
 }
+
+int ff_graph_parallel_init(AVFilterGraph *graph)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    GraphThreadContext *c;
+    void *affinity;
+    int ret;
+
+    if (graph->nb_graph_threads == 1 || gi->graph_thread)
+        return 0;
+    if (graph->execute) {
+        av_log(graph, AV_LOG_WARNING, "Parallel filter activation is not "
+               "supported with a custom execute callback, disabling it.\n");
+        return 0;
+    }
+
+    c = av_mallocz(sizeof(*c));
+    if (!c)
+        return AVERROR(ENOMEM);
+
+    ret = graph_affinity_push(graph, &affinity);
+    if (ret >= 0) {
+        ret = avpriv_slicethread_create(&c->thread, c, graph_worker_func, NULL,
+                                        graph->nb_graph_threads);
+        avpriv_thread_affinity_pop(&affinity);
+    }
+    if (ret <= 1) {
+        avpriv_slicethread_free(&c->thread);
+        av_free(c);
+        return ret < 0 ? ret : 0;
+    }
+
+    gi->batch          = av_calloc(ret, sizeof(*gi->batch));
+    gi->batch_deferred = av_calloc(2 * ret, sizeof(*gi->batch_deferred));
+    c->rets            = av_calloc(ret, sizeof(*c->rets));
+    if (!gi->batch || !gi->batch_deferred || !c->rets) {
+        gi->graph_thread = c;
+        ff_graph_parallel_free(graph);
+        return AVERROR(ENOMEM);
+    }
+    gi->graph_batch_max = ret;
+    gi->graph_thread    = c;
+
+    return 0;
+}
+
+int ff_graph_parallel_execute(AVFilterGraph *graph,
+                              AVFilterContext **filters, int nb_filters)
+{
+    GraphThreadContext *c = graph->internal->graph_thread;
+    int i, ret = 0;
+
+    c->filters = filters;
+    graph->internal->batch_running = 1;
+    avpriv_slicethread_execute(c->thread, nb_filters, 0);
+    graph->internal->batch_running = 0;
+
+    for (i = 0; i < nb_filters; i++)
+        if (c->rets[i] < 0 && ret >= 0)
+            ret = c->rets[i];
+    return ret;
+}
+
+void ff_graph_parallel_free(AVFilterGraph *graph)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    GraphThreadContext *c = gi->graph_thread;
+
+    if (c) {
+        avpriv_slicethread_free(&c->thread);
+        av_freep(&c->rets);
+    }
+    av_freep(&gi->graph_thread);
+    av_freep(&gi->batch);
+    av_freep(&gi->batch_deferred);
+    gi->graph_batch_max = 0;
+}
@@ -21,6 +21,9 @@
  * Scene SAD functions
  */
 
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+#include "internal.h"
 #include "scene_sad.h"
 
 void ff_scene_sad16_c(SCENE_SAD_PARAMS)
@@ -71,3 +74,238 @@ ff_scene_sad_fn ff_scene_sad_get_fn(int depth)
     return sad;
 }
 
+
+typedef struct ThreadData {
+    FFSceneSADContext *s;
+    const AVFrame *a, *b;               ///< frames compared at full resolution
+    const AVFrame *in;                  ///< frame to downscale
+    int compare;                        ///< compare the downscaled frame with the previous one
+} ThreadData;
+
+/**
+ * Decimate rows y_start to y_end of the current downscaled frame: only the
+ * first of every 2^lowres input rows is read, and it is box filtered
+ * horizontally, which keeps the memory traffic at 1/2^lowres of the frame.
+ */
+static void downscale_rows(FFSceneSADContext *s, const AVFrame *in, int plane,
+                           int y_start, int y_end)
+{
+    const int lowres = s->lowres;
+    const int step = s->step[plane];
+    const ptrdiff_t width = s->lowres_width[plane] / step;
+    const ptrdiff_t linesize = s->lowres_linesize[plane];
+    const unsigned round = (1U << lowres) >> 1;
+
+    for (int y = y_start; y < y_end; y++) {
+        const uint8_t *src = in->data[plane] + (ptrdiff_t)(y << lowres) * in->linesize[plane];
+        uint8_t *dst = s->lowres_data[s->cur][plane] + y * linesize;
+
+        if (s->depth == 8 && step == 1) {
+            for (int x = 0; x < width; x++) {
+                const uint8_t *p = src + (x << lowres);
+                unsigned v = round;
+
+                for (int i = 0; i < 1 << lowres; i++)
+                    v += p[i];
+                dst[x] = v >> lowres;
+            }
+        } else if (s->depth == 8) {
+            for (int x = 0; x < width; x++) {
+                for (int c = 0; c < step; c++) {
+                    const uint8_t *p = src + (x << lowres) * step + c;
+                    unsigned v = round;
+
+                    for (int i = 0; i < 1 << lowres; i++)
+                        v += p[i * step];
+                    dst[x * step + c] = v >> lowres;
+                }
+            }
+        } else {
+            const uint16_t *src16 = (const uint16_t *)src;
+            uint16_t *dst16 = (uint16_t *)dst;
+
+            for (int x = 0; x < width; x++) {
+                for (int c = 0; c < step; c++) {
+                    const uint16_t *p = src16 + (x << lowres) * step + c;
+                    unsigned v = round;
+
+                    for (int i = 0; i < 1 << lowres; i++)
+                        v += p[i * step];
+                    dst16[x * step + c] = v >> lowres;
+                }
+            }
+        }
+    }
+}
+
+static int sad_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const ThreadData *td = arg;
+    FFSceneSADContext *s = td->s;
+    uint64_t sum = 0;
+
+    for (int plane = 0; plane < s->nb_planes; plane++) {
+        const int height = s->lowres ? s->lowres_height[plane] : s->height[plane];
+        const int slice_start = (height *  jobnr     ) / nb_jobs;
+        const int slice_end   = (height * (jobnr + 1)) / nb_jobs;
+        uint64_t plane_sad;
+
+        if (slice_start >= slice_end)
+            continue;
+
+        if (!s->lowres) {
+            s->sad(td->a->data[plane] + slice_start * td->a->linesize[plane], td->a->linesize[plane],
+                   td->b->data[plane] + slice_start * td->b->linesize[plane], td->b->linesize[plane],
+                   s->width[plane], slice_end - slice_start, &plane_sad);
+            sum += plane_sad;
+        } else {
+            const ptrdiff_t linesize = s->lowres_linesize[plane];
+
+            downscale_rows(s, td->in, plane, slice_start, slice_end);
+            if (td->compare) {
+                s->sad(s->lowres_data[!s->cur][plane] + slice_start * linesize, linesize,
+                       s->lowres_data[ s->cur][plane] + slice_start * linesize, linesize,
+                       s->lowres_width[plane], slice_end - slice_start, &plane_sad);
+                sum += plane_sad;
+            }
+        }
+    }
+    emms_c();
+
+    s->slice_sad[jobnr] = sum;
+    return 0;
+}
+
+static int get_nb_jobs(FFSceneSADContext *s)
+{
+    const int height = s->lowres ? s->lowres_height[0] : s->height[0];
+    return av_clip(FFMIN(ff_filter_get_nb_threads(s->ctx), s->nb_slices), 1, FFMAX(height, 1));
+}
+
+static uint64_t sum_slices(FFSceneSADContext *s, int nb_jobs)
+{
+    uint64_t sad = 0;
+
+    for (int i = 0; i < nb_jobs; i++)
+        sad += s->slice_sad[i];
+    return sad;
+}
+
+int ff_scene_sad_init(FFSceneSADContext *s, AVFilterContext *ctx,
+                      const AVPixFmtDescriptor *desc, int nb_planes,
+                      const ptrdiff_t *width, const ptrdiff_t *height,
+                      int lowres)
+{
+    const int bytes = desc->comp[0].depth > 8 ? 2 : 1;
+
+    ff_scene_sad_uninit(s);
+
+    s->ctx       = ctx;
+    s->depth     = bytes == 1 ? 8 : 16;
+    s->nb_planes = nb_planes;
+    s->sad       = ff_scene_sad_get_fn(s->depth);
+    if (!s->sad)
+        return AVERROR(EINVAL);
+
+    for (int plane = 0; plane < nb_planes; plane++) {
+        s->width[plane]  = width[plane];
+        s->height[plane] = height[plane];
+        s->step[plane]   = 1;
+        for (int i = 0; i < desc->nb_components; i++)
+            if (desc->comp[i].plane == plane)
+                s->step[plane] = FFMAX(s->step[plane], desc->comp[i].step / bytes);
+    }
+
+    /* keep at least one sample per plane */
+    for (int plane = 0; plane < nb_planes; plane++)
+        while (lowres && (!(s->width[plane] / s->step[plane] >> lowres) ||
+                          !(s->height[plane] >> lowres)))
+            lowres--;
+    s->lowres = lowres;
+
+    s->nb_slices = FFMAX(ff_filter_get_nb_threads(ctx), 1);
+    s->slice_sad = av_calloc(s->nb_slices, sizeof(*s->slice_sad));
+    if (!s->slice_sad)
+        return AVERROR(ENOMEM);
+
+    if (!lowres)
+        return 0;
+
+    for (int plane = 0; plane < nb_planes; plane++) {
+        s->lowres_width[plane]    = (s->width[plane] / s->step[plane] >> lowres) * s->step[plane];
+        s->lowres_height[plane]   = s->height[plane] >> lowres;
+        s->lowres_linesize[plane] = FFALIGN(s->lowres_width[plane] * bytes, 32);
+        for (int i = 0; i < 2; i++) {
+            s->lowres_data[i][plane] = av_malloc(s->lowres_linesize[plane] * s->lowres_height[plane]);
+            if (!s->lowres_data[i][plane])
+                return AVERROR(ENOMEM);
+        }
+    }
+
+    return 0;
+}
+
+void ff_scene_sad_frames(FFSceneSADContext *s, const AVFrame *a, const AVFrame *b,
+                         uint64_t *sad, uint64_t *count)
+{
+    ThreadData td = { .s = s, .a = a, .b = b };
+    const int lowres = s->lowres;
+    int nb_jobs;
+
+    s->lowres = 0;
+    nb_jobs = get_nb_jobs(s);
+    ff_filter_execute(s->ctx, sad_slice, &td, NULL, nb_jobs);
+    s->lowres = lowres;
+
+    *sad   = sum_slices(s, nb_jobs);
+    *count = 0;
+    for (int plane = 0; plane < s->nb_planes; plane++)
+        *count += s->width[plane] * s->height[plane];
+}
+
+int ff_scene_sad_next(FFSceneSADContext *s, const AVFrame *frame,
+                      uint64_t *sad, uint64_t *count)
+{
+    const int compare = s->prev_w == frame->width && s->prev_h == frame->height;
+    ThreadData td = { .s = s, .in = frame, .compare = compare };
+    int nb_jobs;
+
+    s->prev_w = frame->width;
+    s->prev_h = frame->height;
+
+    if (!s->lowres) {
+        if (compare)
+            ff_scene_sad_frames(s, s->prev, frame, sad, count);
+        av_frame_free(&s->prev);
+        s->prev = av_frame_clone(frame);
+        if (!s->prev) {
+            s->prev_w = s->prev_h = 0;
+            return AVERROR(ENOMEM);
+        }
+        return compare;
+    }
+
+    nb_jobs = get_nb_jobs(s);
+    ff_filter_execute(s->ctx, sad_slice, &td, NULL, nb_jobs);
+    s->cur ^= 1;
+
+    if (!compare)
+        return 0;
+
+    *sad   = sum_slices(s, nb_jobs);
+    *count = 0;
+    for (int plane = 0; plane < s->nb_planes; plane++)
+        *count += s->lowres_width[plane] * s->lowres_height[plane];
+    return 1;
+}
+
+void ff_scene_sad_uninit(FFSceneSADContext *s)
+{
+    for (int plane = 0; plane < 4; plane++) {
+        av_freep(&s->lowres_data[0][plane]);
+        av_freep(&s->lowres_data[1][plane]);
+    }
+    av_freep(&s->slice_sad);
+    av_frame_free(&s->prev);
+    s->prev_w = s->prev_h = 0;
+}
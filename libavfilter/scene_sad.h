@@ -24,6 +24,8 @@
 #ifndef AVFILTER_SCENE_SAD_H
 #define AVFILTER_SCENE_SAD_H
 
+#include "libavutil/frame.h"
+#include "libavutil/pixdesc.h"
 #include "avfilter.h"
 
 #define SCENE_SAD_PARAMS const uint8_t *src1, ptrdiff_t stride1, \
@@ -41,4 +43,61 @@ ff_scene_sad_fn ff_scene_sad_get_fn_x86(int depth);
 
 ff_scene_sad_fn ff_scene_sad_get_fn(int depth);
 
+#define SCENE_SAD_MAX_LOWRES 4
+
+/**
+ * Sum of absolute differences between consecutive frames, as used for
+ * scene change detection. The frames can be compared after decimation
+ * by 2^lowres in both directions, and the work is split into slice jobs
+ * of the owning filter.
+ */
+typedef struct FFSceneSADContext {
+    AVFilterContext *ctx;
+    ff_scene_sad_fn sad;
+    int depth;                          ///< 8 or 16 bits per sample
+    int nb_planes;
+    int lowres;
+    ptrdiff_t width[4];                 ///< plane width in samples
+    ptrdiff_t height[4];
+    int step[4];                        ///< samples per pixel in each plane
+    ptrdiff_t lowres_width[4];          ///< downscaled plane width in samples
+    ptrdiff_t lowres_height[4];
+    ptrdiff_t lowres_linesize[4];
+    uint8_t *lowres_data[2][4];         ///< downscaled previous and current frame
+    int cur;                            ///< index of the current frame in lowres_data
+    int prev_w, prev_h;                 ///< dimensions of the previous frame, 0 if none
+    AVFrame *prev;                      ///< previous frame, if lowres is 0
+    uint64_t *slice_sad;
+    int nb_slices;
+} FFSceneSADContext;
+
+/**
+ * Initialize the context for comparing nb_planes planes of the given
+ * dimensions (in samples, with interleaved components counted separately).
+ */
+int ff_scene_sad_init(FFSceneSADContext *s, AVFilterContext *ctx,
+                      const AVPixFmtDescriptor *desc, int nb_planes,
+                      const ptrdiff_t *width, const ptrdiff_t *height,
+                      int lowres);
+
+/**
+ * Compute the SAD between two frames at full resolution.
+ *
+ * @param count set to the number of compared samples
+ */
+void ff_scene_sad_frames(FFSceneSADContext *s, const AVFrame *a, const AVFrame *b,
+                         uint64_t *sad, uint64_t *count);
+
+/**
+ * Compare frame with the frame passed to the previous call, and keep it
+ * as reference for the next call.
+ *
+ * @return 1 if sad and count were set, 0 if there was no previous frame of
+ *         the same dimensions, a negative error code on failure
+ */
+int ff_scene_sad_next(FFSceneSADContext *s, const AVFrame *frame,
+                      uint64_t *sad, uint64_t *count);
+
+void ff_scene_sad_uninit(FFSceneSADContext *s);
+
 #endif /* AVFILTER_SCENE_SAD_H */
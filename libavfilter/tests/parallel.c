@@ -0,0 +1,124 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * Run a self-contained filtergraph ending in a buffersink with the given
+ * number of graph threads, and print a checksum of every output frame, so
+ * that parallel activation can be compared with serial execution.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/adler32.h"
+#include "libavutil/common.h"
+#include "libavutil/frame.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/log.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/samplefmt.h"
+
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+
+static uint32_t frame_checksum(const AVFrame *frame, int is_video)
+{
+    uint32_t crc = 0;
+    int p;
+
+    if (is_video) {
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(frame->format);
+        int planes = av_pix_fmt_count_planes(frame->format);
+
+        for (p = 0; p < planes; p++) {
+            int h = frame->height;
+            int w = av_image_get_linesize(frame->format, frame->width, p);
+            int y;
+
+            if (p == 1 || p == 2)
+                h = AV_CEIL_RSHIFT(h, desc->log2_chroma_h);
+            for (y = 0; y < h; y++)
+                crc = av_adler32_update(crc, frame->data[p] + y * frame->linesize[p], w);
+        }
+    } else {
+        int channels = frame->ch_layout.nb_channels;
+        int planar   = av_sample_fmt_is_planar(frame->format);
+        int size     = frame->nb_samples * av_get_bytes_per_sample(frame->format) *
+                       (planar ? 1 : channels);
+
+        for (p = 0; p < (planar ? channels : 1); p++)
+            crc = av_adler32_update(crc, frame->extended_data[p], size);
+    }
+    return crc;
+}
+
+int main(int argc, char **argv)
+{
+    AVFilterGraph *graph = NULL;
+    AVFilterContext *sink = NULL;
+    AVFrame *frame = NULL;
+    unsigned i;
+    int ret, is_video, n = 0;
+
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <graph_threads> <filtergraph>\n", argv[0]);
+        return 1;
+    }
+
+    av_log_set_level(AV_LOG_ERROR);
+
+    graph = avfilter_graph_alloc();
+    frame = av_frame_alloc();
+    if (!graph || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    if ((ret = av_opt_set(graph, "graph_threads", argv[1], 0)) < 0 ||
+        (ret = avfilter_graph_parse_ptr(graph, argv[2], NULL, NULL, NULL)) < 0 ||
+        (ret = avfilter_graph_config(graph, NULL)) < 0)
+        goto end;
+
+    for (i = 0; i < graph->nb_filters; i++) {
+        const char *name = graph->filters[i]->filter->name;
+        if (!strcmp(name, "buffersink") || !strcmp(name, "abuffersink"))
+            sink = graph->filters[i];
+    }
+    if (!sink) {
+        fprintf(stderr, "The filtergraph has no buffersink\n");
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+    is_video = av_buffersink_get_type(sink) == AVMEDIA_TYPE_VIDEO;
+
+    while ((ret = av_buffersink_get_frame(sink, frame)) >= 0) {
+        printf("%d, %10"PRId64", 0x%08"PRIx32"\n", n++, frame->pts,
+               frame_checksum(frame, is_video));
+        av_frame_unref(frame);
+    }
+    if (ret == AVERROR_EOF)
+        ret = 0;
+
+end:
+    if (ret < 0)
+        fprintf(stderr, "Error: %s\n", av_err2str(ret));
+    av_frame_free(&frame);
+    avfilter_graph_free(&graph);
+    return ret < 0;
+}
@@ -25,4 +25,21 @@ int ff_graph_thread_init(AVFilterGraph *graph);
 
 void ff_graph_thread_free(AVFilterGraph *graph);
 
+/**
+ * Create the graph-level executor used to activate independent filters
+ * concurrently, according to AVFilterGraph.nb_graph_threads.
+ */
+int ff_graph_parallel_init(AVFilterGraph *graph);
+
+/**
+ * Activate the given filters concurrently and wait for all of them.
+ * The filters must not share any link nor any neighbour filter.
+ *
+ * @return 0 on success, the first negative activation result otherwise
+ */
+int ff_graph_parallel_execute(AVFilterGraph *graph,
+                              AVFilterContext **filters, int nb_filters);
+
+void ff_graph_parallel_free(AVFilterGraph *graph);
+
 #endif /* AVFILTER_THREAD_H */
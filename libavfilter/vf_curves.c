@@ -81,11 +81,23 @@ typedef struct CurvesContext {
     int parsed_psfile;
     int interp;
 
+    uint16_t *fused_graph[NB_COMP]; ///< tables composed with the fused filters, if any
+    AVFilterContext *fuse_head;     ///< filter applying this filter's tables, if fused
+    AVFilterContext *fuse_next;     ///< next filter of the fused chain
+
+    /* Fusion state shared between the filters of a chain, protected by the
+     * graph lock, see vf_lut. */
+    uint16_t *pending_graph[NB_COMP]; ///< next fused tables of the head
+    int fuse_pending;               ///< head: pending_graph must be switched to
+    int64_t nb_fused;               ///< head: number of output frames made with fused tables
+    int64_t fused_frames;           ///< number of input frames already processed by a former head
+
     int (*filter_slice)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs);
 } CurvesContext;
 
 typedef struct ThreadData {
     AVFrame *in, *out;
+    uint16_t *const *graph;
 } ThreadData;
 
 #define OFFSET(x) offsetof(CurvesContext, x)
@@ -697,6 +709,125 @@ static int dump_curves(const char *fname, uint16_t *graph[NB_COMP + 1],
     return 0;
 }
 
+/**
+ * Compose the tables of a fused chain for its head, which will switch to them
+ * at its next frame.
+ */
+static int fuse_update(AVFilterContext *head)
+{
+    CurvesContext *curves = head->priv;
+    uint16_t *graph[NB_COMP] = { NULL };
+    AVFilterContext *next;
+    int i, j;
+
+    for (i = 0; i < NB_COMP; i++) {
+        graph[i] = av_malloc_array(curves->lut_size, sizeof(*graph[i]));
+        if (!graph[i]) {
+            while (i--)
+                av_freep(&graph[i]);
+            return AVERROR(ENOMEM);
+        }
+    }
+
+    ff_graph_lock(head->graph);
+    for (i = 0; i < NB_COMP; i++)
+        memcpy(graph[i], curves->graph[i], curves->lut_size * sizeof(*graph[i]));
+    for (next = curves->fuse_next; next; next = ((CurvesContext *)next->priv)->fuse_next) {
+        const CurvesContext *n = next->priv;
+
+        for (i = 0; i < NB_COMP; i++)
+            for (j = 0; j < curves->lut_size; j++)
+                graph[i][j] = n->graph[i][graph[i][j]];
+    }
+    for (i = 0; i < NB_COMP; i++) {
+        av_free(curves->pending_graph[i]);
+        curves->pending_graph[i] = graph[i];
+    }
+    curves->fuse_pending = 1;
+    ff_graph_unlock(head->graph);
+    return 0;
+}
+
+/**
+ * Split a fused chain. The head goes back to its own tables at its next
+ * frame, and the other filters keep passing through the frames that it has
+ * already processed with the fused ones.
+ */
+static void fuse_reset(AVFilterContext *ctx)
+{
+    CurvesContext *curves = ctx->priv;
+    AVFilterContext *head = curves->fuse_head ? curves->fuse_head : ctx;
+    CurvesContext *h = head->priv;
+    AVFilterContext *next;
+    int i;
+
+    ff_graph_lock(ctx->graph);
+    next = h->fuse_next;
+    while (next) {
+        CurvesContext *n = next->priv;
+        next = n->fuse_next;
+        n->fuse_head    = n->fuse_next = NULL;
+        n->fused_frames = h->nb_fused;
+    }
+    h->fuse_next = NULL;
+    for (i = 0; i < NB_COMP; i++)
+        av_freep(&h->pending_graph[i]);
+    h->fuse_pending = 1;
+    ff_graph_unlock(ctx->graph);
+}
+
+static int fuse(AVFilterContext *ctx, AVFilterContext *next)
+{
+    CurvesContext *curves = ctx->priv;
+    AVFilterContext *head = curves->fuse_head ? curves->fuse_head : ctx;
+    CurvesContext *n;
+    int ret;
+
+    if (!next) {
+        /* timeline change: every filter of the chain works on its own again */
+        if (curves->fuse_head || curves->fuse_next)
+            fuse_reset(ctx);
+        return 0;
+    }
+
+    n = next->priv;
+    curves->fuse_next = next;
+    n->fuse_head      = head;
+    ret = fuse_update(head);
+    if (ret < 0)
+        return ret;
+
+    av_log(next, AV_LOG_VERBOSE, "fused into '%s'\n", head->name);
+    return 1;
+}
+
+/**
+ * Called at the start of every frame. Switch the head of a fused chain to
+ * its latest tables.
+ *
+ * @return 1 if the frame was already processed by the head of a fused chain
+ */
+static int fuse_sync(AVFilterContext *ctx)
+{
+    CurvesContext *curves = ctx->priv;
+    int i, skip;
+
+    ff_graph_lock(ctx->graph);
+    if (curves->fuse_pending) {
+        for (i = 0; i < NB_COMP; i++) {
+            av_free(curves->fused_graph[i]);
+            curves->fused_graph[i]   = curves->pending_graph[i];
+            curves->pending_graph[i] = NULL;
+        }
+        curves->fuse_pending = 0;
+    }
+    if (curves->fused_graph[0])
+        curves->nb_fused = ctx->outputs[0]->frame_count_in + 1;
+    skip = curves->fuse_head || ctx->inputs[0]->frame_count_out < curves->fused_frames;
+    ff_graph_unlock(ctx->graph);
+    return skip;
+}
+
 static av_cold int curves_init(AVFilterContext *ctx)
 {
     int i, ret;
@@ -738,6 +869,8 @@ static av_cold int curves_init(AVFilterContext *ctx)
         curves->preset = PRESET_NONE;
     }
 
+    ctx->internal->fuse = fuse;
+
     return 0;
 }
 
@@ -763,9 +896,9 @@ static int filter_slice_packed(AVFilterContext *ctx, void *arg, int jobnr, int n
             const uint16_t *srcp = (const uint16_t *)(in ->data[0] + y *  in->linesize[0]);
 
             for (x = 0; x < in->width * step; x += step) {
-                dstp[x + r] = curves->graph[R][srcp[x + r]];
-                dstp[x + g] = curves->graph[G][srcp[x + g]];
-                dstp[x + b] = curves->graph[B][srcp[x + b]];
+                dstp[x + r] = td->graph[R][srcp[x + r]];
+                dstp[x + g] = td->graph[G][srcp[x + g]];
+                dstp[x + b] = td->graph[B][srcp[x + b]];
                 if (!direct && step == 4)
                     dstp[x + a] = srcp[x + a];
             }
@@ -776,9 +909,9 @@ static int filter_slice_packed(AVFilterContext *ctx, void *arg, int jobnr, int n
 
         for (y = slice_start; y < slice_end; y++) {
             for (x = 0; x < in->width * step; x += step) {
-                dst[x + r] = curves->graph[R][src[x + r]];
-                dst[x + g] = curves->graph[G][src[x + g]];
-                dst[x + b] = curves->graph[B][src[x + b]];
+                dst[x + r] = td->graph[R][src[x + r]];
+                dst[x + g] = td->graph[G][src[x + g]];
+                dst[x + b] = td->graph[B][src[x + b]];
                 if (!direct && step == 4)
                     dst[x + a] = src[x + a];
             }
@@ -817,9 +950,9 @@ static int filter_slice_planar(AVFilterContext *ctx, void *arg, int jobnr, int n
             const uint16_t *srcap = (const uint16_t *)(in ->data[a] + y *  in->linesize[a]);
 
             for (x = 0; x < in->width; x++) {
-                dstrp[x] = curves->graph[R][srcrp[x]];
-                dstgp[x] = curves->graph[G][srcgp[x]];
-                dstbp[x] = curves->graph[B][srcbp[x]];
+                dstrp[x] = td->graph[R][srcrp[x]];
+                dstgp[x] = td->graph[G][srcgp[x]];
+                dstbp[x] = td->graph[B][srcbp[x]];
                 if (!direct && step == 4)
                     dstap[x] = srcap[x];
             }
@@ -836,9 +969,9 @@ static int filter_slice_planar(AVFilterContext *ctx, void *arg, int jobnr, int n
 
         for (y = slice_start; y < slice_end; y++) {
             for (x = 0; x < in->width; x++) {
-                dstr[x] = curves->graph[R][srcr[x]];
-                dstg[x] = curves->graph[G][srcg[x]];
-                dstb[x] = curves->graph[B][srcb[x]];
+                dstr[x] = td->graph[R][srcr[x]];
+                dstg[x] = td->graph[G][srcg[x]];
+                dstb[x] = td->graph[B][srcb[x]];
                 if (!direct && step == 4)
                     dsta[x] = srca[x];
             }
@@ -918,6 +1051,9 @@ static int config_input(AVFilterLink *inlink)
         }
     }
 
+    if (curves->fuse_head || curves->fuse_next)
+        return fuse_update(curves->fuse_head ? curves->fuse_head : ctx);
+
     return 0;
 }
 
@@ -929,6 +1065,10 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     AVFrame *out;
     ThreadData td;
 
+    /* applied by the head of the fused chain */
+    if (fuse_sync(ctx))
+        return ff_filter_frame(outlink, in);
+
     if (av_frame_is_writable(in)) {
         out = in;
     } else {
@@ -940,8 +1080,9 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
         av_frame_copy_props(out, in);
     }
 
-    td.in  = in;
-    td.out = out;
+    td.in    = in;
+    td.out   = out;
+    td.graph = curves->fused_graph[0] ? curves->fused_graph : curves->graph;
     ff_filter_execute(ctx, curves->filter_slice, &td, NULL,
                       FFMIN(outlink->h, ff_filter_get_nb_threads(ctx)));
 
@@ -994,6 +1135,10 @@ static av_cold void curves_uninit(AVFilterContext *ctx)
 
     for (i = 0; i < NB_COMP + 1; i++)
         av_freep(&curves->graph[i]);
+    for (i = 0; i < NB_COMP; i++) {
+        av_freep(&curves->fused_graph[i]);
+        av_freep(&curves->pending_graph[i]);
+    }
 }
 
 static const AVFilterPad curves_inputs[] = {
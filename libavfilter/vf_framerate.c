@@ -71,13 +71,12 @@ static double get_scene_score(AVFilterContext *ctx, AVFrame *crnt, AVFrame *next
 
     if (crnt->height == next->height &&
         crnt->width  == next->width) {
-        uint64_t sad;
+        uint64_t sad, count;
         double mafd, diff;
 
         ff_dlog(ctx, "get_scene_score() process\n");
-        s->sad(crnt->data[0], crnt->linesize[0], next->data[0], next->linesize[0], crnt->width, crnt->height, &sad);
-        emms_c();
-        mafd = (double)sad * 100.0 / (crnt->width * crnt->height) / (1 << s->bitdepth);
+        ff_scene_sad_frames(&s->sad, crnt, next, &sad, &count);
+        mafd = (double)sad * 100.0 / count / (1 << s->bitdepth);
         diff = fabs(mafd - s->prev_mafd);
         ret  = av_clipf(FFMIN(mafd, diff), 0, 100.0);
         s->prev_mafd = mafd;
@@ -215,6 +214,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     FrameRateContext *s = ctx->priv;
     av_frame_free(&s->f0);
     av_frame_free(&s->f1);
+    ff_scene_sad_uninit(&s->sad);
 }
 
 static const enum AVPixelFormat pix_fmts[] = {
@@ -274,7 +274,8 @@ static int config_input(AVFilterLink *inlink)
     AVFilterContext *ctx = inlink->dst;
     FrameRateContext *s = ctx->priv;
     const AVPixFmtDescriptor *pix_desc = av_pix_fmt_desc_get(inlink->format);
-    int plane;
+    const ptrdiff_t width = inlink->w, height = inlink->h;
+    int plane, ret;
 
     s->vsub = pix_desc->log2_chroma_h;
     for (plane = 0; plane < 4; plane++) {
@@ -284,9 +285,9 @@ static int config_input(AVFilterLink *inlink)
 
     s->bitdepth = pix_desc->comp[0].depth;
 
-    s->sad = ff_scene_sad_get_fn(s->bitdepth == 8 ? 8 : 16);
-    if (!s->sad)
-        return AVERROR(EINVAL);
+    ret = ff_scene_sad_init(&s->sad, ctx, pix_desc, 1, &width, &height, 0);
+    if (ret < 0)
+        return ret;
 
     s->srce_time_base = inlink->time_base;
 
@@ -63,6 +63,17 @@ enum var_name {
 typedef struct LutContext {
     const AVClass *class;
     uint16_t lut[4][256 * 256];  ///< lookup table for each component
+    uint16_t (*fused_lut)[256 * 256]; ///< tables composed with the fused filters, if any
+    AVFilterContext *fuse_head;  ///< filter applying this filter's tables, if fused
+    AVFilterContext *fuse_next;  ///< next filter of the fused chain
+
+    /* Fusion state shared between the filters of a chain, which may run on
+     * different threads; protected by the graph lock. The head only switches
+     * to the tables in pending_lut at the start of a frame. */
+    uint16_t (*pending_lut)[256 * 256]; ///< next fused tables of the head
+    int fuse_pending;            ///< head: pending_lut (possibly NULL) must be switched to
+    int64_t nb_fused;            ///< head: number of output frames made with fused tables
+    int64_t fused_frames;        ///< number of input frames already processed by a former head
     char   *comp_expr_str[4];
     AVExpr *comp_expr[4];
     int hsub, vsub;
@@ -104,6 +115,9 @@ static av_cold void uninit(AVFilterContext *ctx)
     LutContext *s = ctx->priv;
     int i;
 
+    av_freep(&s->fused_lut);
+    av_freep(&s->pending_lut);
+
     for (i = 0; i < 4; i++) {
         av_expr_free(s->comp_expr[i]);
         s->comp_expr[i] = NULL;
@@ -209,6 +223,113 @@ static const char * const funcs1_names[] = {
     NULL
 };
 
+/**
+ * Compose the tables of a fused chain for its head, which will switch to them
+ * at its next frame.
+ */
+static int fuse_update(AVFilterContext *head)
+{
+    LutContext *s = head->priv;
+    uint16_t (*lut)[256 * 256];
+    AVFilterContext *next;
+    int comp, val;
+
+    lut = av_malloc(sizeof(s->lut));
+    if (!lut)
+        return AVERROR(ENOMEM);
+
+    ff_graph_lock(head->graph);
+    memcpy(lut, s->lut, sizeof(s->lut));
+    for (next = s->fuse_next; next; next = ((LutContext *)next->priv)->fuse_next) {
+        const LutContext *n = next->priv;
+
+        for (comp = 0; comp < 4; comp++)
+            for (val = 0; val < FF_ARRAY_ELEMS(s->lut[comp]); val++)
+                lut[comp][val] = n->lut[comp][lut[comp][val]];
+    }
+    av_free(s->pending_lut);
+    s->pending_lut  = lut;
+    s->fuse_pending = 1;
+    ff_graph_unlock(head->graph);
+    return 0;
+}
+
+/**
+ * Split a fused chain. The head goes back to its own tables at its next
+ * frame, and the other filters keep passing through the frames that it has
+ * already processed with the fused ones.
+ */
+static void fuse_reset(AVFilterContext *ctx)
+{
+    LutContext *s = ctx->priv;
+    AVFilterContext *head = s->fuse_head ? s->fuse_head : ctx;
+    LutContext *h = head->priv;
+    AVFilterContext *next;
+
+    ff_graph_lock(ctx->graph);
+    next = h->fuse_next;
+    while (next) {
+        LutContext *n = next->priv;
+        next = n->fuse_next;
+        n->fuse_head    = n->fuse_next = NULL;
+        n->fused_frames = h->nb_fused;
+    }
+    h->fuse_next = NULL;
+    av_freep(&h->pending_lut);
+    h->fuse_pending = 1;
+    ff_graph_unlock(ctx->graph);
+}
+
+static int fuse(AVFilterContext *ctx, AVFilterContext *next)
+{
+    LutContext *s = ctx->priv;
+    AVFilterContext *head = s->fuse_head ? s->fuse_head : ctx;
+    LutContext *n;
+    int ret;
+
+    if (!next) {
+        /* timeline change: every filter of the chain works on its own again */
+        if (s->fuse_head || s->fuse_next)
+            fuse_reset(ctx);
+        return 0;
+    }
+
+    n = next->priv;
+    s->fuse_next = next;
+    n->fuse_head = head;
+    ret = fuse_update(head);
+    if (ret < 0)
+        return ret;
+
+    av_log(next, AV_LOG_VERBOSE, "fused into '%s'\n", head->name);
+    return 1;
+}
+
+/**
+ * Called at the start of every frame. Switch the head of a fused chain to
+ * its latest tables.
+ *
+ * @return 1 if the frame was already processed by the head of a fused chain
+ */
+static int fuse_sync(AVFilterContext *ctx)
+{
+    LutContext *s = ctx->priv;
+    int skip;
+
+    ff_graph_lock(ctx->graph);
+    if (s->fuse_pending) {
+        av_free(s->fused_lut);
+        s->fused_lut    = s->pending_lut;
+        s->pending_lut  = NULL;
+        s->fuse_pending = 0;
+    }
+    if (s->fused_lut)
+        s->nb_fused = ctx->outputs[0]->frame_count_in + 1;
+    skip = s->fuse_head || ctx->inputs[0]->frame_count_out < s->fused_frames;
+    ff_graph_unlock(ctx->graph);
+    return skip;
+}
+
 static int config_props(AVFilterLink *inlink)
 {
     AVFilterContext *ctx = inlink->dst;
@@ -332,6 +453,9 @@ static int config_props(AVFilterLink *inlink)
         }
     }
 
+    if (s->fuse_head || s->fuse_next)
+        return fuse_update(s->fuse_head ? s->fuse_head : ctx);
+
     return 0;
 }
 
@@ -343,6 +467,8 @@ struct thread_data {
     int h;
 };
 
+#define LUT_TABLES(s) ((s)->fused_lut ? (s)->fused_lut : (s)->lut)
+
 #define LOAD_PACKED_COMMON\
     LutContext *s = ctx->priv;\
     const struct thread_data *td = arg;\
@@ -352,7 +478,7 @@ struct thread_data {
     const int h = td->h;\
     AVFrame *in = td->in;\
     AVFrame *out = td->out;\
-    const uint16_t (*tab)[256*256] = (const uint16_t (*)[256*256])s->lut;\
+    const uint16_t (*tab)[256*256] = (const uint16_t (*)[256*256])LUT_TABLES(s);\
     const int step = s->step;\
 \
     const int slice_start = (h *  jobnr   ) / nb_jobs;\
@@ -436,7 +562,7 @@ static int lut_packed_8bits(AVFilterContext *ctx, void *arg, int jobnr, int nb_j
         int hsub = plane == 1 || plane == 2 ? s->hsub : 0;\
         int h = AV_CEIL_RSHIFT(td->h, vsub);\
         int w = AV_CEIL_RSHIFT(td->w, hsub);\
-        const uint16_t *tab = s->lut[plane];\
+        const uint16_t *tab = LUT_TABLES(s)[plane];\
 \
         const int slice_start = (h *  jobnr   ) / nb_jobs;\
         const int slice_end   = (h * (jobnr+1)) / nb_jobs;\
@@ -524,6 +650,10 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     AVFrame *out;
     int direct = 0;
 
+    /* applied by the head of the fused chain */
+    if (fuse_sync(ctx))
+        return ff_filter_frame(outlink, in);
+
     if (av_frame_is_writable(in)) {
         direct = 1;
         out = in;
@@ -575,6 +705,13 @@ static int process_command(AVFilterContext *ctx, const char *cmd, const char *ar
     return config_props(ctx->inputs[0]);
 }
 
+static av_cold int init(AVFilterContext *ctx)
+{
+    ctx->internal->fuse = fuse;
+
+    return 0;
+}
+
 static const AVFilterPad inputs[] = {
     { .name         = "default",
       .type         = AVMEDIA_TYPE_VIDEO,
@@ -608,7 +745,7 @@ AVFILTER_DEFINE_CLASS_EXT(lut, "lut/lutyuv/lutrgb", options);
 
 #if CONFIG_LUT_FILTER
 
-#define lut_init NULL
+#define lut_init init
 DEFINE_LUT_FILTER(lut, "Compute and apply a lookup table to the RGB/YUV input video.",
                   lut);
 #undef lut_init
@@ -622,7 +759,7 @@ static av_cold int lutyuv_init(AVFilterContext *ctx)
 
     s->is_yuv = 1;
 
-    return 0;
+    return init(ctx);
 }
 
 DEFINE_LUT_FILTER(lutyuv, "Compute and apply a lookup table to the YUV input video.",
@@ -637,7 +774,7 @@ static av_cold int lutrgb_init(AVFilterContext *ctx)
 
     s->is_rgb = 1;
 
-    return 0;
+    return init(ctx);
 }
 
 DEFINE_LUT_FILTER(lutrgb, "Compute and apply a lookup table to the RGB input video.",
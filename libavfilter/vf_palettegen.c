@@ -74,6 +74,9 @@ typedef struct PaletteGenContext {
 
     AVFrame *prev_frame;                    // previous frame used for the diff stats_mode
     struct hist_node histogram[HIST_SIZE];  // histogram/hashtable of the colors
+    struct hist_node *slice_hist;           // per-thread histograms of the current frame
+    int nb_slice_hist;                      // number of per-thread histograms
+    int *job_ret;                           // return values of the histogram jobs
     struct color_ref **refs;                // references of all the colors used in the stream
     int nb_refs;                            // number of color references (or number of different colors)
     struct range_box boxes[256];            // define the segmentation of the colorspace (the final palette)
@@ -413,15 +416,40 @@ static int color_inc(struct hist_node *hist, uint32_t color)
     return 1;
 }
 
+/**
+ * Add the count of a color reference to the hash table.
+ */
+static int color_add(struct hist_node *hist, const struct color_ref *ref)
+{
+    const uint32_t hash = ff_lowbias32(ref->color) & (HIST_SIZE - 1);
+    struct hist_node *node = &hist[hash];
+    struct color_ref *e;
+
+    for (int i = 0; i < node->nb_entries; i++) {
+        e = &node->entries[i];
+        if (e->color == ref->color) {
+            e->count += ref->count;
+            return 0;
+        }
+    }
+
+    e = av_dynarray2_add((void**)&node->entries, &node->nb_entries,
+                         sizeof(*node->entries), (const uint8_t *)ref);
+    if (!e)
+        return AVERROR(ENOMEM);
+    return 1;
+}
+
 /**
  * Update histogram when pixels differ from previous frame.
  */
 static int update_histogram_diff(struct hist_node *hist,
-                                 const AVFrame *f1, const AVFrame *f2)
+                                 const AVFrame *f1, const AVFrame *f2,
+                                 int y_start, int y_end)
 {
     int x, y, ret, nb_diff_colors = 0;
 
-    for (y = 0; y < f1->height; y++) {
+    for (y = y_start; y < y_end; y++) {
         const uint32_t *p = (const uint32_t *)(f1->data[0] + y*f1->linesize[0]);
         const uint32_t *q = (const uint32_t *)(f2->data[0] + y*f2->linesize[0]);
 
@@ -440,11 +468,12 @@ static int update_histogram_diff(struct hist_node *hist,
 /**
  * Simple histogram of the frame.
  */
-static int update_histogram_frame(struct hist_node *hist, const AVFrame *f)
+static int update_histogram_frame(struct hist_node *hist, const AVFrame *f,
+                                  int y_start, int y_end)
 {
     int x, y, ret, nb_diff_colors = 0;
 
-    for (y = 0; y < f->height; y++) {
+    for (y = y_start; y < y_end; y++) {
         const uint32_t *p = (const uint32_t *)(f->data[0] + y*f->linesize[0]);
 
         for (x = 0; x < f->width; x++) {
@@ -457,6 +486,53 @@ static int update_histogram_frame(struct hist_node *hist, const AVFrame *f)
     return nb_diff_colors;
 }
 
+static int update_histogram_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PaletteGenContext *s = ctx->priv;
+    const AVFrame *in = arg;
+    struct hist_node *hist = s->slice_hist + jobnr * HIST_SIZE;
+    const int slice_start = (in->height *  jobnr     ) / nb_jobs;
+    const int slice_end   = (in->height * (jobnr + 1)) / nb_jobs;
+
+    return s->prev_frame ? update_histogram_diff(hist, s->prev_frame, in, slice_start, slice_end)
+                         : update_histogram_frame(hist, in, slice_start, slice_end);
+}
+
+/**
+ * Build a histogram of the frame per thread and merge them into the main
+ * one. The slice histograms are merged in order, which keeps the colors in
+ * the same order as if the frame had been scanned at once.
+ */
+static int update_histogram_threaded(AVFilterContext *ctx, AVFrame *in)
+{
+    PaletteGenContext *s = ctx->priv;
+    const int nb_jobs = FFMIN3(ff_filter_get_nb_threads(ctx), s->nb_slice_hist, in->height);
+    int ret = 0, nb_diff_colors = 0;
+
+    if (nb_jobs <= 1)
+        return s->prev_frame ? update_histogram_diff(s->histogram, s->prev_frame, in, 0, in->height)
+                             : update_histogram_frame(s->histogram, in, 0, in->height);
+
+    ff_filter_execute(ctx, update_histogram_slice, in, s->job_ret, nb_jobs);
+
+    for (int i = 0; i < nb_jobs; i++) {
+        struct hist_node *hist = s->slice_hist + i * HIST_SIZE;
+
+        if (s->job_ret[i] < 0)
+            ret = s->job_ret[i];
+        for (int j = 0; j < HIST_SIZE; j++) {
+            for (int k = 0; k < hist[j].nb_entries && ret >= 0; k++) {
+                ret = color_add(s->histogram, &hist[j].entries[k]);
+                nb_diff_colors += ret > 0;
+            }
+            av_freep(&hist[j].entries);
+            hist[j].nb_entries = 0;
+        }
+    }
+
+    return ret < 0 ? ret : nb_diff_colors;
+}
+
 /**
  * Update the histogram for each passing frame. No frame will be pushed here.
  */
@@ -469,8 +545,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     if (in->color_trc != AVCOL_TRC_UNSPECIFIED && in->color_trc != AVCOL_TRC_IEC61966_2_1)
         av_log(ctx, AV_LOG_WARNING, "The input frame is not in sRGB, colors may be off\n");
 
-    ret = s->prev_frame ? update_histogram_diff(s->histogram, s->prev_frame, in)
-                        : update_histogram_frame(s->histogram, in);
+    ret = update_histogram_threaded(ctx, in);
     if (ret > 0)
         s->nb_refs += ret;
 
@@ -518,6 +593,24 @@ static int request_frame(AVFilterLink *outlink)
     return r;
 }
 
+static int config_input(AVFilterLink *inlink)
+{
+    AVFilterContext *ctx = inlink->dst;
+    PaletteGenContext *s = ctx->priv;
+    const int nb_threads = ff_filter_get_nb_threads(ctx);
+
+    if (nb_threads <= 1 || s->slice_hist)
+        return 0;
+
+    s->slice_hist = av_calloc(nb_threads, HIST_SIZE * sizeof(*s->slice_hist));
+    s->job_ret    = av_calloc(nb_threads, sizeof(*s->job_ret));
+    if (!s->slice_hist || !s->job_ret)
+        return AVERROR(ENOMEM);
+    s->nb_slice_hist = nb_threads;
+
+    return 0;
+}
+
 /**
  * The output is one simple 16x16 squared-pixels palette.
  */
@@ -547,6 +640,10 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     for (i = 0; i < HIST_SIZE; i++)
         av_freep(&s->histogram[i].entries);
+    for (i = 0; i < s->nb_slice_hist * HIST_SIZE; i++)
+        av_freep(&s->slice_hist[i].entries);
+    av_freep(&s->slice_hist);
+    av_freep(&s->job_ret);
     av_freep(&s->refs);
     av_frame_free(&s->prev_frame);
 }
@@ -555,6 +652,7 @@ static const AVFilterPad palettegen_inputs[] = {
     {
         .name         = "default",
         .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = config_input,
         .filter_frame = filter_frame,
     },
 };
@@ -578,4 +676,5 @@ const AVFilter ff_vf_palettegen = {
     FILTER_OUTPUTS(palettegen_outputs),
     FILTER_QUERY_FUNC(query_formats),
     .priv_class    = &palettegen_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
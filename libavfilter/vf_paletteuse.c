@@ -78,15 +78,36 @@ struct cache_node {
     int nb_entries;
 };
 
+/**
+ * Part of the processing window handled by one set_frame() call: lines y0
+ * to y1 (excluded) and on each of them the w pixels starting at x0, moved
+ * left by skew pixels for every line below the top of the window.
+ */
+struct slice_rect {
+    int x0, y0, y1, w, skew;
+};
+
+/* Error diffusion is run in parallel on tiles of TILE_H lines skewed by
+ * TILE_SKEW pixels per line, so that a tile only depends on the tiles above
+ * it and on its left: the error of a pixel reaches 2 pixels to the left and
+ * right on the next 2 lines. */
+#define TILE_W    128
+#define TILE_H     16
+#define TILE_SKEW   5
+
 struct PaletteUseContext;
 
-typedef int (*set_frame_func)(struct PaletteUseContext *s, AVFrame *out, AVFrame *in,
-                              int x_start, int y_start, int width, int height);
+typedef int (*set_frame_func)(struct PaletteUseContext *s, struct cache_node *cache,
+                              AVFrame *out, AVFrame *in,
+                              int x_start, int y_start, int width, int height,
+                              const struct slice_rect *sl);
 
 typedef struct PaletteUseContext {
     const AVClass *class;
     FFFrameSync fs;
-    struct cache_node cache[CACHE_SIZE];    /* lookup cache */
+    struct cache_node *cache;               /* lookup cache, CACHE_SIZE nodes per thread */
+    int nb_caches;
+    int *job_ret;
     struct color_node map[AVPALETTE_COUNT]; /* 3D-Tree (KD-Tree with K=3) for reverse colormap */
     uint32_t palette[AVPALETTE_COUNT];
     int transparency_index; /* index in the palette of transparency. -1 if there is no transparency in the palette. */
@@ -235,11 +256,12 @@ struct stack_node {
  * Check if the requested color is in the cache already. If not, find it in the
  * color tree and cache it.
  */
-static av_always_inline int color_get(PaletteUseContext *s, uint32_t color)
+static av_always_inline int color_get(PaletteUseContext *s, struct cache_node *cache,
+                                      uint32_t color)
 {
     struct color_info clrinfo;
     const uint32_t hash = ff_lowbias32(color) & (CACHE_SIZE - 1);
-    struct cache_node *node = &s->cache[hash];
+    struct cache_node *node = &cache[hash];
     struct cached_color *e;
 
     // first, check for transparency
@@ -264,11 +286,11 @@ static av_always_inline int color_get(PaletteUseContext *s, uint32_t color)
     return e->pal_entry;
 }
 
-static av_always_inline int get_dst_color_err(PaletteUseContext *s,
+static av_always_inline int get_dst_color_err(PaletteUseContext *s, struct cache_node *cache,
                                               uint32_t c, int *er, int *eg, int *eb)
 {
     uint32_t dstc;
-    const int dstx = color_get(s, c);
+    const int dstx = color_get(s, cache, c);
     if (dstx < 0)
         return dstx;
     dstc = s->palette[dstx];
@@ -285,20 +307,25 @@ static av_always_inline int get_dst_color_err(PaletteUseContext *s,
     return dstx;
 }
 
-static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFrame *in,
+static av_always_inline int set_frame(PaletteUseContext *s, struct cache_node *cache,
+                                      AVFrame *out, AVFrame *in,
                                       int x_start, int y_start, int w, int h,
+                                      const struct slice_rect *sl,
                                       enum dithering_mode dither)
 {
     const int src_linesize = in ->linesize[0] >> 2;
     const int dst_linesize = out->linesize[0];
-    uint32_t *src = ((uint32_t *)in ->data[0]) + y_start*src_linesize;
-    uint8_t  *dst =              out->data[0]  + y_start*dst_linesize;
+    uint32_t *src = ((uint32_t *)in ->data[0]) + sl->y0*src_linesize;
+    uint8_t  *dst =              out->data[0]  + sl->y0*dst_linesize;
 
     w += x_start;
     h += y_start;
 
-    for (int y = y_start; y < h; y++) {
-        for (int x = x_start; x < w; x++) {
+    for (int y = sl->y0; y < sl->y1; y++) {
+        const int x0 = sl->x0 - (y - y_start) * sl->skew;
+        const int x1 = FFMIN(x0 + sl->w, w);
+
+        for (int x = FFMAX(x0, x_start); x < x1; x++) {
             int er, eg, eb;
 
             if (dither == DITHERING_BAYER) {
@@ -311,7 +338,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
                 const uint8_t g = av_clip_uint8(g8 + d);
                 const uint8_t b = av_clip_uint8(b8 + d);
                 const uint32_t color_new = (unsigned)(a8) << 24 | r << 16 | g << 8 | b;
-                const int color = color_get(s, color_new);
+                const int color = color_get(s, cache, color_new);
 
                 if (color < 0)
                     return color;
@@ -319,7 +346,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_HECKBERT) {
                 const int right = x < w - 1, down = y < h - 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
 
                 if (color < 0)
                     return color;
@@ -331,7 +358,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_FLOYD_STEINBERG) {
                 const int right = x < w - 1, down = y < h - 1, left = x > x_start;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
 
                 if (color < 0)
                     return color;
@@ -345,7 +372,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
             } else if (dither == DITHERING_SIERRA2) {
                 const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
                 const int right2 = x < w - 2,                    left2 = x > x_start + 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
 
                 if (color < 0)
                     return color;
@@ -364,7 +391,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_SIERRA2_4A) {
                 const int right = x < w - 1, down = y < h - 1, left = x > x_start;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
 
                 if (color < 0)
                     return color;
@@ -377,7 +404,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
             } else if (dither == DITHERING_SIERRA3) {
                 const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
                 const int right2 = x < w - 2, down2 = y < h - 2, left2 = x > x_start + 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
 
                 if (color < 0)
                     return color;
@@ -403,7 +430,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
             } else if (dither == DITHERING_BURKES) {
                 const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
                 const int right2 = x < w - 2,                    left2 = x > x_start + 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
 
                 if (color < 0)
                     return color;
@@ -423,7 +450,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
             } else if (dither == DITHERING_ATKINSON) {
                 const int right  = x < w - 1, down  = y < h - 1, left = x > x_start;
                 const int right2 = x < w - 2, down2 = y < h - 2;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
 
                 if (color < 0)
                     return color;
@@ -440,7 +467,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
                 }
 
             } else {
-                const int color = color_get(s, src[x]);
+                const int color = color_get(s, cache, src[x]);
 
                 if (color < 0)
                     return color;
@@ -763,6 +790,83 @@ static void set_processing_window(enum diff_mode diff_mode,
     *hp = height;
 }
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+    int x, y, w, h;                 ///< processing window
+    int nb_tiles_x, nb_tiles_y;     ///< number of error diffusion tiles
+    int wave;                       ///< anti-diagonal of tiles being processed
+} ThreadData;
+
+static int set_frame_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PaletteUseContext *s = ctx->priv;
+    const ThreadData *td = arg;
+    struct cache_node *cache = s->cache + jobnr * CACHE_SIZE;
+    struct slice_rect sl = { .x0 = td->x, .w = td->w };
+    int ret;
+
+    if (s->dither == DITHERING_NONE || s->dither == DITHERING_BAYER) {
+        sl.y0 = td->y + (td->h *  jobnr     ) / nb_jobs;
+        sl.y1 = td->y + (td->h * (jobnr + 1)) / nb_jobs;
+        return s->set_frame(s, cache, td->out, td->in, td->x, td->y, td->w, td->h, &sl);
+    }
+
+    /* All the tiles of the current anti-diagonal are independent of each
+     * other; the ones before it have been processed by previous calls. */
+    sl.w    = TILE_W;
+    sl.skew = TILE_SKEW;
+    for (int ty = FFMAX(0, td->wave - td->nb_tiles_x + 1) + jobnr;
+         ty < FFMIN(td->nb_tiles_y, td->wave + 1); ty += nb_jobs) {
+        const int tx = td->wave - ty;
+
+        sl.x0 = td->x + tx * TILE_W;
+        sl.y0 = td->y + ty * TILE_H;
+        sl.y1 = FFMIN(sl.y0 + TILE_H, td->y + td->h);
+        ret = s->set_frame(s, cache, td->out, td->in, td->x, td->y, td->w, td->h, &sl);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+
+static int set_frame_threaded(AVFilterContext *ctx, AVFrame *out, AVFrame *in,
+                              int x, int y, int w, int h)
+{
+    PaletteUseContext *s = ctx->priv;
+    ThreadData td = { .in = in, .out = out, .x = x, .y = y, .w = w, .h = h };
+    const int nb_threads = FFMIN(ff_filter_get_nb_threads(ctx), s->nb_caches);
+    int *job_ret = s->job_ret;
+
+    if (nb_threads <= 1) {
+        const struct slice_rect sl = { .x0 = x, .y0 = y, .y1 = y + h, .w = w };
+        return s->set_frame(s, s->cache, out, in, x, y, w, h, &sl);
+    }
+
+    if (s->dither == DITHERING_NONE || s->dither == DITHERING_BAYER) {
+        const int nb_jobs = FFMIN(h, nb_threads);
+
+        ff_filter_execute(ctx, set_frame_slice, &td, job_ret, nb_jobs);
+        for (int i = 0; i < nb_jobs; i++)
+            if (job_ret[i] < 0)
+                return job_ret[i];
+        return 0;
+    }
+
+    td.nb_tiles_x = (w + (h - 1) * TILE_SKEW + TILE_W - 1) / TILE_W;
+    td.nb_tiles_y = (h + TILE_H - 1) / TILE_H;
+    for (td.wave = 0; td.wave < td.nb_tiles_x + td.nb_tiles_y - 1; td.wave++) {
+        const int nb_tiles = FFMIN(td.nb_tiles_y, td.wave + 1) -
+                             FFMAX(0, td.wave - td.nb_tiles_x + 1);
+        const int nb_jobs  = FFMIN(nb_tiles, nb_threads);
+
+        ff_filter_execute(ctx, set_frame_slice, &td, job_ret, nb_jobs);
+        for (int i = 0; i < nb_jobs; i++)
+            if (job_ret[i] < 0)
+                return job_ret[i];
+    }
+    return 0;
+}
+
 static int apply_palette(AVFilterLink *inlink, AVFrame *in, AVFrame **outf)
 {
     int x, y, w, h, ret;
@@ -792,7 +896,7 @@ static int apply_palette(AVFilterLink *inlink, AVFrame *in, AVFrame **outf)
     ff_dlog(ctx, "%dx%d rect: (%d;%d) -> (%d,%d) [area:%dx%d]\n",
             w, h, x, y, x+w, y+h, in->width, in->height);
 
-    ret = s->set_frame(s, out, in, x, y, w, h);
+    ret = set_frame_threaded(ctx, out, in, x, y, w, h);
     if (ret < 0) {
         av_frame_free(&out);
         *outf = NULL;
@@ -803,6 +907,14 @@ static int apply_palette(AVFilterLink *inlink, AVFrame *in, AVFrame **outf)
     return 0;
 }
 
+static void free_caches(PaletteUseContext *s)
+{
+    if (!s->cache)
+        return;
+    for (int i = 0; i < s->nb_caches * CACHE_SIZE; i++)
+        av_freep(&s->cache[i].entries);
+}
+
 static int config_output(AVFilterLink *outlink)
 {
     int ret;
@@ -816,6 +928,17 @@ static int config_output(AVFilterLink *outlink)
     s->fs.in[1].before = s->fs.in[1].after = EXT_INFINITY;
     s->fs.on_event = load_apply_palette;
 
+    /* each thread keeps its own color cache */
+    s->nb_caches = ff_filter_get_nb_threads(ctx);
+    av_freep(&s->job_ret);
+    s->job_ret = av_calloc(s->nb_caches, sizeof(*s->job_ret));
+    if (!s->job_ret)
+        return AVERROR(ENOMEM);
+    free_caches(s);
+    s->cache = av_calloc(s->nb_caches, CACHE_SIZE * sizeof(*s->cache));
+    if (!s->cache)
+        return AVERROR(ENOMEM);
+
     outlink->w = ctx->inputs[0]->w;
     outlink->h = ctx->inputs[0]->h;
 
@@ -851,9 +974,8 @@ static void load_palette(PaletteUseContext *s, const AVFrame *palette_frame)
     if (s->new) {
         memset(s->palette, 0, sizeof(s->palette));
         memset(s->map, 0, sizeof(s->map));
-        for (i = 0; i < CACHE_SIZE; i++)
-            av_freep(&s->cache[i].entries);
-        memset(s->cache, 0, sizeof(s->cache));
+        free_caches(s);
+        memset(s->cache, 0, s->nb_caches * CACHE_SIZE * sizeof(*s->cache));
     }
 
     i = 0;
@@ -901,10 +1023,12 @@ static int load_apply_palette(FFFrameSync *fs)
 }
 
 #define DEFINE_SET_FRAME(name, value)                                           \
-static int set_frame_##name(PaletteUseContext *s, AVFrame *out, AVFrame *in,    \
-                            int x_start, int y_start, int w, int h)             \
+static int set_frame_##name(PaletteUseContext *s, struct cache_node *cache,     \
+                            AVFrame *out, AVFrame *in,                          \
+                            int x_start, int y_start, int w, int h,             \
+                            const struct slice_rect *sl)                        \
 {                                                                               \
-    return set_frame(s, out, in, x_start, y_start, w, h, value);                \
+    return set_frame(s, cache, out, in, x_start, y_start, w, h, sl, value);     \
 }
 
 DEFINE_SET_FRAME(none,            DITHERING_NONE)
@@ -969,8 +1093,9 @@ static av_cold void uninit(AVFilterContext *ctx)
     PaletteUseContext *s = ctx->priv;
 
     ff_framesync_uninit(&s->fs);
-    for (int i = 0; i < CACHE_SIZE; i++)
-        av_freep(&s->cache[i].entries);
+    free_caches(s);
+    av_freep(&s->cache);
+    av_freep(&s->job_ret);
     av_frame_free(&s->last_in);
     av_frame_free(&s->last_out);
 }
@@ -1005,4 +1130,5 @@ const AVFilter ff_vf_paletteuse = {
     FILTER_OUTPUTS(paletteuse_outputs),
     FILTER_QUERY_FUNC(query_formats),
     .priv_class    = &paletteuse_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -108,10 +108,35 @@ enum EvalMode {
     EVAL_MODE_NB
 };
 
+/**
+ * Frame dependent parameters the scaler contexts are initialized with,
+ * the remaining ones are fixed for the lifetime of the filter.
+ */
+typedef struct ScaleConfig {
+    int in_w, in_h, in_format;
+    int out_w, out_h, out_format;
+    int in_frame_range;
+} ScaleConfig;
+
+typedef struct ScaleCacheEntry {
+    ScaleConfig cfg;
+    struct SwsContext *sws;
+    struct SwsContext *isws[2];
+} ScaleCacheEntry;
+
 typedef struct ScaleContext {
     const AVClass *class;
     struct SwsContext *sws;     ///< software scaler context
     struct SwsContext *isws[2]; ///< software scaler context for interlaced material
+    ScaleConfig sws_cfg;        ///< configuration of sws and isws
+    /**
+     * Scaler contexts of previous configurations, least recently used
+     * first, so that switching back to one of them does not need a new
+     * initialization.
+     */
+    ScaleCacheEntry *cache;
+    int nb_cache;
+    int cache_size;
     // context used for forwarding options to sws
     struct SwsContext *sws_opts;
 
@@ -372,6 +397,13 @@ static av_cold void uninit(AVFilterContext *ctx)
     sws_freeContext(scale->isws[0]);
     sws_freeContext(scale->isws[1]);
     scale->sws = NULL;
+    for (int i = 0; i < scale->nb_cache; i++) {
+        sws_freeContext(scale->cache[i].sws);
+        sws_freeContext(scale->cache[i].isws[0]);
+        sws_freeContext(scale->cache[i].isws[1]);
+    }
+    av_freep(&scale->cache);
+    scale->nb_cache = 0;
 }
 
 static int query_formats(AVFilterContext *ctx)
@@ -434,6 +466,66 @@ static const int *parse_yuv_type(const char *s, enum AVColorSpace colorspace)
     return sws_getCoefficients(colorspace);
 }
 
+/**
+ * Move the current scaler contexts to the cache, evicting the least
+ * recently used entry if it is full.
+ */
+static void cache_store(ScaleContext *scale)
+{
+    ScaleCacheEntry *entry;
+
+    if (!scale->sws)
+        return;
+
+    if (scale->cache_size && !scale->cache) {
+        scale->cache = av_calloc(scale->cache_size, sizeof(*scale->cache));
+        if (!scale->cache)
+            scale->cache_size = 0;
+    }
+
+    if (!scale->cache_size) {
+        sws_freeContext(scale->sws);
+        sws_freeContext(scale->isws[0]);
+        sws_freeContext(scale->isws[1]);
+    } else {
+        if (scale->nb_cache == scale->cache_size) {
+            sws_freeContext(scale->cache[0].sws);
+            sws_freeContext(scale->cache[0].isws[0]);
+            sws_freeContext(scale->cache[0].isws[1]);
+            memmove(scale->cache, scale->cache + 1,
+                    --scale->nb_cache * sizeof(*scale->cache));
+        }
+        entry = &scale->cache[scale->nb_cache++];
+        entry->cfg     = scale->sws_cfg;
+        entry->sws     = scale->sws;
+        entry->isws[0] = scale->isws[0];
+        entry->isws[1] = scale->isws[1];
+    }
+    scale->isws[0] = scale->isws[1] = scale->sws = NULL;
+}
+
+/**
+ * Take the scaler contexts for cfg out of the cache.
+ *
+ * @return 1 if they were found, 0 otherwise
+ */
+static int cache_lookup(ScaleContext *scale, const ScaleConfig *cfg)
+{
+    for (int i = scale->nb_cache - 1; i >= 0; i--) {
+        ScaleCacheEntry *entry = &scale->cache[i];
+
+        if (memcmp(&entry->cfg, cfg, sizeof(*cfg)))
+            continue;
+
+        scale->sws     = entry->sws;
+        scale->isws[0] = entry->isws[0];
+        scale->isws[1] = entry->isws[1];
+        memmove(entry, entry + 1, (--scale->nb_cache - i) * sizeof(*entry));
+        return 1;
+    }
+    return 0;
+}
+
 static int scale_eval_dimensions(AVFilterContext *ctx)
 {
     ScaleContext *scale = ctx->priv;
@@ -519,6 +611,7 @@ static int config_props(AVFilterLink *outlink)
     enum AVPixelFormat outfmt = outlink->format;
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
     ScaleContext *scale = ctx->priv;
+    ScaleConfig cfg;
     uint8_t *flags_val = NULL;
     int ret;
 
@@ -544,33 +637,39 @@ static int config_props(AVFilterLink *outlink)
     if (outfmt == AV_PIX_FMT_PAL8) outfmt = AV_PIX_FMT_BGR8;
     scale->output_is_pal = av_pix_fmt_desc_get(outfmt)->flags & AV_PIX_FMT_FLAG_PAL;
 
-    if (scale->sws)
-        sws_freeContext(scale->sws);
-    if (scale->isws[0])
-        sws_freeContext(scale->isws[0]);
-    if (scale->isws[1])
-        sws_freeContext(scale->isws[1]);
-    scale->isws[0] = scale->isws[1] = scale->sws = NULL;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.in_w           = inlink0->w;
+    cfg.in_h           = inlink0->h;
+    cfg.in_format      = inlink0->format;
+    cfg.out_w          = outlink->w;
+    cfg.out_h          = outlink->h;
+    cfg.out_format     = outfmt;
+    cfg.in_frame_range = scale->in_frame_range;
+
+    cache_store(scale);
+    scale->sws_cfg = cfg;
     if (inlink0->w == outlink->w &&
         inlink0->h == outlink->h &&
         !scale->out_color_matrix &&
         scale->in_range == scale->out_range &&
         inlink0->format == outlink->format)
         ;
-    else {
+    else if (!cache_lookup(scale, &cfg)) {
         struct SwsContext **swscs[3] = {&scale->sws, &scale->isws[0], &scale->isws[1]};
         int i;
 
         for (i = 0; i < 3; i++) {
             int in_v_chr_pos = scale->in_v_chr_pos, out_v_chr_pos = scale->out_v_chr_pos;
             struct SwsContext *const s = sws_alloc_context();
-            if (!s)
-                return AVERROR(ENOMEM);
+            if (!s) {
+                ret = AVERROR(ENOMEM);
+                goto fail_free;
+            }
             *swscs[i] = s;
 
             ret = av_opt_copy(s, scale->sws_opts);
             if (ret < 0)
-                return ret;
+                goto fail_free;
 
             av_opt_set_int(s, "srcw", inlink0 ->w, 0);
             av_opt_set_int(s, "srch", inlink0 ->h >> !!i, 0);
@@ -605,7 +704,7 @@ static int config_props(AVFilterLink *outlink)
             av_opt_set_int(s, "dst_v_chr_pos", out_v_chr_pos, 0);
 
             if ((ret = sws_init_context(s, NULL, NULL)) < 0)
-                return ret;
+                goto fail_free;
             if (!scale->interlaced)
                 break;
         }
@@ -629,6 +728,12 @@ static int config_props(AVFilterLink *outlink)
 
     return 0;
 
+fail_free:
+    /* do not leave a partially initialized configuration for the cache */
+    sws_freeContext(scale->sws);
+    sws_freeContext(scale->isws[0]);
+    sws_freeContext(scale->isws[1]);
+    scale->isws[0] = scale->isws[1] = scale->sws = NULL;
 fail:
     return ret;
 }
@@ -1034,6 +1139,7 @@ static const AVOption scale_options[] = {
     { "eval", "specify when to evaluate expressions", OFFSET(eval_mode), AV_OPT_TYPE_INT, {.i64 = EVAL_MODE_INIT}, 0, EVAL_MODE_NB-1, FLAGS, "eval" },
          { "init",  "eval expressions once during initialization", 0, AV_OPT_TYPE_CONST, {.i64=EVAL_MODE_INIT},  .flags = FLAGS, .unit = "eval" },
          { "frame", "eval expressions during initialization and per-frame", 0, AV_OPT_TYPE_CONST, {.i64=EVAL_MODE_FRAME}, .flags = FLAGS, .unit = "eval" },
+    { "cache_size", "set the number of previous scaler configurations kept for reuse", OFFSET(cache_size), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 64, FLAGS },
     { NULL }
 };
 
@@ -28,21 +28,19 @@
 
 #include "avfilter.h"
 #include "filters.h"
+#include "internal.h"
 #include "scene_sad.h"
 
 typedef struct SCDetContext {
     const AVClass *class;
 
-    ptrdiff_t width[4];
-    ptrdiff_t height[4];
-    int nb_planes;
+    FFSceneSADContext sad;
     int bitdepth;
-    ff_scene_sad_fn sad;
     double prev_mafd;
     double scene_score;
-    AVFrame *prev_picref;
     double threshold;
     int sc_pass;
+    int lowres;
 } SCDetContext;
 
 #define OFFSET(x) offsetof(SCDetContext, x)
@@ -54,6 +52,7 @@ static const AVOption scdet_options[] = {
     { "t",           "set scene change detect threshold",        OFFSET(threshold),  AV_OPT_TYPE_DOUBLE,   {.dbl = 10.},     0,  100., V|F },
     { "sc_pass",     "Set the flag to pass scene change frames", OFFSET(sc_pass),    AV_OPT_TYPE_BOOL,     {.dbl =  0  },    0,    1,  V|F },
     { "s",           "Set the flag to pass scene change frames", OFFSET(sc_pass),    AV_OPT_TYPE_BOOL,     {.dbl =  0  },    0,    1,  V|F },
+    { "lowres",      "compare frames downscaled by 2^lowres",    OFFSET(lowres),     AV_OPT_TYPE_INT,      {.i64 =  0  },    0, SCENE_SAD_MAX_LOWRES, V|F },
     {NULL}
 };
 
@@ -80,60 +79,45 @@ static int config_input(AVFilterLink *inlink)
     int is_yuv = !(desc->flags & AV_PIX_FMT_FLAG_RGB) &&
         (desc->flags & AV_PIX_FMT_FLAG_PLANAR) &&
         desc->nb_components >= 3;
+    ptrdiff_t width[4], height[4];
 
     s->bitdepth = desc->comp[0].depth;
-    s->nb_planes = is_yuv ? 1 : av_pix_fmt_count_planes(inlink->format);
 
     for (int plane = 0; plane < 4; plane++) {
         ptrdiff_t line_size = av_image_get_linesize(inlink->format, inlink->w, plane);
-        s->width[plane] = line_size >> (s->bitdepth > 8);
-        s->height[plane] = inlink->h >> ((plane == 1 || plane == 2) ? desc->log2_chroma_h : 0);
+        width[plane]  = line_size >> (s->bitdepth > 8);
+        height[plane] = inlink->h >> ((plane == 1 || plane == 2) ? desc->log2_chroma_h : 0);
     }
 
-    s->sad = ff_scene_sad_get_fn(s->bitdepth == 8 ? 8 : 16);
-    if (!s->sad)
-        return AVERROR(EINVAL);
-
-    return 0;
+    return ff_scene_sad_init(&s->sad, ctx, desc,
+                             is_yuv ? 1 : av_pix_fmt_count_planes(inlink->format),
+                             width, height, s->lowres);
 }
 
 static av_cold void uninit(AVFilterContext *ctx)
 {
     SCDetContext *s = ctx->priv;
 
-    av_frame_free(&s->prev_picref);
+    ff_scene_sad_uninit(&s->sad);
 }
 
-static double get_scene_score(AVFilterContext *ctx, AVFrame *frame)
+static int get_scene_score(AVFilterContext *ctx, AVFrame *frame)
 {
-    double ret = 0;
     SCDetContext *s = ctx->priv;
-    AVFrame *prev_picref = s->prev_picref;
-
-    if (prev_picref && frame->height == prev_picref->height
-                    && frame->width  == prev_picref->width) {
-        uint64_t sad = 0;
-        double mafd, diff;
-        uint64_t count = 0;
-
-        for (int plane = 0; plane < s->nb_planes; plane++) {
-            uint64_t plane_sad;
-            s->sad(prev_picref->data[plane], prev_picref->linesize[plane],
-                    frame->data[plane], frame->linesize[plane],
-                    s->width[plane], s->height[plane], &plane_sad);
-            sad += plane_sad;
-            count += s->width[plane] * s->height[plane];
-        }
+    uint64_t sad, count;
+    double mafd, diff;
+    int ret;
 
-        emms_c();
-        mafd = (double)sad * 100. / count / (1ULL << s->bitdepth);
-        diff = fabs(mafd - s->prev_mafd);
-        ret  = av_clipf(FFMIN(mafd, diff), 0, 100.);
-        s->prev_mafd = mafd;
-        av_frame_free(&prev_picref);
-    }
-    s->prev_picref = av_frame_clone(frame);
-    return ret;
+    s->scene_score = 0;
+    ret = ff_scene_sad_next(&s->sad, frame, &sad, &count);
+    if (ret <= 0)
+        return ret;
+
+    mafd = (double)sad * 100. / count / (1ULL << s->bitdepth);
+    diff = fabs(mafd - s->prev_mafd);
+    s->scene_score = av_clipf(FFMIN(mafd, diff), 0, 100.);
+    s->prev_mafd = mafd;
+    return 0;
 }
 
 static int set_meta(SCDetContext *s, AVFrame *frame, const char *key, const char *value)
@@ -157,7 +141,11 @@ static int activate(AVFilterContext *ctx)
 
     if (frame) {
         char buf[64];
-        s->scene_score = get_scene_score(ctx, frame);
+        ret = get_scene_score(ctx, frame);
+        if (ret < 0) {
+            av_frame_free(&frame);
+            return ret;
+        }
         snprintf(buf, sizeof(buf), "%0.3f", s->prev_mafd);
         set_meta(s, frame, "lavfi.scd.mafd", buf);
         snprintf(buf, sizeof(buf), "%0.3f", s->scene_score);
@@ -206,7 +194,7 @@ const AVFilter ff_vf_scdet = {
     .priv_size     = sizeof(SCDetContext),
     .priv_class    = &scdet_class,
     .uninit        = uninit,
-    .flags         = AVFILTER_FLAG_METADATA_ONLY,
+    .flags         = AVFILTER_FLAG_METADATA_ONLY | AVFILTER_FLAG_SLICE_THREADS,
     FILTER_INPUTS(scdet_inputs),
     FILTER_OUTPUTS(scdet_outputs),
     FILTER_PIXFMTS_ARRAY(pix_fmts),
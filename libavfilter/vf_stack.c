@@ -21,6 +21,7 @@
 #include "config_components.h"
 
 #include "libavutil/avstring.h"
+#include "libavutil/cpu.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
@@ -33,6 +34,8 @@
 #include "framesync.h"
 #include "video.h"
 
+#define MAX_CANVASES 4
+
 typedef struct StackItem {
     int x[4], y[4];
     int linesize[4];
@@ -60,6 +63,12 @@ typedef struct StackContext {
     StackItem *items;
     AVFrame **frames;
     FFFrameSync fs;
+
+    /* output frames the inputs render into directly, see get_video_buffer() */
+    int direct;             ///< whether the tile layout allows direct rendering
+    AVFrame *canvas[MAX_CANVASES];
+    int64_t canvas_seq;     ///< sequence number of canvas[0]
+    int64_t *tile_seq;      ///< sequence number of the next canvas for each input
 } StackContext;
 
 static int query_formats(AVFilterContext *ctx)
@@ -76,6 +85,150 @@ static int query_formats(AVFilterContext *ctx)
     return ff_set_common_formats(ctx, ff_formats_pixdesc_filter(0, reject_flags));
 }
 
+static AVFrame *get_canvas(AVFilterContext *ctx, int64_t seq)
+{
+    StackContext *s = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
+    int64_t min_seq = s->tile_seq[0];
+    int i, idx;
+
+    for (i = 1; i < s->nb_inputs; i++)
+        min_seq = FFMIN(min_seq, s->tile_seq[i]);
+
+    /* every input got its tile of the oldest canvases, the tiles keep
+     * references to them */
+    while (s->canvas_seq < min_seq) {
+        av_frame_free(&s->canvas[0]);
+        memmove(s->canvas, s->canvas + 1, sizeof(*s->canvas) * (MAX_CANVASES - 1));
+        s->canvas[MAX_CANVASES - 1] = NULL;
+        s->canvas_seq++;
+    }
+
+    idx = seq - s->canvas_seq;
+    if (idx >= MAX_CANVASES)
+        return NULL;
+    if (!s->canvas[idx])
+        s->canvas[idx] = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+    return s->canvas[idx];
+}
+
+/**
+ * Let the inputs render directly into their place in an output frame:
+ * the n-th buffer requested by each input is a tile of the n-th canvas.
+ * Outputs whose inputs all come from the same canvas need no copy.
+ */
+static AVFrame *get_video_buffer(AVFilterLink *inlink, int w, int h)
+{
+    AVFilterContext *ctx = inlink->dst;
+    StackContext *s = ctx->priv;
+    int i = FF_INLINK_IDX(inlink);
+    const StackItem *item = &s->items[i];
+    AVFrame *canvas, *frame;
+
+    if (!s->direct || w != inlink->w || h != inlink->h || !s->fs.in)
+        return NULL;
+
+    canvas = get_canvas(ctx, s->tile_seq[i]);
+    if (!canvas)
+        return NULL;
+    s->tile_seq[i]++;
+
+    /* a canvas provided by a downstream filter may not be aligned */
+    for (int p = 0; p < s->nb_planes; p++)
+        if (((uintptr_t)canvas->data[p] | canvas->linesize[p]) % av_cpu_max_align())
+            return NULL;
+
+    frame = av_frame_alloc();
+    if (!frame)
+        return NULL;
+    if (av_frame_ref(frame, canvas) < 0) {
+        av_frame_free(&frame);
+        return NULL;
+    }
+
+    frame->width  = w;
+    frame->height = h;
+    for (int p = 0; p < s->nb_planes; p++)
+        frame->data[p] += frame->linesize[p] * item->y[p] + item->x[p];
+
+    return frame;
+}
+
+/**
+ * Check whether the inputs can render into tiles of the output frame.
+ * Tiles must be as aligned as frames allocated by ff_get_video_buffer(),
+ * and SIMD code may write past the width of a tile, up to the next multiple
+ * of the alignment, so that area must not belong to another tile.
+ */
+static int tiles_allow_direct(AVFilterContext *ctx)
+{
+    StackContext *s = ctx->priv;
+    const int align = av_cpu_max_align();
+
+    if (s->fillcolor_enable)
+        return 0;
+
+    for (int p = 0; p < s->nb_planes; p++) {
+        for (int i = 0; i < s->nb_inputs; i++) {
+            const StackItem *a = &s->items[i];
+            const int end = a->x[p] + FFALIGN(a->linesize[p], align);
+
+            if (a->x[p] % align)
+                return 0;
+
+            for (int j = 0; j < s->nb_inputs; j++) {
+                const StackItem *b = &s->items[j];
+
+                if (j == i ||
+                    b->y[p] >= a->y[p] + a->height[p] ||
+                    a->y[p] >= b->y[p] + b->height[p])
+                    continue;
+                if (b->x[p] >= a->x[p] && b->x[p] < end)
+                    return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * Check whether all input frames are tiles of the same canvas, and return
+ * the start of the canvas planes in data if so.
+ */
+static int frames_share_canvas(AVFilterContext *ctx, AVFrame **in, uint8_t *data[4])
+{
+    StackContext *s = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
+
+    if (!s->direct)
+        return 0;
+
+    for (int p = 0; p < s->nb_planes; p++) {
+        const int linesize = in[0]->linesize[p];
+        const int h = p == 1 || p == 2 ? AV_CEIL_RSHIFT(outlink->h, s->desc->log2_chroma_h) : outlink->h;
+        AVBufferRef *buf = av_frame_get_plane_buffer(in[0], p);
+
+        if (!buf || linesize <= 0)
+            return 0;
+        data[p] = in[0]->data[p] - linesize * s->items[0].y[p] - s->items[0].x[p];
+        if (data[p] < buf->data ||
+            data[p] + (ptrdiff_t)linesize * h > buf->data + buf->size)
+            return 0;
+
+        for (int i = 1; i < s->nb_inputs; i++) {
+            AVBufferRef *buf1 = av_frame_get_plane_buffer(in[i], p);
+
+            if (!buf1 || buf1->buffer != buf->buffer ||
+                in[i]->linesize[p] != linesize ||
+                in[i]->data[p] != data[p] + linesize * s->items[i].y[p] + s->items[i].x[p])
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
 static av_cold int init(AVFilterContext *ctx)
 {
     StackContext *s = ctx->priv;
@@ -123,10 +276,15 @@ static av_cold int init(AVFilterContext *ctx)
     if (!s->items)
         return AVERROR(ENOMEM);
 
+    s->tile_seq = av_calloc(s->nb_inputs, sizeof(*s->tile_seq));
+    if (!s->tile_seq)
+        return AVERROR(ENOMEM);
+
     for (i = 0; i < s->nb_inputs; i++) {
         AVFilterPad pad = { 0 };
 
         pad.type = AVMEDIA_TYPE_VIDEO;
+        pad.get_buffer.video = get_video_buffer;
         pad.name = av_asprintf("input%d", i);
         if (!pad.name)
             return AVERROR(ENOMEM);
@@ -168,6 +326,7 @@ static int process_frame(FFFrameSync *fs)
     StackContext *s = fs->opaque;
     AVFrame **in = s->frames;
     AVFrame *out;
+    uint8_t *data[4];
     int i, ret;
 
     for (i = 0; i < s->nb_inputs; i++) {
@@ -175,6 +334,30 @@ static int process_frame(FFFrameSync *fs)
             return ret;
     }
 
+    if (frames_share_canvas(ctx, in, data)) {
+        out = av_frame_alloc();
+        if (!out)
+            return AVERROR(ENOMEM);
+        for (i = 0; i < FF_ARRAY_ELEMS(out->buf) && in[0]->buf[i]; i++) {
+            out->buf[i] = av_buffer_ref(in[0]->buf[i]);
+            if (!out->buf[i]) {
+                av_frame_free(&out);
+                return AVERROR(ENOMEM);
+            }
+        }
+        for (i = 0; i < s->nb_planes; i++) {
+            out->data[i]     = data[i];
+            out->linesize[i] = in[0]->linesize[i];
+        }
+        out->extended_data = out->data;
+        out->format = outlink->format;
+        out->width  = outlink->w;
+        out->height = outlink->h;
+        out->pts = av_rescale_q(s->fs.pts, s->fs.time_base, outlink->time_base);
+        out->sample_aspect_ratio = outlink->sample_aspect_ratio;
+        return ff_filter_frame(outlink, out);
+    }
+
     out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
     if (!out)
         return AVERROR(ENOMEM);
@@ -378,6 +561,10 @@ static int config_output(AVFilterLink *outlink)
     }
 
     s->nb_planes = av_pix_fmt_count_planes(outlink->format);
+    s->direct    = tiles_allow_direct(ctx);
+    if (!s->direct)
+        av_log(ctx, AV_LOG_DEBUG, "Tile layout does not allow direct rendering, "
+               "input frames will be copied.\n");
 
     outlink->w          = width;
     outlink->h          = height;
@@ -424,6 +611,9 @@ static av_cold void uninit(AVFilterContext *ctx)
     ff_framesync_uninit(&s->fs);
     av_freep(&s->frames);
     av_freep(&s->items);
+    av_freep(&s->tile_seq);
+    for (int i = 0; i < MAX_CANVASES; i++)
+        av_frame_free(&s->canvas[i]);
 }
 
 static int activate(AVFilterContext *ctx)
@@ -16,9 +16,20 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "config.h"
+
+#define _DEFAULT_SOURCE
+#define _SVID_SOURCE // needed for MAP_ANONYMOUS
+#define _DARWIN_C_SOURCE // needed for MAP_ANON
 #include <stdatomic.h>
 #include <stdint.h>
 #include <string.h>
+#if HAVE_MMAP
+#include <sys/mman.h>
+#if defined(MAP_ANON) && !defined(MAP_ANONYMOUS)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
 
 #include "avassert.h"
 #include "buffer_internal.h"
@@ -293,6 +304,19 @@ AVBufferPool *av_buffer_pool_init(size_t size, AVBufferRef* (*alloc)(size_t size
     return pool;
 }
 
+AVBufferPool *av_buffer_pool_init_flags(size_t size,
+                                        AVBufferRef* (*alloc)(size_t size),
+                                        int flags)
+{
+    AVBufferPool *pool = av_buffer_pool_init(size, alloc);
+    if (!pool)
+        return NULL;
+
+    pool->flags = flags;
+
+    return pool;
+}
+
 static void buffer_pool_flush(AVBufferPool *pool)
 {
     while (pool->pool) {
@@ -350,6 +374,70 @@ static void pool_release_buffer(void *opaque, uint8_t *data)
         buffer_pool_free(pool);
 }
 
+#if HAVE_MMAP && defined(MAP_ANONYMOUS)
+#define HUGE_PAGE_SIZE (2 << 20)
+
+/* MAP_HUGETLB alone uses the default huge page size of the system, which
+ * may be 1 GiB: ask for 2 MiB pages explicitly, matching the rounding of
+ * the mapping size, or not at all. */
+#if defined(MAP_HUGETLB) && !defined(MAP_HUGE_2MB) && defined(MAP_HUGE_SHIFT)
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+
+static void pool_unmap_buffer(void *opaque, uint8_t *data)
+{
+    munmap(data, (size_t)(uintptr_t)opaque);
+}
+
+/* allocate a buffer as an anonymous mapping honouring the pool flags;
+ * returns NULL when the flags do not apply, so that the caller falls back
+ * to the regular allocator */
+static AVBufferRef *pool_map_buffer(AVBufferPool *pool)
+{
+    AVBufferRef *ret;
+    size_t size = FFALIGN(pool->size, HUGE_PAGE_SIZE);
+    uint8_t *data = MAP_FAILED;
+
+    if (!pool->flags || pool->size < HUGE_PAGE_SIZE || size < pool->size)
+        return NULL;
+
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_2MB)
+    if (pool->flags & AV_BUFFER_POOL_FLAG_HUGETLB)
+        data = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0);
+#endif
+    if (data == MAP_FAILED) {
+        data = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (data == MAP_FAILED)
+            return NULL;
+#ifdef MADV_HUGEPAGE
+        if (pool->flags & (AV_BUFFER_POOL_FLAG_HUGEPAGE | AV_BUFFER_POOL_FLAG_HUGETLB))
+            madvise(data, size, MADV_HUGEPAGE);
+#endif
+    }
+
+    /* Touch every (small) page so that they are all faulted in here, in the
+     * allocating thread. The mapping is zero-filled, so this is a no-op for
+     * the contents. */
+    if (pool->flags & AV_BUFFER_POOL_FLAG_NUMA_LOCAL) {
+        for (size_t i = 0; i < size; i += 4096)
+            ((volatile uint8_t *)data)[i] = 0;
+    }
+
+    ret = av_buffer_create(data, pool->size, pool_unmap_buffer,
+                           (void *)(uintptr_t)size, 0);
+    if (!ret)
+        munmap(data, size);
+    return ret;
+}
+#else
+static AVBufferRef *pool_map_buffer(AVBufferPool *pool)
+{
+    return NULL;
+}
+#endif
+
 /* allocate a new buffer and override its free() callback so that
  * it is returned to the pool on free */
 static AVBufferRef *pool_alloc_buffer(AVBufferPool *pool)
@@ -359,8 +447,10 @@ static AVBufferRef *pool_alloc_buffer(AVBufferPool *pool)
 
     av_assert0(pool->alloc || pool->alloc2);
 
-    ret = pool->alloc2 ? pool->alloc2(pool->opaque, pool->size) :
-                         pool->alloc(pool->size);
+    ret = pool_map_buffer(pool);
+    if (!ret)
+        ret = pool->alloc2 ? pool->alloc2(pool->opaque, pool->size) :
+                             pool->alloc(pool->size);
     if (!ret)
         return NULL;
 
@@ -284,6 +284,56 @@ AVBufferPool *av_buffer_pool_init2(size_t size, void *opaque,
                                    AVBufferRef* (*alloc)(void *opaque, size_t size),
                                    void (*pool_free)(void *opaque));
 
+/**
+ * @defgroup lavu_bufferpool_flags Buffer pool flags
+ * Flags for av_buffer_pool_init_flags(). They only apply to buffers large
+ * enough to span at least one huge page (2 MiB); smaller buffers are always
+ * obtained from the regular allocator. All flags are hints and are silently
+ * ignored on systems that do not support them.
+ *
+ * Only pooled buffers honour them: one-off allocations such as those of
+ * av_frame_get_buffer() would pay for a new mapping, zeroed by the kernel,
+ * on every call.
+ * @{
+ */
+/**
+ * Back the buffers with transparent huge pages, reducing TLB misses when
+ * large frames are accessed.
+ */
+#define AV_BUFFER_POOL_FLAG_HUGEPAGE   (1 << 0)
+/**
+ * Back the buffers with explicit (pre-reserved) 2 MiB huge pages. When none
+ * are available, fall back to the behaviour of AV_BUFFER_POOL_FLAG_HUGEPAGE.
+ */
+#define AV_BUFFER_POOL_FLAG_HUGETLB    (1 << 1)
+/**
+ * Fault in all the pages of a new buffer in the thread that allocates it, so
+ * that with the default first-touch NUMA policy its memory is placed on the
+ * node that thread runs on instead of the node of the first thread writing
+ * to it.
+ */
+#define AV_BUFFER_POOL_FLAG_NUMA_LOCAL (1 << 2)
+/**
+ * @}
+ */
+
+/**
+ * Allocate and initialize a buffer pool whose buffers are allocated according
+ * to the given flags.
+ *
+ * @param size size of each buffer in this pool
+ * @param alloc a function that will be used to allocate new buffers that the
+ *              flags do not apply to. May be NULL, then the default allocator
+ *              will be used (av_buffer_alloc()).
+ * @param flags a combination of AV_BUFFER_POOL_FLAG_*
+ * @return newly created buffer pool on success, NULL on error.
+ *
+ * @note Buffers allocated according to the flags are zero-initialized.
+ */
+AVBufferPool *av_buffer_pool_init_flags(size_t size,
+                                        AVBufferRef* (*alloc)(size_t size),
+                                        int flags);
+
 /**
  * Mark the pool as being available for freeing. It will actually be freed only
  * once all the allocated buffers associated with the pool are released. Thus it
@@ -105,6 +105,8 @@ struct AVBufferPool {
     AVBufferRef* (*alloc)(size_t size);
     AVBufferRef* (*alloc2)(void *opaque, size_t size);
     void         (*pool_free)(void *opaque);
+
+    int flags;
 };
 
 #endif /* AVUTIL_BUFFER_INTERNAL_H */
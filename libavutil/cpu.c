@@ -28,12 +28,18 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "attributes.h"
 #include "cpu.h"
 #include "cpu_internal.h"
 #include "opt.h"
 #include "common.h"
+#include "error.h"
+#include "mem.h"
+#include "thread.h"
 
 #if HAVE_GETPROCESSAFFINITYMASK || HAVE_WINRT
 #include <windows.h>
@@ -262,6 +268,138 @@ void av_cpu_force_count(int count)
     atomic_store_explicit(&cpu_count, count, memory_order_relaxed);
 }
 
+#if HAVE_SCHED_GETAFFINITY && defined(CPU_SET)
+static int parse_cpu_list(cpu_set_t *set, const char *list)
+{
+    CPU_ZERO(set);
+
+    while (*list && *list != '\n') {
+        char *end;
+        long first = strtol(list, &end, 10), last = first, stride = 1;
+
+        if (end == list || first < 0)
+            return AVERROR(EINVAL);
+        list = end;
+        if (*list == '-') {
+            last = strtol(++list, &end, 10);
+            if (end == list || last < first)
+                return AVERROR(EINVAL);
+            list = end;
+            if (*list == ':') {
+                stride = strtol(++list, &end, 10);
+                if (end == list || stride < 1)
+                    return AVERROR(EINVAL);
+                list = end;
+            }
+        }
+        if (last >= CPU_SETSIZE)
+            return AVERROR(EINVAL);
+        for (;; first += stride) {
+            CPU_SET(first, set);
+            if (last - first < stride)
+                break;
+        }
+
+        if (*list == ',')
+            list++;
+        else if (*list && *list != '\n')
+            return AVERROR(EINVAL);
+    }
+
+    return CPU_COUNT(set) ? 0 : AVERROR(EINVAL);
+}
+
+static int parse_affinity(cpu_set_t *set, const char *spec)
+{
+    char path[64], buf[1024];
+    char *end;
+    long node;
+    FILE *f;
+    int ret;
+
+    if (strncmp(spec, "node", 4))
+        return parse_cpu_list(set, spec);
+
+    node = strtol(spec + 4, &end, 10);
+    if (end == spec + 4 || *end || node < 0)
+        return AVERROR(EINVAL);
+
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%ld/cpulist", node);
+    f = fopen(path, "r");
+    if (!f) {
+        av_log(NULL, AV_LOG_ERROR, "Unknown NUMA node %ld\n", node);
+        return AVERROR(EINVAL);
+    }
+    ret = fgets(buf, sizeof(buf), f) ? parse_cpu_list(set, buf) : AVERROR(EIO);
+    fclose(f);
+
+    return ret;
+}
+
+int av_cpu_set_thread_affinity(const char *spec)
+{
+    cpu_set_t set;
+    int ret = parse_affinity(&set, spec);
+    if (ret < 0)
+        return ret;
+
+    if (sched_setaffinity(0, sizeof(set), &set))
+        return AVERROR(errno);
+
+    return 0;
+}
+
+int avpriv_thread_affinity_push(const char *spec, void **saved)
+{
+    cpu_set_t set, *old;
+    int ret;
+
+    *saved = NULL;
+    if (!spec || !*spec)
+        return 0;
+
+    ret = parse_affinity(&set, spec);
+    if (ret < 0)
+        return ret;
+
+    old = av_malloc(sizeof(*old));
+    if (!old)
+        return AVERROR(ENOMEM);
+
+    if (sched_getaffinity(0, sizeof(*old), old) ||
+        sched_setaffinity(0, sizeof(set), &set)) {
+        ret = AVERROR(errno);
+        av_free(old);
+        return ret;
+    }
+    *saved = old;
+
+    return 0;
+}
+
+void avpriv_thread_affinity_pop(void **saved)
+{
+    if (*saved)
+        sched_setaffinity(0, sizeof(cpu_set_t), *saved);
+    av_freep(saved);
+}
+#else
+int av_cpu_set_thread_affinity(const char *spec)
+{
+    return AVERROR(ENOSYS);
+}
+
+int avpriv_thread_affinity_push(const char *spec, void **saved)
+{
+    *saved = NULL;
+    return spec && *spec ? AVERROR(ENOSYS) : 0;
+}
+
+void avpriv_thread_affinity_pop(void **saved)
+{
+}
+#endif
+
 size_t av_cpu_max_align(void)
 {
 #if ARCH_MIPS
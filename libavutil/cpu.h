@@ -120,6 +120,20 @@ int av_cpu_count(void);
  */
 void av_cpu_force_count(int count);
 
+/**
+ * Restrict the calling thread to a set of CPUs. Threads it creates afterwards
+ * inherit the restriction, and av_cpu_count() reports the size of the set,
+ * so that automatically sized thread pools match it.
+ *
+ * @param spec "nodeN" for the CPUs of NUMA node N, or a comma-separated list
+ *             of CPU numbers and ranges, optionally with a stride, e.g.
+ *             "0-7,16-23" or "0-15:2"
+ * @return 0 on success, AVERROR(EINVAL) if spec is invalid,
+ *         AVERROR(ENOSYS) if thread affinity is not supported on this system,
+ *         another negative error code on failure
+ */
+int av_cpu_set_thread_affinity(const char *spec);
+
 /**
  * Get the maximum data alignment that may be required by FFmpeg.
  *
@@ -29,11 +29,114 @@
 #include "time_internal.h"
 #include "bprint.h"
 
+/* dictionaries with at least that many entries get a hash index */
+#define INDEX_MIN_ENTRIES 16
+
+typedef struct DictIndexLink {
+    uint32_t hash;
+    int next;
+} DictIndexLink;
+
 struct AVDictionary {
     int count;
     AVDictionaryEntry *elems;
+    unsigned elems_size;
+
+    /* Hash index of the keys, case-insensitive: links[i] chains elems[i] in
+     * the bucket hash & (index_size - 1). Empty if index_size is 0. */
+    DictIndexLink *links;
+    int *buckets;
+    int index_size;
 };
 
+static uint32_t key_hash(const char *key)
+{
+    uint32_t hash = 2166136261U;
+
+    for (; *key; key++)
+        hash = (hash ^ av_toupper(*key)) * 16777619U;
+    return hash;
+}
+
+static void index_link(AVDictionary *m, int i)
+{
+    int *bucket = &m->buckets[m->links[i].hash & (m->index_size - 1)];
+
+    m->links[i].next = *bucket;
+    *bucket          = i;
+}
+
+static void index_unlink(AVDictionary *m, int i)
+{
+    int *pos = &m->buckets[m->links[i].hash & (m->index_size - 1)];
+
+    while (*pos != i)
+        pos = &m->links[*pos].next;
+    *pos = m->links[i].next;
+}
+
+static void index_free(AVDictionary *m)
+{
+    av_freep(&m->links);
+    av_freep(&m->buckets);
+    m->index_size = 0;
+}
+
+static void index_build(AVDictionary *m, int size)
+{
+    DictIndexLink *links = av_realloc_array(m->links, size, sizeof(*links));
+    int *buckets;
+
+    if (links)
+        m->links = links;
+    buckets = av_realloc_array(m->buckets, size, sizeof(*buckets));
+    if (buckets)
+        m->buckets = buckets;
+    if (!links || !buckets) {
+        /* lookups fall back to a linear scan */
+        index_free(m);
+        return;
+    }
+
+    m->index_size = size;
+    for (int i = 0; i < size; i++)
+        m->buckets[i] = -1;
+    for (int i = 0; i < m->count; i++) {
+        m->links[i].hash = key_hash(m->elems[i].key);
+        index_link(m, i);
+    }
+}
+
+/* index the last entry of m */
+static void index_add(AVDictionary *m)
+{
+    int i = m->count - 1;
+
+    if (m->count > m->index_size) {
+        if (m->count >= INDEX_MIN_ENTRIES)
+            index_build(m, FFMAX(2 * m->index_size, 2 * INDEX_MIN_ENTRIES));
+        return;
+    }
+    m->links[i].hash = key_hash(m->elems[i].key);
+    index_link(m, i);
+}
+
+/* remove elems[i] from m, replacing it with the last entry */
+static void remove_entry(AVDictionary *m, int i)
+{
+    int last = --m->count;
+
+    if (m->index_size) {
+        index_unlink(m, i);
+        if (i != last) {
+            index_unlink(m, last);
+            m->links[i].hash = m->links[last].hash;
+            index_link(m, i);
+        }
+    }
+    m->elems[i] = m->elems[last];
+}
+
 int av_dict_count(const AVDictionary *m)
 {
     return m ? m->count : 0;
@@ -66,6 +169,23 @@ AVDictionaryEntry *av_dict_get(const AVDictionary *m, const char *key,
     if (!key)
         return NULL;
 
+    if (m && m->index_size && !(flags & AV_DICT_IGNORE_SUFFIX)) {
+        uint32_t hash = key_hash(key);
+        int start = prev ? prev - m->elems + 1 : 0;
+        int found = -1;
+
+        /* entries are chained in no particular order, return the first one
+         * in iteration order */
+        for (int i = m->buckets[hash & (m->index_size - 1)]; i >= 0; i = m->links[i].next) {
+            if (m->links[i].hash != hash || i < start || (found >= 0 && i > found))
+                continue;
+            if (flags & AV_DICT_MATCH_CASE ? !strcmp(m->elems[i].key, key)
+                                           : !av_strcasecmp(m->elems[i].key, key))
+                found = i;
+        }
+        return found >= 0 ? &m->elems[found] : NULL;
+    }
+
     while ((entry = av_dict_iterate(m, entry))) {
         const char *s = entry->key;
         if (flags & AV_DICT_MATCH_CASE)
@@ -83,12 +203,22 @@ AVDictionaryEntry *av_dict_get(const AVDictionary *m, const char *key,
     return NULL;
 }
 
+static void dict_free(AVDictionary **pm)
+{
+    AVDictionary *m = *pm;
+
+    av_freep(&m->elems);
+    index_free(m);
+    av_freep(pm);
+}
+
 int av_dict_set(AVDictionary **pm, const char *key, const char *value,
                 int flags)
 {
     AVDictionary *m = *pm;
     AVDictionaryEntry *tag = NULL;
     char *copy_key = NULL, *copy_value = NULL;
+    int reuse_key = 0;
     int err;
 
     if (flags & AV_DICT_DONT_STRDUP_VAL)
@@ -104,11 +234,13 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
     }
     if (flags & AV_DICT_DONT_STRDUP_KEY)
         copy_key = (void *)key;
+    else if (tag && !strcmp(tag->key, key))
+        reuse_key = 1; /* the replacing entry takes over the key */
     else
         copy_key = av_strdup(key);
     if (!m)
         m = *pm = av_mallocz(sizeof(*m));
-    if (!m || !copy_key || (value && !copy_value))
+    if (!m || (!copy_key && !reuse_key) || (value && !copy_value))
         goto enomem;
 
     if (tag) {
@@ -129,11 +261,14 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
             copy_value = newval;
         } else
             av_free(tag->value);
-        av_free(tag->key);
-        *tag = m->elems[--m->count];
+        if (reuse_key)
+            copy_key = tag->key;
+        else
+            av_free(tag->key);
+        remove_entry(m, tag - m->elems);
     } else if (copy_value) {
-        AVDictionaryEntry *tmp = av_realloc_array(m->elems,
-                                                  m->count + 1, sizeof(*m->elems));
+        AVDictionaryEntry *tmp = av_fast_realloc(m->elems, &m->elems_size,
+                                                 (m->count + 1LL) * sizeof(*m->elems));
         if (!tmp)
             goto enomem;
         m->elems = tmp;
@@ -142,11 +277,10 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
         m->elems[m->count].key = copy_key;
         m->elems[m->count].value = copy_value;
         m->count++;
+        index_add(m);
     } else {
-        if (!m->count) {
-            av_freep(&m->elems);
-            av_freep(pm);
-        }
+        if (!m->count)
+            dict_free(pm);
         av_freep(&copy_key);
     }
 
@@ -155,10 +289,8 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
 enomem:
     err = AVERROR(ENOMEM);
 err_out:
-    if (m && !m->count) {
-        av_freep(&m->elems);
-        av_freep(pm);
-    }
+    if (m && !m->count)
+        dict_free(pm);
     av_free(copy_key);
     av_free(copy_value);
     return err;
@@ -229,9 +361,8 @@ void av_dict_free(AVDictionary **pm)
             av_freep(&m->elems[m->count].key);
             av_freep(&m->elems[m->count].value);
         }
-        av_freep(&m->elems);
+        dict_free(pm);
     }
-    av_freep(pm);
 }
 
 int av_dict_copy(AVDictionary **dst, const AVDictionary *src, int flags)
@@ -29,6 +29,7 @@
 #include "ripemd.h"
 #include "sha.h"
 #include "sha512.h"
+#include "xxhash.h"
 
 #include "avstring.h"
 #include "base64.h"
@@ -52,6 +53,8 @@ enum hashtype {
     SHA512,
     CRC32,
     ADLER32,
+    XXH3_64,
+    XXH3_128,
     NUM_HASHES
 };
 
@@ -81,6 +84,8 @@ static const struct {
     [SHA512]  = {"SHA512",  64},
     [CRC32]   = {"CRC32",    4},
     [ADLER32] = {"adler32",  4},
+    [XXH3_64]  = {"xxh3_64",  8},
+    [XXH3_128] = {"xxh3_128", 16},
 };
 
 const char *av_hash_names(int i)
@@ -127,6 +132,8 @@ int av_hash_alloc(AVHashContext **ctx, const char *name)
     case SHA512:  res->ctx = av_sha512_alloc(); break;
     case CRC32:   res->crctab = av_crc_get_table(AV_CRC_32_IEEE_LE); break;
     case ADLER32: break;
+    case XXH3_64:
+    case XXH3_128: res->ctx = av_xxh3_alloc(); break;
     }
     if (i != ADLER32 && i != CRC32 && !res->ctx) {
         av_free(res);
@@ -154,6 +161,8 @@ void av_hash_init(AVHashContext *ctx)
     case SHA512:  av_sha512_init(ctx->ctx, 512); break;
     case CRC32:   ctx->crc = UINT32_MAX; break;
     case ADLER32: ctx->crc = 1; break;
+    case XXH3_64:
+    case XXH3_128: av_xxh3_init(ctx->ctx); break;
     }
 }
 
@@ -175,6 +184,8 @@ void av_hash_update(AVHashContext *ctx, const uint8_t *src, size_t len)
     case SHA512:  av_sha512_update(ctx->ctx, src, len); break;
     case CRC32:   ctx->crc = av_crc(ctx->crctab, ctx->crc, src, len); break;
     case ADLER32: ctx->crc = av_adler32_update(ctx->crc, src, len); break;
+    case XXH3_64:
+    case XXH3_128: av_xxh3_update(ctx->ctx, src, len); break;
     }
 }
 
@@ -196,6 +207,8 @@ void av_hash_final(AVHashContext *ctx, uint8_t *dst)
     case SHA512:  av_sha512_final(ctx->ctx, dst); break;
     case CRC32:   AV_WB32(dst, ctx->crc ^ UINT32_MAX); break;
     case ADLER32: AV_WB32(dst, ctx->crc); break;
+    case XXH3_64:  av_xxh3_final_64(ctx->ctx, dst); break;
+    case XXH3_128: av_xxh3_final_128(ctx->ctx, dst); break;
     }
 }
 
@@ -102,6 +102,9 @@
  * If the Murmur3 hash is selected, the default seed will be used. See @ref
  * lavu_murmur3_seedinfo "Murmur3" for more information.
  *
+ * If one of the XXH3 hashes is selected, the digest is output in the
+ * canonical byte order. See @ref lavu_xxh3 "XXH3" for more information.
+ *
  * @{
  */
 
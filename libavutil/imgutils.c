@@ -349,6 +349,11 @@ static void image_copy_plane(uint8_t       *dst, ptrdiff_t dst_linesize,
         return;
     av_assert0(FFABS(src_linesize) >= bytewidth);
     av_assert0(FFABS(dst_linesize) >= bytewidth);
+
+    if (dst_linesize == bytewidth && src_linesize == bytewidth) {
+        memcpy(dst, src, bytewidth * height);
+        return;
+    }
     for (;height > 0; height--) {
         memcpy(dst, src, bytewidth);
         dst += dst_linesize;
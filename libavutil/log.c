@@ -34,14 +34,17 @@
 #endif
 #include <inttypes.h>
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "avstring.h"
 #include "bprint.h"
 #include "common.h"
 #include "internal.h"
 #include "log.h"
 #include "thread.h"
+#include "time.h"
 
 static AVMutex mutex = AV_MUTEX_INITIALIZER;
 
@@ -345,6 +348,373 @@ int av_log_format_line2(void *ptr, int level, const char *fmt, va_list vl,
     return ret;
 }
 
+/* A log message formatted by the logging thread, written out later. */
+typedef struct LogRecord {
+    atomic_uint seq;
+    int level;
+    unsigned tint;
+    int print_prefix;
+    int type[2];
+    int64_t time;
+    const void *ctx[2];         ///< parent and logging context, if any
+    char name[2][64];           ///< their item names
+    char msg[LINE_SZ];
+} LogRecord;
+
+static void fill_record(LogRecord *rec, void *avcl, int level, unsigned tint,
+                        const char *fmt, va_list vl, int *print_prefix)
+{
+    AVClass *avc = avcl ? *(AVClass **) avcl : NULL;
+    int len;
+
+    rec->level        = level;
+    rec->tint         = tint;
+    rec->print_prefix = *print_prefix;
+    rec->time         = av_gettime();
+    rec->ctx[0]  = rec->ctx[1]  = NULL;
+    rec->type[0] = rec->type[1] = AV_CLASS_CATEGORY_NA + 16;
+    if (avc) {
+        if (avc->parent_log_context_offset) {
+            AVClass** parent = *(AVClass ***) (((uint8_t *) avcl) +
+                                   avc->parent_log_context_offset);
+            if (parent && *parent) {
+                rec->ctx[0]  = parent;
+                rec->type[0] = get_category(parent);
+                av_strlcpy(rec->name[0], (*parent)->item_name(parent), sizeof(rec->name[0]));
+            }
+        }
+        rec->ctx[1]  = avcl;
+        rec->type[1] = get_category(avcl);
+        av_strlcpy(rec->name[1], avc->item_name(avcl), sizeof(rec->name[1]));
+    }
+
+    len = vsnprintf(rec->msg, sizeof(rec->msg), fmt, vl);
+    if (len >= (int)sizeof(rec->msg)) {
+        /* keep truncated messages on a line of their own */
+        len = sizeof(rec->msg) - 1;
+        rec->msg[len - 1] = '\n';
+    } else if (len < 0) {
+        len = 0;
+        rec->msg[0] = 0;
+    }
+
+    if ((*print_prefix && (avc || (level > AV_LOG_QUIET && (flags & AV_LOG_PRINT_LEVEL)))) || len) {
+        char lastc = len ? rec->msg[len - 1] : 0;
+        *print_prefix = lastc == '\n' || lastc == '\r';
+    }
+}
+
+static void write_record_text(LogRecord *rec)
+{
+    static int count;
+    static char prev[LINE_SZ];
+    static int is_atty;
+    char part[3][128] = { "" };
+    char line[LINE_SZ];
+    int level = av_clip(rec->level >> 3, 0, NB_LEVELS - 1);
+
+    if (rec->print_prefix) {
+        for (int i = 0; i < 2; i++)
+            if (rec->ctx[i])
+                snprintf(part[i], sizeof(part[i]), "[%s @ %p] ", rec->name[i], rec->ctx[i]);
+        if (rec->level > AV_LOG_QUIET && (flags & AV_LOG_PRINT_LEVEL))
+            snprintf(part[2], sizeof(part[2]), "[%s] ", get_level_str(rec->level));
+    }
+    av_strlcpy(line, part[0], sizeof(line));
+    av_strlcat(line, part[1], sizeof(line));
+    av_strlcat(line, part[2], sizeof(line));
+    av_strlcat(line, rec->msg, sizeof(line));
+
+#if HAVE_ISATTY
+    if (!is_atty)
+        is_atty = isatty(2) ? 1 : -1;
+#endif
+
+    if (rec->print_prefix && (flags & AV_LOG_SKIP_REPEATED) && !strcmp(line, prev) &&
+        *line && line[strlen(line) - 1] != '\r'){
+        count++;
+        if (is_atty == 1)
+            fprintf(stderr, "    Last message repeated %d times\r", count);
+        return;
+    }
+    if (count > 0) {
+        fprintf(stderr, "    Last message repeated %d times\n", count);
+        count = 0;
+    }
+    strcpy(prev, line);
+    sanitize(part[0]);
+    colored_fputs(rec->type[0], 0, part[0]);
+    sanitize(part[1]);
+    colored_fputs(rec->type[1], 0, part[1]);
+    sanitize(part[2]);
+    colored_fputs(level, rec->tint >> 8, part[2]);
+    sanitize(rec->msg);
+    colored_fputs(level, rec->tint >> 8, rec->msg);
+}
+
+static void json_escape(AVBPrint *bp, const char *str)
+{
+    for (; *str; str++) {
+        switch (*str) {
+        case '"':  av_bprint_chars(bp, '\\', 1); av_bprint_chars(bp, '"', 1);  break;
+        case '\\': av_bprint_chars(bp, '\\', 2);                               break;
+        case '\n': av_bprint_chars(bp, '\\', 1); av_bprint_chars(bp, 'n', 1);  break;
+        case '\r': av_bprint_chars(bp, '\\', 1); av_bprint_chars(bp, 'r', 1);  break;
+        case '\t': av_bprint_chars(bp, '\\', 1); av_bprint_chars(bp, 't', 1);  break;
+        default:
+            if ((uint8_t)*str < 0x20)
+                av_bprintf(bp, "\\u%04x", (uint8_t)*str);
+            else
+                av_bprint_chars(bp, *str, 1);
+        }
+    }
+}
+
+/**
+ * Format rec as one line of JSON into bp, stripping the trailing newline of
+ * its message.
+ *
+ * @return 0 if the message is empty and nothing was written, 1 otherwise
+ */
+static int format_record_json(LogRecord *rec, AVBPrint *bp)
+{
+    static const char *const ctx_keys[2] = { "parent", "context" };
+    size_t len = strlen(rec->msg);
+
+    if (len && rec->msg[len - 1] == '\n')
+        rec->msg[--len] = 0;
+    if (!len)
+        return 0;
+
+    av_bprintf(bp, "{\"time\":%"PRId64".%06d,\"level\":\"%s\"",
+               rec->time / 1000000, (int)(rec->time % 1000000),
+               get_level_str(rec->level));
+    for (int i = 0; i < 2; i++) {
+        if (!rec->ctx[i])
+            continue;
+        av_bprintf(bp, ",\"%s\":\"", ctx_keys[i]);
+        json_escape(bp, rec->name[i]);
+        av_bprintf(bp, "\",\"%s_ptr\":\"%p\"", ctx_keys[i], rec->ctx[i]);
+    }
+    av_bprintf(bp, ",\"message\":\"");
+    json_escape(bp, rec->msg);
+    av_bprintf(bp, "\"}\n");
+    return 1;
+}
+
+static void write_record_json(LogRecord *rec)
+{
+    AVBPrint bp;
+
+    av_bprint_init(&bp, 0, AV_BPRINT_SIZE_AUTOMATIC);
+    if (format_record_json(rec, &bp))
+        fputs(bp.str, stderr);
+    av_bprint_finalize(&bp, NULL);
+}
+
+static void write_record(LogRecord *rec)
+{
+    if (flags & AV_LOG_JSON)
+        write_record_json(rec);
+    else
+        write_record_text(rec);
+}
+
+#if HAVE_THREADS
+/* Bounded multi-producer, single-consumer queue of log records. A record is
+ * free for the producer claiming position pos when its seq equals pos, and
+ * ready for the writer when seq equals pos + 1. */
+#define RING_SIZE 1024
+
+/* allocated when the first asynchronous message is logged, as it is large */
+static LogRecord *ring;
+static atomic_uint ring_tail;
+static atomic_uint ring_head;
+static atomic_uint nb_dropped;
+static atomic_int async_print_prefix;
+static atomic_int writer_idle;
+
+static pthread_mutex_t async_mutex;
+static pthread_cond_t  async_cond;
+static pthread_cond_t  async_done_cond;
+static pthread_t async_thread;
+static atomic_int async_ok;
+static int async_failed;
+static int writer_quit;
+
+static void *log_writer(void *arg)
+{
+    ff_thread_setname("av_log");
+
+    for (;;) {
+        unsigned head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+        LogRecord *rec = &ring[head % RING_SIZE];
+        unsigned dropped;
+
+        if (atomic_load(&rec->seq) == head + 1) {
+            write_record(rec);
+            atomic_store_explicit(&rec->seq, head + RING_SIZE, memory_order_release);
+            atomic_store(&ring_head, head + 1);
+            continue;
+        }
+        if ((dropped = atomic_exchange(&nb_dropped, 0))) {
+            LogRecord msg = { .level = AV_LOG_WARNING, .print_prefix = 1,
+                              .type  = { AV_CLASS_CATEGORY_NA + 16, AV_CLASS_CATEGORY_NA + 16 },
+                              .time  = av_gettime() };
+            snprintf(msg.msg, sizeof(msg.msg), "%u log messages dropped\n", dropped);
+            write_record(&msg);
+            continue;
+        }
+
+        /* Producers signal async_cond under the mutex if they see the writer
+         * idle, so a record published after the check below is not missed. */
+        pthread_mutex_lock(&async_mutex);
+        pthread_cond_broadcast(&async_done_cond);
+        if (writer_quit) {
+            pthread_mutex_unlock(&async_mutex);
+            break;
+        }
+        atomic_store(&writer_idle, 1);
+        if (atomic_load(&rec->seq) != head + 1)
+            pthread_cond_wait(&async_cond, &async_mutex);
+        atomic_store(&writer_idle, 0);
+        pthread_mutex_unlock(&async_mutex);
+    }
+    return NULL;
+}
+
+/* Called with the log mutex held. */
+static void async_init(void)
+{
+    ring = av_malloc_array(RING_SIZE, sizeof(*ring));
+    if (!ring)
+        goto fail;
+    for (int i = 0; i < RING_SIZE; i++)
+        atomic_init(&ring[i].seq, i);
+    atomic_init(&ring_tail, 0);
+    atomic_init(&ring_head, 0);
+    atomic_init(&async_print_prefix, 1);
+    writer_quit = 0;
+
+    if (pthread_mutex_init(&async_mutex, NULL))
+        goto fail_mutex;
+    if (pthread_cond_init(&async_cond, NULL))
+        goto fail_cond;
+    if (pthread_cond_init(&async_done_cond, NULL))
+        goto fail_done_cond;
+    if (pthread_create(&async_thread, NULL, log_writer, NULL))
+        goto fail_thread;
+    atomic_store(&async_ok, 1);
+    return;
+
+fail_thread:
+    pthread_cond_destroy(&async_done_cond);
+fail_done_cond:
+    pthread_cond_destroy(&async_cond);
+fail_cond:
+    pthread_mutex_destroy(&async_mutex);
+fail_mutex:
+    av_freep(&ring);
+fail:
+    async_failed = 1;
+}
+
+/**
+ * Stop the writer thread once the queue is empty and free the queue.
+ * Called with the log mutex held, while no other thread is logging.
+ */
+static void async_uninit(void)
+{
+    if (!atomic_load(&async_ok))
+        return;
+    av_log_flush();
+
+    pthread_mutex_lock(&async_mutex);
+    writer_quit = 1;
+    pthread_cond_signal(&async_cond);
+    pthread_mutex_unlock(&async_mutex);
+    pthread_join(async_thread, NULL);
+
+    atomic_store(&async_ok, 0);
+    pthread_cond_destroy(&async_done_cond);
+    pthread_cond_destroy(&async_cond);
+    pthread_mutex_destroy(&async_mutex);
+    av_freep(&ring);
+}
+
+static int log_async(void *avcl, int level, unsigned tint, const char *fmt, va_list vl)
+{
+    unsigned pos;
+    LogRecord *rec;
+    int print_prefix;
+
+    if (!atomic_load(&async_ok)) {
+        ff_mutex_lock(&mutex);
+        if (!atomic_load(&async_ok) && !async_failed)
+            async_init();
+        ff_mutex_unlock(&mutex);
+        if (!atomic_load(&async_ok))
+            return AVERROR(ENOSYS);
+    }
+
+    pos = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+    for (;;) {
+        int diff;
+
+        rec  = &ring[pos % RING_SIZE];
+        diff = atomic_load_explicit(&rec->seq, memory_order_acquire) - pos;
+        if (!diff) {
+            if (atomic_compare_exchange_weak_explicit(&ring_tail, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            /* the writer is behind, never wait for it */
+            atomic_fetch_add_explicit(&nb_dropped, 1, memory_order_relaxed);
+            return 0;
+        } else {
+            pos = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+        }
+    }
+
+    /* The prefix state is shared by all threads, as in the synchronous
+     * path; concurrent partial lines may only lose or gain a prefix. */
+    print_prefix = atomic_load_explicit(&async_print_prefix, memory_order_relaxed);
+    fill_record(rec, avcl, level, tint, fmt, vl, &print_prefix);
+    atomic_store_explicit(&async_print_prefix, print_prefix, memory_order_relaxed);
+
+    atomic_store(&rec->seq, pos + 1);
+    if (atomic_load(&writer_idle)) {
+        pthread_mutex_lock(&async_mutex);
+        pthread_cond_signal(&async_cond);
+        pthread_mutex_unlock(&async_mutex);
+    }
+
+    /* the process is likely to terminate right after this */
+    if (level <= AV_LOG_FATAL)
+        av_log_flush();
+    return 0;
+}
+#endif
+
+void av_log_flush(void)
+{
+#if HAVE_THREADS
+    unsigned tail;
+
+    if (!atomic_load(&async_ok))
+        return;
+
+    tail = atomic_load(&ring_tail);
+    pthread_mutex_lock(&async_mutex);
+    while ((int)(atomic_load(&ring_head) - tail) < 0) {
+        pthread_cond_signal(&async_cond);
+        pthread_cond_wait(&async_done_cond, &async_mutex);
+    }
+    pthread_mutex_unlock(&async_mutex);
+#endif
+}
+
 void av_log_default_callback(void* ptr, int level, const char* fmt, va_list vl)
 {
     static int print_prefix = 1;
@@ -363,8 +733,22 @@ void av_log_default_callback(void* ptr, int level, const char* fmt, va_list vl)
 
     if (level > av_log_level)
         return;
+
+#if HAVE_THREADS
+    if ((flags & AV_LOG_ASYNC) && log_async(ptr, level, tint, fmt, vl) >= 0)
+        return;
+#endif
+
     ff_mutex_lock(&mutex);
 
+    if (flags & AV_LOG_JSON) {
+        LogRecord rec;
+        fill_record(&rec, ptr, level, tint, fmt, vl, &print_prefix);
+        write_record_json(&rec);
+        ff_mutex_unlock(&mutex);
+        return;
+    }
+
     format_line(ptr, level, fmt, vl, part, &print_prefix, type);
     snprintf(line, sizeof(line), "%s%s%s%s", part[0].str, part[1].str, part[2].str, part[3].str);
 
@@ -446,7 +830,16 @@ void av_log_set_level(int level)
 
 void av_log_set_flags(int arg)
 {
+    int old = flags;
+
     flags = arg;
+#if HAVE_THREADS
+    if ((old & AV_LOG_ASYNC) && !(arg & AV_LOG_ASYNC)) {
+        ff_mutex_lock(&mutex);
+        async_uninit();
+        ff_mutex_unlock(&mutex);
+    }
+#endif
 }
 
 int av_log_get_flags(void)
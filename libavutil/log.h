@@ -377,9 +377,42 @@ int av_log_format_line2(void *ptr, int level, const char *fmt, va_list vl,
  */
 #define AV_LOG_PRINT_LEVEL 2
 
+/**
+ * Make av_log_default_callback() hand messages over to a background thread
+ * writing them out, instead of writing them itself under a global lock.
+ *
+ * Messages are formatted by the logging thread into a fixed-size queue and
+ * truncated to 1023 bytes. When the queue is full, messages are dropped and
+ * counted rather than waited for. Messages at AV_LOG_FATAL or lower severity
+ * wait until they have been written.
+ *
+ * Applications must call av_log_flush() before exiting to get all queued
+ * messages written. Clearing this flag with av_log_set_flags() writes the
+ * queued messages, then stops the thread and frees the queue; no other
+ * thread may log meanwhile. Has no effect if FFmpeg is built without threads.
+ */
+#define AV_LOG_ASYNC 4
+
+/**
+ * Make av_log_default_callback() write one JSON object per line for every
+ * message, with the fields "time" (seconds since the Epoch), "level",
+ * "parent" and "context" (item names of the logging context and its parent,
+ * if any, along with their addresses as "parent_ptr" and "context_ptr") and
+ * "message". A trailing newline is stripped from the message and empty
+ * messages are omitted. AV_LOG_SKIP_REPEATED and AV_LOG_PRINT_LEVEL are
+ * ignored in this mode.
+ */
+#define AV_LOG_JSON 8
+
 void av_log_set_flags(int arg);
 int av_log_get_flags(void);
 
+/**
+ * Wait until all messages queued by the default log callback with
+ * AV_LOG_ASYNC have been written.
+ */
+void av_log_flush(void);
+
 /**
  * @}
  */
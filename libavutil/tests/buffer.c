@@ -0,0 +1,96 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/buffer.h"
+#include "libavutil/macros.h"
+
+static const struct {
+    const char *name;
+    int flags;
+} pool_flags[] = {
+    { "none",             0 },
+    { "hugepage",         AV_BUFFER_POOL_FLAG_HUGEPAGE },
+    { "hugetlb",          AV_BUFFER_POOL_FLAG_HUGETLB },
+    { "numa_local",       AV_BUFFER_POOL_FLAG_NUMA_LOCAL },
+    { "hugetlb+numa",     AV_BUFFER_POOL_FLAG_HUGETLB | AV_BUFFER_POOL_FLAG_NUMA_LOCAL },
+};
+
+static const size_t sizes[] = {
+    4096, (2 << 20) - 1, 2 << 20, (3 << 20) + 17,
+};
+
+/* Whether the flags can be honoured depends on the system, so only what
+ * holds on every system is checked: buffers have the requested size, are
+ * zeroed when the default allocator is not involved, are reused by the
+ * pool, and outlive the pool. */
+static int test_pool(int flags, size_t size)
+{
+    AVBufferPool *pool = av_buffer_pool_init_flags(size, av_buffer_allocz, flags);
+    AVBufferRef *a, *b;
+    uint8_t *data;
+
+    if (!pool)
+        return -1;
+
+    a = av_buffer_pool_get(pool);
+    b = av_buffer_pool_get(pool);
+    if (!a || !b || a->size != size || b->size != size || a->data == b->data)
+        goto fail;
+    for (size_t i = 0; i < size; i++)
+        if (a->data[i] || b->data[i])
+            goto fail;
+    memset(a->data, 0xA5, size);
+    memset(b->data, 0x5A, size);
+
+    data = a->data;
+    av_buffer_unref(&a);
+    a = av_buffer_pool_get(pool);
+    if (!a || a->data != data || a->data[size - 1] != 0xA5)
+        goto fail;
+
+    av_buffer_pool_uninit(&pool);
+    b->data[size - 1] = 0;
+    av_buffer_unref(&a);
+    av_buffer_unref(&b);
+    return 0;
+
+fail:
+    av_buffer_unref(&a);
+    av_buffer_unref(&b);
+    av_buffer_pool_uninit(&pool);
+    return -1;
+}
+
+int main(void)
+{
+    int ret = 0;
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(pool_flags); i++) {
+        for (int j = 0; j < FF_ARRAY_ELEMS(sizes); j++) {
+            int err = test_pool(pool_flags[i].flags, sizes[j]);
+            printf("%-12s %8zu: %s\n", pool_flags[i].name, sizes[j],
+                   err ? "FAIL" : "OK");
+            ret |= !!err;
+        }
+    }
+
+    return ret;
+}
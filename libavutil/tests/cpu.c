@@ -16,6 +16,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "libavutil/cpu.c"
+
 #include <stdio.h>
 
 #include "config.h"
@@ -98,6 +100,56 @@ static void print_cpu_flags(int cpu_flags, const char *type)
     printf("\n");
 }
 
+#if HAVE_SCHED_GETAFFINITY && defined(CPU_SET)
+static int test_parse_cpu_list(void)
+{
+    static const struct {
+        const char *list;
+        const char *cpus;   ///< expected set, NULL if the list is invalid
+    } tests[] = {
+        { "3",            "3"                },
+        { "0-3",          "0 1 2 3"          },
+        { "0-1,4,6-7",    "0 1 4 6 7"        },
+        { "2-2",          "2"                },
+        { "0-3,2-5",      "0 1 2 3 4 5"      },
+        { "0-9:3",        "0 3 6 9"          },
+        { "1-8:3",        "1 4 7"            },
+        { "4-5:8",        "4"                },
+        { "0-6:2,1-3:2",  "0 1 2 3 4 6"      },
+        { "0-1\n",        "0 1"              },
+        { "",             NULL               },
+        { "a",            NULL               },
+        { "-1",           NULL               },
+        { "3-1",          NULL               },
+        { "0-",           NULL               },
+        { "1,",           "1"                },
+        { ",1",           NULL               },
+        { "0;1",          NULL               },
+        { "0-7:0",        NULL               },
+        { "0-7:",         NULL               },
+        { "0-7:-2",       NULL               },
+        { "4:2",          NULL               },
+        { "0-9999999",    NULL               },
+    };
+    int ret = 0;
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(tests); i++) {
+        char cpus[256] = "";
+        cpu_set_t set;
+        int err = parse_cpu_list(&set, tests[i].list);
+
+        for (int cpu = 0; !err && cpu < CPU_SETSIZE; cpu++)
+            if (CPU_ISSET(cpu, &set))
+                av_strlcatf(cpus, sizeof(cpus), "%s%d", *cpus ? " " : "", cpu);
+        if (tests[i].cpus ? err < 0 || strcmp(cpus, tests[i].cpus) : err != AVERROR(EINVAL)) {
+            fprintf(stderr, "parse_cpu_list(\"%s\"): got %s, expected %s\n", tests[i].list,
+                    err < 0 ? "error" : cpus, tests[i].cpus ? tests[i].cpus : "error");
+            ret = 1;
+        }
+    }
+    return ret;
+}
+#endif
 
 int main(int argc, char **argv)
 {
@@ -118,6 +170,11 @@ int main(int argc, char **argv)
     if (cpu_flags_raw < 0)
         return 1;
 
+#if HAVE_SCHED_GETAFFINITY && defined(CPU_SET)
+    if (test_parse_cpu_list())
+        return 5;
+#endif
+
     for (;;) {
         int c = getopt(argc, argv, "c:t:");
         if (c == -1)
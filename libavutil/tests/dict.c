@@ -158,5 +158,33 @@ int main(void)
     printf("%s\n", e->value);
     av_dict_free(&dict);
 
+    printf("\nTesting av_dict_get() on a large dictionary\n");
+    for (int i = 0; i < 40; i++) {
+        char key[16], val[16];
+        snprintf(key, sizeof(key), "key%d", i % 30);
+        snprintf(val, sizeof(val), "%d", i);
+        av_dict_set(&dict, key, val, 0);
+    }
+    av_dict_set(&dict, "KEY3", "upper", AV_DICT_MATCH_CASE);
+    av_dict_set(&dict, "key7", "multi", AV_DICT_MULTIKEY);
+    av_dict_set(&dict, "key11", NULL, 0);
+    av_dict_set(&dict, "Key12", "case", 0);
+    e = NULL;
+    while ((e = dict_iterate(dict, e)))
+        printf("%s %s\n", e->key, e->value);
+    e = NULL;
+    while ((e = av_dict_get(dict, "key7", e, 0)))
+        printf("get key7: %s\n", e->value);
+    e = NULL;
+    while ((e = av_dict_get(dict, "Key3", e, 0)))
+        printf("get Key3: %s\n", e->value);
+    e = av_dict_get(dict, "KEY3", NULL, AV_DICT_MATCH_CASE);
+    printf("get KEY3 match case: %s\n", e ? e->value : "(null)");
+    e = av_dict_get(dict, "Key3", NULL, AV_DICT_MATCH_CASE);
+    printf("get Key3 match case: %s\n", e ? e->value : "(null)");
+    e = av_dict_get(dict, "key11", NULL, 0);
+    printf("get key11: %s\n", e ? e->value : "(null)");
+    av_dict_free(&dict);
+
     return 0;
 }
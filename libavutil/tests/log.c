@@ -21,8 +21,27 @@
 
 #include "libavutil/log.c"
 
+#include <stddef.h>
 #include <string.h>
 
+typedef struct TestContext {
+    const AVClass *class;
+    void *parent;
+} TestContext;
+
+static const AVClass parent_class = {
+    .class_name = "parent",
+    .item_name  = av_default_item_name,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+static const AVClass child_class = {
+    .class_name                = "child",
+    .item_name                 = av_default_item_name,
+    .version                   = LIBAVUTIL_VERSION_INT,
+    .parent_log_context_offset = offsetof(TestContext, parent),
+};
+
 static int call_log_format_line2(const char *fmt, char *buffer, int buffer_size, ...)
 {
     va_list args;
@@ -34,6 +53,110 @@ static int call_log_format_line2(const char *fmt, char *buffer, int buffer_size,
     return ret;
 }
 
+static int call_format_record_json(void *avcl, AVBPrint *bp, const char *fmt, ...)
+{
+    LogRecord rec;
+    va_list args;
+    int print_prefix = 1;
+
+    va_start(args, fmt);
+    fill_record(&rec, avcl, AV_LOG_WARNING, 0, fmt, args, &print_prefix);
+    va_end(args);
+    return format_record_json(&rec, bp);
+}
+
+/* print a JSON line with the time and the addresses, which change from run
+ * to run, replaced by placeholders */
+static void print_json_line(const char *line)
+{
+    while (*line) {
+        if (!strncmp(line, "\"time\":", 7)) {
+            printf("\"time\":T");
+            for (line += 7; *line == '.' || (*line >= '0' && *line <= '9'); line++);
+        } else if (!strncmp(line, "_ptr\":\"", 7)) {
+            printf("_ptr\":\"P");
+            for (line += 7; *line && *line != '"'; line++);
+        } else {
+            putchar(*line++);
+        }
+    }
+}
+
+static int test_json(void)
+{
+    TestContext parent = { &parent_class };
+    TestContext child  = { &child_class, &parent };
+    char ptrs[64];
+    AVBPrint bp;
+    int ret = 0;
+
+    av_bprint_init(&bp, 0, AV_BPRINT_SIZE_AUTOMATIC);
+    if (call_format_record_json(&child, &bp, "%s", "\n") ||
+        !call_format_record_json(&child, &bp, "%d \"quoted\"\tand\\%c\n", 42, 1)) {
+        printf("Test JSON empty message failed.\n");
+        ret = 1;
+        goto end;
+    }
+    snprintf(ptrs, sizeof(ptrs), "\"parent_ptr\":\"%p\"", (void *)&parent);
+    if (!strstr(bp.str, ptrs) || bp.str[bp.len - 1] != '\n') {
+        printf("Test JSON line failed: %s", bp.str);
+        ret = 1;
+        goto end;
+    }
+    print_json_line(bp.str);
+
+end:
+    av_bprint_finalize(&bp, NULL);
+    return ret;
+}
+
+#if HAVE_THREADS
+#define ASYNC_THREADS  4
+#define ASYNC_MESSAGES 100
+
+static void *log_thread(void *arg)
+{
+    TestContext ctx = { &child_class };
+    int idx = (intptr_t)arg;
+
+    for (int i = 0; i < ASYNC_MESSAGES; i++)
+        av_log(&ctx, AV_LOG_DEBUG, "thread %d message %d\n", idx, i);
+    return NULL;
+}
+
+static int test_async(void)
+{
+    pthread_t threads[ASYNC_THREADS];
+    unsigned written, dropped;
+
+    av_log_set_flags(AV_LOG_ASYNC);
+    for (int i = 0; i < ASYNC_THREADS; i++) {
+        if (pthread_create(&threads[i], NULL, log_thread, (void *)(intptr_t)i)) {
+            printf("Test async thread creation failed.\n");
+            return 1;
+        }
+    }
+    for (int i = 0; i < ASYNC_THREADS; i++)
+        pthread_join(threads[i], NULL);
+    av_log_flush();
+
+    if (!atomic_load(&async_ok)) {
+        printf("Test async writer thread failed.\n");
+        return 1;
+    }
+    /* the queue is larger than the number of messages, so none is dropped */
+    written = atomic_load(&ring_head);
+    dropped = atomic_load(&nb_dropped);
+    av_log_set_flags(0);
+    if (atomic_load(&async_ok)) {
+        printf("Test async writer thread shutdown failed.\n");
+        return 1;
+    }
+    printf("async: %u messages written, %u dropped\n", written, dropped);
+    return written != ASYNC_THREADS * ASYNC_MESSAGES || dropped;
+}
+#endif
+
 int main(int argc, char **argv)
 {
     int i;
@@ -67,5 +190,11 @@ int main(int argc, char **argv)
             return 1;
         }
     }
+    if (test_json())
+        return 1;
+#if HAVE_THREADS
+    if (test_async())
+        return 1;
+#endif
     return 0;
 }
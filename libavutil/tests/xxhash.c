@@ -0,0 +1,84 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/mem.h"
+#include "libavutil/xxhash.h"
+
+/* all code paths: short, mid-size, partial and multiple blocks */
+static const size_t lengths[] = {
+    0, 1, 3, 4, 8, 9, 16, 17, 33, 65, 97, 128, 129, 200, 240, 241, 256, 257,
+    1023, 1024, 1025, 2048, 4100, 100003,
+};
+
+static const size_t chunk_sizes[] = { 1, 7, 63, 64, 255, 256, 300, 1500 };
+
+static void hash(struct AVXXH3 *ctx, const uint8_t *buf, size_t len,
+                 size_t chunk, uint8_t h64[8], uint8_t h128[16])
+{
+    av_xxh3_init(ctx);
+    for (size_t pos = 0; pos < len; pos += chunk)
+        av_xxh3_update(ctx, buf + pos, chunk < len - pos ? chunk : len - pos);
+    av_xxh3_final_64(ctx, h64);
+    av_xxh3_final_128(ctx, h128);
+}
+
+int main(void)
+{
+    struct AVXXH3 *ctx = av_xxh3_alloc();
+    uint8_t *buf = av_malloc(100003);
+    uint32_t state = 1;
+    int ret = 0;
+
+    if (!ctx || !buf)
+        return 1;
+    for (int i = 0; i < 100003; i++) {
+        state  = state * 1664525 + 1013904223;
+        buf[i] = state >> 24;
+    }
+
+    for (int i = 0; i < sizeof(lengths) / sizeof(*lengths); i++) {
+        size_t len = lengths[i];
+        uint8_t h64[8], h128[16];
+
+        hash(ctx, buf, len, len ? len : 1, h64, h128);
+        printf("%6zu ", len);
+        for (int j = 0; j < 8; j++)
+            printf("%02x", h64[j]);
+        printf(" ");
+        for (int j = 0; j < 16; j++)
+            printf("%02x", h128[j]);
+        printf("\n");
+
+        for (int j = 0; j < sizeof(chunk_sizes) / sizeof(*chunk_sizes); j++) {
+            uint8_t c64[8], c128[16];
+            hash(ctx, buf, len, chunk_sizes[j], c64, c128);
+            if (memcmp(h64, c64, 8) || memcmp(h128, c128, 16)) {
+                printf("mismatch for length %zu in chunks of %zu\n",
+                       len, chunk_sizes[j]);
+                ret = 1;
+            }
+        }
+    }
+
+    av_free(buf);
+    av_free(ctx);
+    return ret;
+}
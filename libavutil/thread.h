@@ -201,4 +201,19 @@ static inline int ff_thread_setname(const char *name)
     return AVERROR(ENOSYS);
 }
 
+/**
+ * Apply the CPU affinity described by spec (see av_cpu_set_thread_affinity())
+ * to the calling thread, saving the previous one to *saved. Threads created
+ * until avpriv_thread_affinity_pop() is called inherit the new affinity.
+ * Nothing is done if spec is NULL or empty.
+ *
+ * @return 0 on success, a negative error code on failure
+ */
+int avpriv_thread_affinity_push(const char *spec, void **saved);
+
+/**
+ * Restore the affinity saved by avpriv_thread_affinity_push() and free *saved.
+ */
+void avpriv_thread_affinity_pop(void **saved);
+
 #endif /* AVUTIL_THREAD_H */
@@ -0,0 +1,402 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * XXH3 hash function, as specified by the xxHash reference implementation
+ * (https://github.com/Cyan4973/xxHash), version 0.8.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bswap.h"
+#include "intreadwrite.h"
+#include "macros.h"
+#include "mem.h"
+#include "xxhash.h"
+
+#define PRIME32_1 0x9E3779B1U
+#define PRIME32_2 0x85EBCA77U
+#define PRIME32_3 0xC2B2AE3DU
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+#define PRIME_MX1 0x165667919E3779F9ULL
+#define PRIME_MX2 0x9FB21C651E98DF25ULL
+
+#define STRIPE_LEN         64
+#define SECRET_SIZE        192
+#define SECRET_LIMIT       (SECRET_SIZE - STRIPE_LEN)
+#define STRIPES_PER_BLOCK  (SECRET_LIMIT / 8)
+#define MIDSIZE_MAX        240
+#define BUFFER_SIZE        256
+
+static const uint8_t secret[SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+typedef struct AVXXH3 {
+    uint64_t acc[8];
+    uint8_t buffer[BUFFER_SIZE];
+    size_t buffered;
+    size_t nb_stripes;          ///< stripes accumulated in the current block
+    uint64_t total_len;
+} AVXXH3;
+
+typedef struct U128 {
+    uint64_t lo, hi;
+} U128;
+
+static U128 mul64to128(uint64_t a, uint64_t b)
+{
+    uint64_t lo_lo = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+    uint64_t hi_lo = (a >> 32)        * (b & 0xFFFFFFFF);
+    uint64_t lo_hi = (a & 0xFFFFFFFF) * (b >> 32);
+    uint64_t hi_hi = (a >> 32)        * (b >> 32);
+    uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+
+    return (U128){ (cross << 32) | (lo_lo & 0xFFFFFFFF),
+                   (hi_lo >> 32) + (cross >> 32) + hi_hi };
+}
+
+static uint64_t mul128_fold64(uint64_t a, uint64_t b)
+{
+    U128 p = mul64to128(a, b);
+    return p.lo ^ p.hi;
+}
+
+static uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t xxh64_avalanche(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static uint64_t avalanche(uint64_t h)
+{
+    h ^= h >> 37;
+    h *= PRIME_MX1;
+    h ^= h >> 32;
+    return h;
+}
+
+static uint64_t rrmxmx(uint64_t h, uint64_t len)
+{
+    h ^= rotl64(h, 49) ^ rotl64(h, 24);
+    h *= PRIME_MX2;
+    h ^= (h >> 35) + len;
+    h *= PRIME_MX2;
+    h ^= h >> 28;
+    return h;
+}
+
+static uint64_t mix16(const uint8_t *in, const uint8_t *key)
+{
+    return mul128_fold64(AV_RL64(in)     ^ AV_RL64(key),
+                         AV_RL64(in + 8) ^ AV_RL64(key + 8));
+}
+
+static void mix32(U128 *acc, const uint8_t *in1, const uint8_t *in2,
+                  const uint8_t *key)
+{
+    acc->lo += mix16(in1, key);
+    acc->lo ^= AV_RL64(in2) + AV_RL64(in2 + 8);
+    acc->hi += mix16(in2, key + 16);
+    acc->hi ^= AV_RL64(in1) + AV_RL64(in1 + 8);
+}
+
+static uint64_t hash64_short(const uint8_t *in, size_t len)
+{
+    if (len > 8) {
+        uint64_t lo = AV_RL64(in)           ^ (AV_RL64(secret + 24) ^ AV_RL64(secret + 32));
+        uint64_t hi = AV_RL64(in + len - 8) ^ (AV_RL64(secret + 40) ^ AV_RL64(secret + 48));
+        return avalanche(len + av_bswap64(lo) + hi + mul128_fold64(lo, hi));
+    } else if (len >= 4) {
+        uint64_t v = AV_RL32(in + len - 4) + ((uint64_t)AV_RL32(in) << 32);
+        return rrmxmx(v ^ (AV_RL64(secret + 8) ^ AV_RL64(secret + 16)), len);
+    } else if (len) {
+        uint32_t v = (in[0] << 16) | (in[len >> 1] << 24) | in[len - 1] | (len << 8);
+        return xxh64_avalanche(v ^ (uint64_t)(AV_RL32(secret) ^ AV_RL32(secret + 4)));
+    }
+    return xxh64_avalanche(AV_RL64(secret + 56) ^ AV_RL64(secret + 64));
+}
+
+static uint64_t hash64_mid(const uint8_t *in, size_t len)
+{
+    uint64_t acc = len * PRIME64_1;
+
+    if (len <= 128) {
+        for (int i = (len - 1) / 32; i >= 0; i--) {
+            acc += mix16(in + 16 * i,            secret + 32 * i);
+            acc += mix16(in + len - 16 * (i + 1), secret + 32 * i + 16);
+        }
+        return avalanche(acc);
+    }
+
+    for (int i = 0; i < 8; i++)
+        acc += mix16(in + 16 * i, secret + 16 * i);
+    acc = avalanche(acc);
+    for (int i = 8; i < len / 16; i++)
+        acc += mix16(in + 16 * i, secret + 16 * (i - 8) + 3);
+    acc += mix16(in + len - 16, secret + 136 - 17);
+    return avalanche(acc);
+}
+
+static U128 hash128_short(const uint8_t *in, size_t len)
+{
+    U128 h;
+
+    if (len > 8) {
+        uint64_t lo = AV_RL64(in), hi = AV_RL64(in + len - 8);
+        U128 m = mul64to128(lo ^ hi ^ (AV_RL64(secret + 32) ^ AV_RL64(secret + 40)),
+                            PRIME64_1);
+        m.lo += (uint64_t)(len - 1) << 54;
+        hi   ^= AV_RL64(secret + 48) ^ AV_RL64(secret + 56);
+        m.hi += hi + (uint32_t)hi * (uint64_t)(PRIME32_2 - 1);
+        m.lo ^= av_bswap64(m.hi);
+        h     = mul64to128(m.lo, PRIME64_2);
+        h.hi += m.hi * PRIME64_2;
+        h.lo  = avalanche(h.lo);
+        h.hi  = avalanche(h.hi);
+    } else if (len >= 4) {
+        uint64_t v = AV_RL32(in) + ((uint64_t)AV_RL32(in + len - 4) << 32);
+        h     = mul64to128(v ^ (AV_RL64(secret + 16) ^ AV_RL64(secret + 24)),
+                           PRIME64_1 + (len << 2));
+        h.hi += h.lo << 1;
+        h.lo ^= h.hi >> 3;
+        h.lo ^= h.lo >> 35;
+        h.lo *= PRIME_MX2;
+        h.lo ^= h.lo >> 28;
+        h.hi  = avalanche(h.hi);
+    } else if (len) {
+        uint32_t lo = (in[0] << 16) | (in[len >> 1] << 24) | in[len - 1] | (len << 8);
+        uint32_t hi = av_bswap32(lo);
+        hi   = (hi << 13) | (hi >> 19);
+        h.lo = xxh64_avalanche(lo ^ (uint64_t)(AV_RL32(secret)     ^ AV_RL32(secret + 4)));
+        h.hi = xxh64_avalanche(hi ^ (uint64_t)(AV_RL32(secret + 8) ^ AV_RL32(secret + 12)));
+    } else {
+        h.lo = xxh64_avalanche(AV_RL64(secret + 64) ^ AV_RL64(secret + 72));
+        h.hi = xxh64_avalanche(AV_RL64(secret + 80) ^ AV_RL64(secret + 88));
+    }
+    return h;
+}
+
+static U128 hash128_mid(const uint8_t *in, size_t len)
+{
+    U128 acc = { len * PRIME64_1, 0 }, h;
+
+    if (len <= 128) {
+        for (int i = (len - 1) / 32; i >= 0; i--)
+            mix32(&acc, in + 16 * i, in + len - 16 * (i + 1), secret + 32 * i);
+    } else {
+        for (int i = 0; i < 4; i++)
+            mix32(&acc, in + 32 * i, in + 32 * i + 16, secret + 32 * i);
+        acc.lo = avalanche(acc.lo);
+        acc.hi = avalanche(acc.hi);
+        for (int i = 4; i < len / 32; i++)
+            mix32(&acc, in + 32 * i, in + 32 * i + 16, secret + 32 * (i - 4) + 3);
+        mix32(&acc, in + len - 16, in + len - 32, secret + 136 - 17 - 16);
+    }
+
+    h.lo = avalanche(acc.lo + acc.hi);
+    h.hi = -avalanche(acc.lo * PRIME64_1 + acc.hi * PRIME64_4 + len * PRIME64_2);
+    return h;
+}
+
+static uint64_t merge_accs(const uint64_t *acc, const uint8_t *key, uint64_t start)
+{
+    for (int i = 0; i < 4; i++)
+        start += mul128_fold64(acc[2 * i]     ^ AV_RL64(key + 16 * i),
+                               acc[2 * i + 1] ^ AV_RL64(key + 16 * i + 8));
+    return avalanche(start);
+}
+
+/* Accumulate nb_stripes consecutive stripes, the key advancing by 8 bytes
+ * per stripe. */
+static void accumulate(uint64_t acc[8], const uint8_t *in,
+                       const uint8_t *key, size_t nb_stripes)
+{
+    for (; nb_stripes; nb_stripes--, in += STRIPE_LEN, key += 8) {
+        for (int i = 0; i < 8; i++) {
+            uint64_t v = AV_RL64(in + 8 * i);
+            uint64_t k = v ^ AV_RL64(key + 8 * i);
+            acc[i ^ 1] += v;
+            acc[i]     += (uint32_t)k * (k >> 32);
+        }
+    }
+}
+
+static void scramble(uint64_t acc[8], const uint8_t *key)
+{
+    for (int i = 0; i < 8; i++) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= AV_RL64(key + 8 * i);
+        acc[i] = a * PRIME32_1;
+    }
+}
+
+/* Accumulate stripes, scrambling after each full block. */
+static void consume_stripes(uint64_t acc[8], size_t *stripes_in_block,
+                            const uint8_t *in, size_t nb_stripes)
+{
+    while (nb_stripes) {
+        size_t n = FFMIN(nb_stripes, STRIPES_PER_BLOCK - *stripes_in_block);
+
+        accumulate(acc, in, secret + 8 * *stripes_in_block, n);
+        in                += n * STRIPE_LEN;
+        nb_stripes        -= n;
+        *stripes_in_block += n;
+        if (*stripes_in_block == STRIPES_PER_BLOCK) {
+            scramble(acc, secret + SECRET_LIMIT);
+            *stripes_in_block = 0;
+        }
+    }
+}
+
+struct AVXXH3 *av_xxh3_alloc(void)
+{
+    return av_mallocz(sizeof(struct AVXXH3));
+}
+
+void av_xxh3_init(AVXXH3 *c)
+{
+    static const uint64_t acc_init[8] = {
+        PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3,
+        PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1,
+    };
+
+    memcpy(c->acc, acc_init, sizeof(c->acc));
+    c->buffered   = 0;
+    c->nb_stripes = 0;
+    c->total_len  = 0;
+}
+
+void av_xxh3_update(AVXXH3 *c, const uint8_t *src, size_t len)
+{
+    c->total_len += len;
+
+    if (len <= BUFFER_SIZE - c->buffered) {
+        memcpy(c->buffer + c->buffered, src, len);
+        c->buffered += len;
+        return;
+    }
+
+    /* Stripes are only consumed once more input follows them, as the last
+     * stripe of the input is processed differently. */
+    if (c->buffered) {
+        size_t fill = BUFFER_SIZE - c->buffered;
+        memcpy(c->buffer + c->buffered, src, fill);
+        src += fill;
+        len -= fill;
+        consume_stripes(c->acc, &c->nb_stripes, c->buffer,
+                        BUFFER_SIZE / STRIPE_LEN);
+        c->buffered = 0;
+    }
+
+    if (len > BUFFER_SIZE) {
+        size_t nb_stripes = (len - 1) / STRIPE_LEN;
+        consume_stripes(c->acc, &c->nb_stripes, src, nb_stripes);
+        src += nb_stripes * STRIPE_LEN;
+        len -= nb_stripes * STRIPE_LEN;
+        /* keep the last consumed stripe around for final_long() */
+        memcpy(c->buffer + BUFFER_SIZE - STRIPE_LEN,
+               src - STRIPE_LEN, STRIPE_LEN);
+    }
+
+    memcpy(c->buffer, src, len);
+    c->buffered = len;
+}
+
+static void final_long(const AVXXH3 *c, uint64_t acc[8])
+{
+    size_t stripes_in_block = c->nb_stripes;
+    uint8_t last[STRIPE_LEN];
+    const uint8_t *last_stripe;
+
+    memcpy(acc, c->acc, sizeof(c->acc));
+    if (c->buffered >= STRIPE_LEN) {
+        consume_stripes(acc, &stripes_in_block, c->buffer,
+                        (c->buffered - 1) / STRIPE_LEN);
+        last_stripe = c->buffer + c->buffered - STRIPE_LEN;
+    } else {
+        size_t catchup = STRIPE_LEN - c->buffered;
+        memcpy(last, c->buffer + BUFFER_SIZE - catchup, catchup);
+        memcpy(last + catchup, c->buffer, c->buffered);
+        last_stripe = last;
+    }
+    accumulate(acc, last_stripe, secret + SECRET_LIMIT - 7, 1);
+}
+
+void av_xxh3_final_64(AVXXH3 *c, uint8_t dst[8])
+{
+    uint64_t h;
+
+    if (c->total_len > MIDSIZE_MAX) {
+        uint64_t acc[8];
+        final_long(c, acc);
+        h = merge_accs(acc, secret + 11, c->total_len * PRIME64_1);
+    } else if (c->total_len > 16) {
+        h = hash64_mid(c->buffer, c->total_len);
+    } else {
+        h = hash64_short(c->buffer, c->total_len);
+    }
+    AV_WB64(dst, h);
+}
+
+void av_xxh3_final_128(AVXXH3 *c, uint8_t dst[16])
+{
+    U128 h;
+
+    if (c->total_len > MIDSIZE_MAX) {
+        uint64_t acc[8];
+        final_long(c, acc);
+        h.lo = merge_accs(acc, secret + 11, c->total_len * PRIME64_1);
+        h.hi = merge_accs(acc, secret + SECRET_SIZE - STRIPE_LEN - 11,
+                          ~(c->total_len * PRIME64_2));
+    } else if (c->total_len > 16) {
+        h = hash128_mid(c->buffer, c->total_len);
+    } else {
+        h = hash128_short(c->buffer, c->total_len);
+    }
+    AV_WB64(dst,     h.hi);
+    AV_WB64(dst + 8, h.lo);
+}
@@ -0,0 +1,84 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * @ingroup lavu_xxh3
+ * Public header for the XXH3 hash function implementation.
+ */
+
+#ifndef AVUTIL_XXHASH_H
+#define AVUTIL_XXHASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @defgroup lavu_xxh3 XXH3
+ * @ingroup lavu_hash
+ * XXH3 hash function implementation.
+ *
+ * XXH3 is a fast non-cryptographic hash function from the xxHash family,
+ * with 64-bit and 128-bit output variants. Only the default, unseeded
+ * variants are implemented. Digests are output in the canonical
+ * (big-endian) representation, as printed by xxhsum.
+ *
+ * @{
+ */
+
+/**
+ * Allocate an AVXXH3 hash context.
+ * @return Uninitialized hash context or `NULL` in case of error
+ */
+struct AVXXH3 *av_xxh3_alloc(void);
+
+/**
+ * Initialize or reinitialize an AVXXH3 hash context.
+ * @param[out] c Hash context
+ */
+void av_xxh3_init(struct AVXXH3 *c);
+
+/**
+ * Update hash context with new data.
+ * @param[out] c    Hash context
+ * @param[in]  src  Input data to update hash with
+ * @param[in]  len  Number of bytes to read from `src`
+ */
+void av_xxh3_update(struct AVXXH3 *c, const uint8_t *src, size_t len);
+
+/**
+ * Finish hashing and output the 64-bit digest value.
+ * The context can be updated further after this call.
+ * @param[in]  c    Hash context
+ * @param[out] dst  Buffer where output digest value is stored
+ */
+void av_xxh3_final_64(struct AVXXH3 *c, uint8_t dst[8]);
+
+/**
+ * Finish hashing and output the 128-bit digest value.
+ * The context can be updated further after this call.
+ * @param[in]  c    Hash context
+ * @param[out] dst  Buffer where output digest value is stored
+ */
+void av_xxh3_final_128(struct AVXXH3 *c, uint8_t dst[16]);
+
+/**
+ * @}
+ */
+
+#endif /* AVUTIL_XXHASH_H */
@@ -281,13 +281,63 @@ static void resample_free(ResampleContext **cc){
     ResampleContext *c = *cc;
     if(!c)
         return;
+    avpriv_slicethread_free(&c->slicethread);
     av_freep(&c->filter_bank);
     av_freep(cc);
 }
 
+static void resample_worker(void *priv, int jobnr, int threadnr,
+                            int nb_jobs, int nb_threads)
+{
+    ResampleContext *c = priv;
+    int ch_count = c->job.dst->ch_count;
+    int start = (ch_count *  jobnr     ) / nb_jobs;
+    int end   = (ch_count * (jobnr + 1)) / nb_jobs;
+    int i;
+
+    for (i = start; i < end; i++)
+        c->job.resample_func(c, c->job.dst->ch[i], c->job.src->ch[i], c->job.n, 0);
+}
+
+/**
+ * Advance index and frac by n output samples, as resample_common() and
+ * resample_linear() do when update_ctx is set, and return the number of
+ * consumed input samples.
+ */
+static int advance_index(ResampleContext *c, int n)
+{
+    int index = c->index;
+    int frac  = c->frac;
+    int sample_index = 0;
+
+    while (index >= c->phase_count) {
+        sample_index++;
+        index -= c->phase_count;
+    }
+
+    while (n--) {
+        frac  += c->dst_incr_mod;
+        index += c->dst_incr_div;
+        if (frac >= c->src_incr) {
+            frac -= c->src_incr;
+            index++;
+        }
+
+        while (index >= c->phase_count) {
+            sample_index++;
+            index -= c->phase_count;
+        }
+    }
+
+    c->frac  = frac;
+    c->index = index;
+
+    return sample_index;
+}
+
 static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_rate, int filter_size, int phase_shift, int linear,
                                     double cutoff0, enum AVSampleFormat format, enum SwrFilterType filter_type, double kaiser_beta,
-                                    double precision, int cheby, int exact_rational)
+                                    double precision, int cheby, int exact_rational, int nb_threads)
 {
     double cutoff = cutoff0? cutoff0 : 0.97;
     double factor= FFMIN(out_rate * cutoff / in_rate, 1.0);
@@ -374,8 +424,20 @@ static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_r
 
     swri_resample_dsp_init(c);
 
+    avpriv_slicethread_free(&c->slicethread);
+    c->nb_threads = 1;
+    if (nb_threads != 1) {
+        int ret = avpriv_slicethread_create(&c->slicethread, c, resample_worker,
+                                            NULL, nb_threads);
+        if (ret > 1)
+            c->nb_threads = ret;
+        else
+            avpriv_slicethread_free(&c->slicethread);
+    }
+
     return c;
 error:
+    avpriv_slicethread_free(&c->slicethread);
     av_freep(&c->filter_bank);
     av_free(c);
     return NULL;
@@ -492,8 +554,21 @@ static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, A
              * when frac and dst_incr_mod are zero */
             resample_func = (c->linear && (c->frac || c->dst_incr_mod)) ?
                             c->dsp.resample_linear : c->dsp.resample_common;
-            for (i = 0; i < dst->ch_count; i++)
-                *consumed = resample_func(c, dst->ch[i], src->ch[i], dst_size, i+1 == dst->ch_count);
+            if (c->slicethread && dst->ch_count > 1) {
+                /* All channels only read the context, so they can be
+                 * resampled concurrently; the position is advanced once
+                 * they are done. */
+                c->job.dst           = dst;
+                c->job.src           = src;
+                c->job.n             = dst_size;
+                c->job.resample_func = resample_func;
+                avpriv_slicethread_execute(c->slicethread,
+                                           FFMIN(dst->ch_count, c->nb_threads), 0);
+                *consumed = advance_index(c, dst_size);
+            } else {
+                for (i = 0; i < dst->ch_count; i++)
+                    *consumed = resample_func(c, dst->ch[i], src->ch[i], dst_size, i+1 == dst->ch_count);
+            }
         }
     }
 
@@ -24,6 +24,7 @@
 
 #include "libavutil/log.h"
 #include "libavutil/samplefmt.h"
+#include "libavutil/slicethread.h"
 
 #include "swresample_internal.h"
 
@@ -50,6 +51,16 @@ typedef struct ResampleContext {
     int filter_shift;
     int phase_count_compensation;      /* desired phase_count when compensation is enabled */
 
+    AVSliceThread *slicethread;
+    int nb_threads;
+    struct {
+        AudioData *dst;
+        AudioData *src;
+        int n;
+        int (*resample_func)(struct ResampleContext *c, void *dst,
+                             const void *src, int n, int update_ctx);
+    } job;
+
     struct {
         void (*resample_one)(void *dst, const void *src,
                              int n, int64_t index, int64_t incr);
@@ -139,6 +139,28 @@ extern void (*deinterleaveBytes)(const uint8_t *src, uint8_t *dst1, uint8_t *dst
                                  int width, int height, int srcStride,
                                  int dst1Stride, int dst2Stride);
 
+/**
+ * Native-endian 16-bit counterparts of interleaveBytes() and
+ * deinterleaveBytes(), used for the P01x semi-planar formats.
+ * width is in samples per plane, strides are in bytes.
+ * interleaveWords() shifts every sample left by shift bits,
+ * deinterleaveWords() shifts every sample right by shift bits.
+ */
+extern void (*interleaveWords)(const uint8_t *src1, const uint8_t *src2, uint8_t *dst,
+                               int width, int height, int src1Stride,
+                               int src2Stride, int dstStride, int shift);
+
+extern void (*deinterleaveWords)(const uint8_t *src, uint8_t *dst1, uint8_t *dst2,
+                                 int width, int height, int srcStride,
+                                 int dst1Stride, int dst2Stride, int shift);
+
+/**
+ * Copy a plane of native-endian 16-bit samples, shifting them left by shift
+ * bits if shift is positive and right by -shift bits if it is negative.
+ */
+extern void (*shiftWords)(const uint8_t *src, uint8_t *dst, int width, int height,
+                          int srcStride, int dstStride, int shift);
+
 extern void (*vu9_to_vu12)(const uint8_t *src1, const uint8_t *src2,
                            uint8_t *dst1, uint8_t *dst2,
                            int width, int height,
@@ -221,17 +221,14 @@ static int nv24ToPlanarWrapper(SwsContext *c, const uint8_t *src[],
     return srcSliceH;
 }
 
-static int planarToP01xWrapper(SwsContext *c, const uint8_t *src8[],
+static int planarToP01xWrapper(SwsContext *c, const uint8_t *src[],
                                int srcStride[], int srcSliceY,
-                               int srcSliceH, uint8_t *dstParam8[],
+                               int srcSliceH, uint8_t *dstParam[],
                                int dstStride[])
 {
     const AVPixFmtDescriptor *src_format = av_pix_fmt_desc_get(c->srcFormat);
     const AVPixFmtDescriptor *dst_format = av_pix_fmt_desc_get(c->dstFormat);
-    const uint16_t **src = (const uint16_t**)src8;
-    uint16_t *dstY = (uint16_t*)(dstParam8[0] + dstStride[0] * srcSliceY);
-    uint16_t *dstUV = (uint16_t*)(dstParam8[1] + dstStride[1] * srcSliceY / 2);
-    int x, y;
+    uint8_t *dstUV = dstParam[1] + dstStride[1] * srcSliceY / 2;
 
     /* Calculate net shift required for values. */
     const int shift[3] = {
@@ -245,29 +242,39 @@ static int planarToP01xWrapper(SwsContext *c, const uint8_t *src8[],
 
     av_assert0(!(srcStride[0] % 2 || srcStride[1] % 2 || srcStride[2] % 2 ||
                  dstStride[0] % 2 || dstStride[1] % 2));
+    av_assert1(shift[1] == shift[2]);
 
-    for (y = 0; y < srcSliceH; y++) {
-        uint16_t *tdstY = dstY;
-        const uint16_t *tsrc0 = src[0];
-        for (x = c->srcW; x > 0; x--) {
-            *tdstY++ = *tsrc0++ << shift[0];
-        }
-        src[0] += srcStride[0] / 2;
-        dstY += dstStride[0] / 2;
+    shiftWords(src[0], dstParam[0] + dstStride[0] * srcSliceY, c->srcW, srcSliceH,
+               srcStride[0], dstStride[0], shift[0]);
+    interleaveWords(src[1], src[2], dstUV, c->chrSrcW, (srcSliceH + 1) / 2,
+                    srcStride[1], srcStride[2], dstStride[1], shift[1]);
 
-        if (!(y & 1)) {
-            uint16_t *tdstUV = dstUV;
-            const uint16_t *tsrc1 = src[1];
-            const uint16_t *tsrc2 = src[2];
-            for (x = c->srcW / 2; x > 0; x--) {
-                *tdstUV++ = *tsrc1++ << shift[1];
-                *tdstUV++ = *tsrc2++ << shift[2];
-            }
-            src[1] += srcStride[1] / 2;
-            src[2] += srcStride[2] / 2;
-            dstUV += dstStride[1] / 2;
-        }
-    }
+    return srcSliceH;
+}
+
+static int p01xToPlanarWrapper(SwsContext *c, const uint8_t *src[],
+                               int srcStride[], int srcSliceY,
+                               int srcSliceH, uint8_t *dstParam[],
+                               int dstStride[])
+{
+    const AVPixFmtDescriptor *src_format = av_pix_fmt_desc_get(c->srcFormat);
+    uint8_t *dstU = dstParam[1] + dstStride[1] * srcSliceY / 2;
+    uint8_t *dstV = dstParam[2] + dstStride[2] * srcSliceY / 2;
+    /* Only conversions between equal depths are dispatched here, so the
+     * samples only need to be moved down from the MSBs. */
+    const int shift = src_format->comp[0].shift;
+
+    av_assert0(!(srcStride[0] % 2 || srcStride[1] % 2 ||
+                 dstStride[0] % 2 || dstStride[1] % 2 || dstStride[2] % 2));
+
+    if (shift)
+        shiftWords(src[0], dstParam[0] + dstStride[0] * srcSliceY, c->srcW,
+                   srcSliceH, srcStride[0], dstStride[0], -shift);
+    else
+        copyPlane(src[0], srcStride[0], srcSliceY, srcSliceH, 2 * c->srcW,
+                  dstParam[0], dstStride[0]);
+    deinterleaveWords(src[1], dstU, dstV, c->chrSrcW, (srcSliceH + 1) / 2,
+                      srcStride[1], dstStride[1], dstStride[2], shift);
 
     return srcSliceH;
 }
@@ -433,6 +440,67 @@ static int uyvyToYuv422Wrapper(SwsContext *c, const uint8_t *src[],
     return srcSliceH;
 }
 
+static int yuv422p16ToY2xxWrapper(SwsContext *c, const uint8_t *src[],
+                                  int srcStride[], int srcSliceY, int srcSliceH,
+                                  uint8_t *dstParam[], int dstStride[])
+{
+    const AVPixFmtDescriptor *dst_format = av_pix_fmt_desc_get(c->dstFormat);
+    const int shift = dst_format->comp[0].shift;
+    uint8_t *dst = dstParam[0] + dstStride[0] * srcSliceY;
+    int x, y;
+
+    for (y = 0; y < srcSliceH; y++) {
+        const uint16_t *ysrc = (const uint16_t *)(src[0] + srcStride[0] * y);
+        const uint16_t *usrc = (const uint16_t *)(src[1] + srcStride[1] * y);
+        const uint16_t *vsrc = (const uint16_t *)(src[2] + srcStride[2] * y);
+        uint16_t *d = (uint16_t *)(dst + dstStride[0] * y);
+
+        for (x = 0; x < c->srcW - 1; x += 2) {
+            d[2 * x + 0] = ysrc[x    ] << shift;
+            d[2 * x + 1] = usrc[x / 2] << shift;
+            d[2 * x + 2] = ysrc[x + 1] << shift;
+            d[2 * x + 3] = vsrc[x / 2] << shift;
+        }
+        if (c->srcW & 1) {
+            d[2 * x + 0] = d[2 * x + 2] = ysrc[x] << shift;
+            d[2 * x + 1] = usrc[x / 2] << shift;
+            d[2 * x + 3] = vsrc[x / 2] << shift;
+        }
+    }
+
+    return srcSliceH;
+}
+
+static int y2xxToYuv422p16Wrapper(SwsContext *c, const uint8_t *src[],
+                                  int srcStride[], int srcSliceY, int srcSliceH,
+                                  uint8_t *dstParam[], int dstStride[])
+{
+    const AVPixFmtDescriptor *src_format = av_pix_fmt_desc_get(c->srcFormat);
+    const int shift = src_format->comp[0].shift;
+    int x, y;
+
+    for (y = 0; y < srcSliceH; y++) {
+        const uint16_t *s = (const uint16_t *)(src[0] + srcStride[0] * y);
+        uint16_t *ydst = (uint16_t *)(dstParam[0] + dstStride[0] * (srcSliceY + y));
+        uint16_t *udst = (uint16_t *)(dstParam[1] + dstStride[1] * (srcSliceY + y));
+        uint16_t *vdst = (uint16_t *)(dstParam[2] + dstStride[2] * (srcSliceY + y));
+
+        for (x = 0; x < c->srcW - 1; x += 2) {
+            ydst[x    ] = s[2 * x + 0] >> shift;
+            udst[x / 2] = s[2 * x + 1] >> shift;
+            ydst[x + 1] = s[2 * x + 2] >> shift;
+            vdst[x / 2] = s[2 * x + 3] >> shift;
+        }
+        if (c->srcW & 1) {
+            ydst[x    ] = s[2 * x + 0] >> shift;
+            udst[x / 2] = s[2 * x + 1] >> shift;
+            vdst[x / 2] = s[2 * x + 3] >> shift;
+        }
+    }
+
+    return srcSliceH;
+}
+
 static void gray8aToPacked32(const uint8_t *src, uint8_t *dst, int num_pixels,
                              const uint8_t *palette)
 {
@@ -699,6 +767,35 @@ static void packed16togbra16(const uint8_t *src, int srcStride,
     }
 }
 
+static void packed30togbra10(const uint8_t *src, int srcStride,
+                             uint16_t *dst[], int dstStride[], int srcSliceH,
+                             int swap, int width)
+{
+    int x, h, i;
+    int dst_alpha = dst[3] != NULL;
+    for (h = 0; h < srcSliceH; h++) {
+        const uint8_t *src_line = src + srcStride * h;
+        for (x = 0; x < width; x++) {
+            unsigned p = AV_RL32(src_line + 4 * x);
+            unsigned C0 = p >> 20 & 0x3FF;
+            unsigned C1 = p >> 10 & 0x3FF;
+            unsigned C2 = p       & 0x3FF;
+            if (swap & 2) {
+                C0 = av_bswap16(C0);
+                C1 = av_bswap16(C1);
+                C2 = av_bswap16(C2);
+            }
+            dst[0][x] = C0;
+            dst[1][x] = C1;
+            dst[2][x] = C2;
+            if (dst_alpha)
+                dst[3][x] = swap & 2 ? 0xFF03 : 0x3FF;
+        }
+        for (i = 0; i < 3 + dst_alpha; i++)
+            dst[i] += dstStride[i] >> 1;
+    }
+}
+
 static int Rgb16ToPlanarRgb16Wrapper(SwsContext *c, const uint8_t *src[],
                                      int srcStride[], int srcSliceY, int srcSliceH,
                                      uint8_t *dst[], int dstStride[])
@@ -750,6 +847,14 @@ static int Rgb16ToPlanarRgb16Wrapper(SwsContext *c, const uint8_t *src[],
                          dst1023, stride1023, srcSliceH, alpha, swap,
                          16 - bpc, c->srcW);
         break;
+    case AV_PIX_FMT_X2RGB10LE:
+        packed30togbra10(src[0], srcStride[0],
+                         dst2013, stride2013, srcSliceH, swap, c->srcW);
+        break;
+    case AV_PIX_FMT_X2BGR10LE:
+        packed30togbra10(src[0], srcStride[0],
+                         dst1023, stride1023, srcSliceH, swap, c->srcW);
+        break;
     default:
         av_log(c, AV_LOG_ERROR,
                "unsupported conversion to planar RGB %s -> %s\n",
@@ -878,6 +983,34 @@ static void gbr16ptopacked16(const uint16_t *src[], int srcStride[],
     }
 }
 
+static void gbr16ptopacked30(const uint16_t *src[], int srcStride[],
+                             uint8_t *dst, int dstStride, int srcSliceH,
+                             int swap, int width)
+{
+    int x, h, i;
+    for (h = 0; h < srcSliceH; h++) {
+        uint8_t *dest = dst + dstStride * h;
+
+        if (swap & 1) {
+            for (x = 0; x < width; x++) {
+                unsigned C0 = av_bswap16(src[0][x]) & 0x3FF;
+                unsigned C1 = av_bswap16(src[1][x]) & 0x3FF;
+                unsigned C2 = av_bswap16(src[2][x]) & 0x3FF;
+                AV_WL32(dest + 4 * x, (3U << 30) + (C0 << 20) + (C1 << 10) + C2);
+            }
+        } else {
+            for (x = 0; x < width; x++) {
+                unsigned C0 = src[0][x] & 0x3FF;
+                unsigned C1 = src[1][x] & 0x3FF;
+                unsigned C2 = src[2][x] & 0x3FF;
+                AV_WL32(dest + 4 * x, (3U << 30) + (C0 << 20) + (C1 << 10) + C2);
+            }
+        }
+        for (i = 0; i < 3; i++)
+            src[i] += srcStride[i] >> 1;
+    }
+}
+
 static int planarRgb16ToRgb16Wrapper(SwsContext *c, const uint8_t *src[],
                                      int srcStride[], int srcSliceY, int srcSliceH,
                                      uint8_t *dst[], int dstStride[])
@@ -929,6 +1062,16 @@ static int planarRgb16ToRgb16Wrapper(SwsContext *c, const uint8_t *src[],
                          dst[0] + srcSliceY * dstStride[0], dstStride[0],
                          srcSliceH, 1, swap, bits_per_sample, c->srcW);
         break;
+    case AV_PIX_FMT_X2RGB10LE:
+        gbr16ptopacked30(src201, stride201,
+                         dst[0] + srcSliceY * dstStride[0], dstStride[0],
+                         srcSliceH, swap, c->srcW);
+        break;
+    case AV_PIX_FMT_X2BGR10LE:
+        gbr16ptopacked30(src102, stride102,
+                         dst[0] + srcSliceY * dstStride[0], dstStride[0],
+                         srcSliceH, swap, c->srcW);
+        break;
     default:
         av_log(c, AV_LOG_ERROR,
                "unsupported planar RGB conversion %s -> %s\n",
@@ -2019,6 +2162,22 @@ void ff_get_unscaled_swscale(SwsContext *c)
         (dstFormat == AV_PIX_FMT_P010 || dstFormat == AV_PIX_FMT_P016)) {
         c->convert_unscaled = planarToP01xWrapper;
     }
+    /* p01x_to_yuv420p1x */
+    if ((srcFormat == AV_PIX_FMT_P010 && dstFormat == AV_PIX_FMT_YUV420P10) ||
+        (srcFormat == AV_PIX_FMT_P012 && dstFormat == AV_PIX_FMT_YUV420P12) ||
+        (srcFormat == AV_PIX_FMT_P016 && dstFormat == AV_PIX_FMT_YUV420P16)) {
+        c->convert_unscaled = p01xToPlanarWrapper;
+    }
+    /* yuv422p1x_to_y2xx */
+    if ((srcFormat == AV_PIX_FMT_YUV422P10 && dstFormat == AV_PIX_FMT_Y210) ||
+        (srcFormat == AV_PIX_FMT_YUV422P12 && dstFormat == AV_PIX_FMT_Y212)) {
+        c->convert_unscaled = yuv422p16ToY2xxWrapper;
+    }
+    /* y2xx_to_yuv422p1x */
+    if ((srcFormat == AV_PIX_FMT_Y210 && dstFormat == AV_PIX_FMT_YUV422P10) ||
+        (srcFormat == AV_PIX_FMT_Y212 && dstFormat == AV_PIX_FMT_YUV422P12)) {
+        c->convert_unscaled = y2xxToYuv422p16Wrapper;
+    }
     /* yuv420p_to_p01xle */
     if ((srcFormat == AV_PIX_FMT_YUV420P || srcFormat == AV_PIX_FMT_YUVA420P) &&
         (dstFormat == AV_PIX_FMT_P010LE || dstFormat == AV_PIX_FMT_P016LE)) {
@@ -2090,6 +2249,16 @@ void ff_get_unscaled_swscale(SwsContext *c)
          dstFormat == AV_PIX_FMT_BGRA64LE || dstFormat == AV_PIX_FMT_BGRA64BE))
         c->convert_unscaled = planarRgb16ToRgb16Wrapper;
 
+    if ((srcFormat == AV_PIX_FMT_X2RGB10LE || srcFormat == AV_PIX_FMT_X2BGR10LE) &&
+        (dstFormat == AV_PIX_FMT_GBRP10LE  || dstFormat == AV_PIX_FMT_GBRP10BE  ||
+         dstFormat == AV_PIX_FMT_GBRAP10LE || dstFormat == AV_PIX_FMT_GBRAP10BE))
+        c->convert_unscaled = Rgb16ToPlanarRgb16Wrapper;
+
+    if ((srcFormat == AV_PIX_FMT_GBRP10LE  || srcFormat == AV_PIX_FMT_GBRP10BE  ||
+         srcFormat == AV_PIX_FMT_GBRAP10LE || srcFormat == AV_PIX_FMT_GBRAP10BE) &&
+        (dstFormat == AV_PIX_FMT_X2RGB10LE || dstFormat == AV_PIX_FMT_X2BGR10LE))
+        c->convert_unscaled = planarRgb16ToRgb16Wrapper;
+
     if (av_pix_fmt_desc_get(srcFormat)->comp[0].depth == 8 &&
         isPackedRGB(srcFormat) && dstFormat == AV_PIX_FMT_GBRP)
         c->convert_unscaled = rgbToPlanarRgbWrapper;
@@ -205,6 +205,9 @@ static const struct {
         { "vf_sobel", checkasm_check_vf_sobel },
     #endif
 #endif
+#if CONFIG_SWRESAMPLE
+    { "sw_resample", checkasm_check_sw_resample },
+#endif
 #if CONFIG_SWSCALE
     { "sw_gbrp", checkasm_check_sw_gbrp },
     { "sw_rgb", checkasm_check_sw_rgb },
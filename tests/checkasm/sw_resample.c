@@ -0,0 +1,166 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/mathematics.h"
+#include "libavutil/mem_internal.h"
+#include "libavutil/samplefmt.h"
+
+#include "libswresample/resample.h"
+
+#include "checkasm.h"
+
+#define PHASE_COUNT  32
+#define MAX_FILTER   64
+#define FILTER_ALLOC FFALIGN(MAX_FILTER, 8)
+#define DST_SIZE     256
+/* enough input for DST_SIZE outputs at the lowest tested output rate,
+ * plus one block of overread past the last filter tap */
+#define SRC_SIZE     (DST_SIZE * 2 + MAX_FILTER + 64)
+
+static void randomize(uint8_t *buf, enum AVSampleFormat fmt, int n, int bits)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        switch (fmt) {
+        case AV_SAMPLE_FMT_S16P:
+            ((int16_t *)buf)[i] = (int)(rnd() & ((1 << bits) - 1)) - (1 << (bits - 1));
+            break;
+        case AV_SAMPLE_FMT_FLTP:
+            ((float *)buf)[i]   = (float)rnd() / UINT_MAX * 2.0f - 1.0f;
+            break;
+        case AV_SAMPLE_FMT_DBLP:
+            ((double *)buf)[i]  = (double)rnd() / UINT_MAX * 2.0 - 1.0;
+            break;
+        }
+    }
+}
+
+static void init_context(ResampleContext *c, enum AVSampleFormat fmt,
+                         uint8_t *filter_bank, int filter_length,
+                         int in_rate, int out_rate)
+{
+    int i;
+
+    memset(c, 0, sizeof(*c));
+    c->format        = fmt;
+    c->felem_size    = av_get_bytes_per_sample(fmt);
+    c->filter_shift  = fmt == AV_SAMPLE_FMT_S16P ? 15 : 0;
+    c->phase_count   = PHASE_COUNT;
+    c->filter_length = filter_length;
+    c->filter_alloc  = FILTER_ALLOC;
+    c->filter_bank   = filter_bank;
+    c->linear        = 1;
+
+    /* taps past filter_length must be zero, as in build_filter() */
+    memset(filter_bank, 0, FILTER_ALLOC * (PHASE_COUNT + 1) * c->felem_size);
+    for (i = 0; i <= PHASE_COUNT; i++)
+        randomize(filter_bank + i * FILTER_ALLOC * c->felem_size, fmt,
+                  filter_length, 12);
+
+    av_reduce(&c->src_incr, &c->dst_incr, out_rate,
+              in_rate * (int64_t)PHASE_COUNT, INT32_MAX / 2);
+    while (c->dst_incr < (1 << 20) && c->src_incr < (1 << 20)) {
+        c->dst_incr *= 2;
+        c->src_incr *= 2;
+    }
+    c->ideal_dst_incr = c->dst_incr;
+    c->dst_incr_div   = c->dst_incr / c->src_incr;
+    c->dst_incr_mod   = c->dst_incr % c->src_incr;
+
+    swri_resample_dsp_init(c);
+}
+
+static int compare(enum AVSampleFormat fmt, const uint8_t *a, const uint8_t *b, int n)
+{
+    switch (fmt) {
+    case AV_SAMPLE_FMT_S16P:
+        return memcmp(a, b, n * sizeof(int16_t));
+    case AV_SAMPLE_FMT_FLTP:
+        return !float_near_abs_eps_array((const float *)a, (const float *)b,
+                                         1e-4f, n);
+    case AV_SAMPLE_FMT_DBLP:
+        return !double_near_abs_eps_array((const double *)a, (const double *)b,
+                                          1e-12, n);
+    }
+    return 1;
+}
+
+static void check_resample(enum AVSampleFormat fmt, int linear)
+{
+    static const int filter_lengths[] = { 8, 18, 32, MAX_FILTER };
+    static const int out_rates[]      = { 48000, 22050, 47999 };
+    const char *name = av_get_sample_fmt_name(fmt);
+    LOCAL_ALIGNED_32(uint8_t, filter_bank, [FILTER_ALLOC * (PHASE_COUNT + 1) * 8]);
+    LOCAL_ALIGNED_32(uint8_t, src, [SRC_SIZE * 8]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_SIZE * 8]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_SIZE * 8]);
+    ResampleContext c, c0, c1;
+    int i, j;
+
+    declare_func(int, ResampleContext *c, void *dst, const void *src,
+                 int n, int update_ctx);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(filter_lengths); i++) {
+        init_context(&c, fmt, filter_bank, filter_lengths[i], 44100, out_rates[0]);
+        if (!check_func(linear ? c.dsp.resample_linear : c.dsp.resample_common,
+                        "resample_%s_%s_%d", linear ? "linear" : "common",
+                        name, filter_lengths[i]))
+            continue;
+
+        for (j = 0; j < FF_ARRAY_ELEMS(out_rates); j++) {
+            int ret0, ret1;
+
+            init_context(&c, fmt, filter_bank, filter_lengths[i], 44100, out_rates[j]);
+            randomize(src, fmt, SRC_SIZE, 13);
+
+            c.index = rnd() % PHASE_COUNT;
+            c.frac  = rnd() % c.src_incr;
+            c0 = c1 = c;
+            memset(dst0, 0, DST_SIZE * 8);
+            memset(dst1, 0, DST_SIZE * 8);
+            ret0 = call_ref(&c0, dst0, src, DST_SIZE, 1);
+            ret1 = call_new(&c1, dst1, src, DST_SIZE, 1);
+            if (ret0 != ret1 || c0.index != c1.index || c0.frac != c1.frac ||
+                compare(fmt, dst0, dst1, DST_SIZE))
+                fail();
+        }
+
+        init_context(&c, fmt, filter_bank, filter_lengths[i], 44100, out_rates[0]);
+        bench_new(&c, dst1, src, DST_SIZE, 0);
+    }
+}
+
+void checkasm_check_sw_resample(void)
+{
+    static const enum AVSampleFormat fmts[] = {
+        AV_SAMPLE_FMT_S16P, AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_DBLP,
+    };
+    int i;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(fmts); i++)
+        check_resample(fmts[i], 0);
+    report("resample_common");
+
+    for (i = 0; i < FF_ARRAY_ELEMS(fmts); i++)
+        check_resample(fmts[i], 1);
+    report("resample_linear");
+}
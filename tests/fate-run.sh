@@ -106,6 +106,17 @@ probeframes(){
     run ffprobe${PROGSUF}${EXECSUF} -bitexact -show_frames "$@"
 }
 
+probe_read_threads(){
+    file="${outdir}/${test}.nut"
+    seqfile="${outdir}/${test}.seq"
+    cleanfiles="$cleanfiles $file $seqfile"
+    ffmpeg -bitexact "$@" -flags +bitexact -fflags +bitexact -f nut -y "$file" || return
+    probe="-bitexact -of compact -show_frames $file"
+    run ffprobe${PROGSUF}${EXECSUF} -read_threads 1 $probe > "$seqfile" || return
+    run ffprobe${PROGSUF}${EXECSUF} -read_threads 2 $probe | diff -u "$seqfile" - || return
+    cat "$seqfile"
+}
+
 probechapters(){
     run ffprobe${PROGSUF}${EXECSUF} -bitexact -show_chapters "$@"
 }
@@ -282,6 +293,37 @@ stream_remux(){
         run ffprobe${PROGSUF}${EXECSUF} -bitexact $ffprobe_opts $tencfile || return
 }
 
+chunked_encode(){
+    src=$1
+    enc_opt=$2
+    encfile="${outdir}/${test}.nut"
+    test $keep -ge 1 || cleanfiles="$cleanfiles $encfile"
+    tencfile=$(target_path $encfile)
+    ffmpeg -f lavfi -i $src $ENC_OPTS $enc_opt -chunk_threads 2 -chunk_duration 0.2 \
+           $FLAGS -f nut -y $tencfile || return
+    run ffprobe${PROGSUF}${EXECSUF} -bitexact -of csv=p=0 -show_entries packet=pts,dts $tencfile |
+        awk -F, '($2 != "N/A" && dts != "" && $2 <= dts) || ($1 != "N/A" && $2 != "N/A" && $1 < $2) ||
+                 ($1 != "N/A" && seen[$1]++) {
+                     print "invalid timestamps in packet " NR; err = 1 }
+                 $2 != "N/A" { dts = $2 }
+                 END { print NR " packets"; exit err }' || return
+    ffmpeg $DEC_OPTS -i $tencfile $ENC_OPTS $FLAGS -f framecrc - || return
+}
+
+aresample_threads(){
+    src=$1
+    opts=$2
+    serial="${outdir}/${test}.serial"
+    cleanfiles="$cleanfiles $serial"
+    ffmpeg -filter_threads 4 -f lavfi -i "$src" -af "aresample=$opts:threads=1" \
+           -bitexact -f framecrc - > "$serial" || return
+    ffmpeg -filter_threads 4 -f lavfi -i "$src" -af "aresample=$opts:threads=4" \
+           -bitexact -f framecrc - | diff -u "$serial" - || return
+    # the samples depend on the resampling kernels of the platform, so only
+    # their layout is printed once threaded output matches serial output
+    cut -d, -f1-5 "$serial"
+}
+
 # FIXME: There is a certain duplication between the avconv-related helper
 # functions above and below that should be refactored.
 ffmpeg2="$target_exec ${target_path}/ffmpeg${PROGSUF}${EXECSUF}"
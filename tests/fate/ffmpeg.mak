@@ -220,6 +220,19 @@ fate-ffmpeg-setts-bsf: CMD = framecrc -i $(TARGET_SAMPLES)/apng/clock.png -c:v c
 
 FATE_SAMPLES_FFMPEG-yes += $(FATE_STREAMCOPY-yes)
 
+# chunked encoding: every chunk is a closed GOP from its own encoder, the
+# stitched stream must have increasing dts, unique pts not below dts (also
+# with B-frames reordered across the encoders' delay) and decode in one piece
+FATE_FFMPEG_CHUNKS-$(call ENCDEC, MPEG2VIDEO, NUT, LAVFI_INDEV TESTSRC2_FILTER FORMAT_FILTER) += fate-ffmpeg-chunks-mpeg2video fate-ffmpeg-chunks-mpeg2video-bf
+fate-ffmpeg-chunks-mpeg2video: CMD = chunked_encode testsrc2=s=176x144:r=25:d=2,format=yuv420p "-c:v mpeg2video -g 12"
+fate-ffmpeg-chunks-mpeg2video-bf: CMD = chunked_encode testsrc2=s=176x144:r=25:d=2,format=yuv420p "-c:v mpeg2video -g 12 -bf 2"
+
+FATE_FFMPEG_CHUNKS-$(call ENCDEC, MPEG4, NUT, LAVFI_INDEV TESTSRC2_FILTER FORMAT_FILTER) += fate-ffmpeg-chunks-mpeg4 fate-ffmpeg-chunks-mpeg4-bf
+fate-ffmpeg-chunks-mpeg4: CMD = chunked_encode testsrc2=s=176x144:r=25:d=2,format=yuv420p "-c:v mpeg4 -g 12"
+fate-ffmpeg-chunks-mpeg4-bf: CMD = chunked_encode testsrc2=s=176x144:r=25:d=2,format=yuv420p "-c:v mpeg4 -g 12 -bf 2"
+
+FATE_FFMPEG_FFPROBE-$(HAVE_THREADS) += $(FATE_FFMPEG_CHUNKS-yes)
+
 FATE_TIME_BASE-$(call PARSERDEMDEC, MPEGVIDEO, MPEGPS, MPEG2VIDEO, MPEGVIDEO_DEMUXER MXF_MUXER) += fate-time_base
 fate-time_base: CMD = md5 -i $(TARGET_SAMPLES)/mpeg2/dvd_single_frame.vob -an -sn -c:v copy -r 25 -time_base 1001:30000 -fflags +bitexact -f mxf
 
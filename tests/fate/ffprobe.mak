@@ -25,6 +25,10 @@ FATE_FFPROBE-$(CONFIG_AVDEVICE) += fate-ffprobe_json
 fate-ffprobe_json: $(FFPROBE_TEST_FILE)
 fate-ffprobe_json: CMD = run $(FFPROBE_COMMAND) -of json
 
+FATE_FFPROBE-$(CONFIG_AVDEVICE) += fate-ffprobe_ndjson
+fate-ffprobe_ndjson: $(FFPROBE_TEST_FILE)
+fate-ffprobe_ndjson: CMD = run $(FFPROBE_COMMAND) -of json=ndjson=1
+
 FATE_FFPROBE-$(CONFIG_AVDEVICE) += fate-ffprobe_xml
 fate-ffprobe_xml: $(FFPROBE_TEST_FILE)
 fate-ffprobe_xml: CMD = run $(FFPROBE_COMMAND) -of xml
@@ -34,8 +38,13 @@ fate-ffprobe_xsd: $(FFPROBE_TEST_FILE)
 fate-ffprobe_xsd: CMD = run $(FFPROBE_COMMAND) -noprivate -of xml=q=1:x=1 | \
 	xmllint --schema $(SRC_PATH)/doc/ffprobe.xsd -
 
+# frames read from concurrently decoded segments must match sequential reading
+FATE_FFPROBE_READ_THREADS-$(call ENCDEC2, MPEG4, PCM_S16LE, NUT, LAVFI_INDEV TESTSRC2_FILTER SINE_FILTER) += fate-ffprobe-read-threads
+fate-ffprobe-read-threads: CMD = probe_read_threads -f lavfi -i testsrc2=s=176x144:r=25:d=4 -f lavfi -i sine=d=4 -c:v mpeg4 -g 12 -bf 2 -c:a pcm_s16le
+
 FATE_FFPROBE-$(HAVE_XMLLINT) += $(FATE_FFPROBE_SCHEMA-yes)
 FATE_FFPROBE += $(FATE_FFPROBE-yes)
+FATE_FFMPEG_FFPROBE-$(HAVE_THREADS) += $(FATE_FFPROBE_READ_THREADS-yes)
 
 fate-ffprobe: $(FATE_FFPROBE)
 
@@ -94,6 +94,16 @@ fate-filter-asetnsamples-nopad: tests/data/asynth-44100-2.wav
 fate-filter-asetnsamples-nopad: SRC = $(TARGET_PATH)/tests/data/asynth-44100-2.wav
 fate-filter-asetnsamples-nopad: CMD = framecrc -i $(SRC) -af asetnsamples=512:p=0
 
+# channels resampled in parallel must give the same output as serial resampling
+FATE_AFILTER_ARESAMPLE_THREADS-$(call ALLYES, LAVFI_INDEV AEVALSRC_FILTER ARESAMPLE_FILTER \
+                                              PCM_S16LE_ENCODER FRAMECRC_MUXER)            \
+    += fate-filter-aresample-threads-up fate-filter-aresample-threads-down
+fate-filter-aresample-threads-up: CMD = aresample_threads \
+    "aevalsrc=sin(440*2*PI*t)|sin(550*2*PI*t)|sin(660*2*PI*t)|sin(770*2*PI*t)|sin(880*2*PI*t)|sin(990*2*PI*t):s=44100:d=1" 48000
+fate-filter-aresample-threads-down: CMD = aresample_threads \
+    "aevalsrc=sin(440*2*PI*t)|sin(550*2*PI*t)|sin(660*2*PI*t)|sin(770*2*PI*t)|sin(880*2*PI*t)|sin(990*2*PI*t)|sin(1100*2*PI*t)|sin(1210*2*PI*t):s=48000:d=1" 22050:linear_interp=1
+FATE_AFILTER-$(HAVE_THREADS) += $(FATE_AFILTER_ARESAMPLE_THREADS-yes)
+
 FATE_AFILTER-$(call FILTERDEMDECENCMUX, ASETRATE, WAV, PCM_S16LE, PCM_S16LE, WAV) += fate-filter-asetrate
 fate-filter-asetrate: tests/data/asynth-44100-2.wav
 fate-filter-asetrate: SRC = $(TARGET_PATH)/tests/data/asynth-44100-2.wav
@@ -652,6 +652,22 @@ FATE_METADATA_FILTER-$(call ALLYES, $(SCDET_DEPS)) += fate-filter-metadata-scdet
 fate-filter-metadata-scdet: SRC = $(TARGET_SAMPLES)/svq3/Vertical400kbit.sorenson3.mov
 fate-filter-metadata-scdet: CMD = run $(FILTER_METADATA_COMMAND) "sws_flags=+accurate_rnd+bitexact;movie='$(SRC)',scdet=s=1"
 
+# scene scores are computed in slices, which must give the same scores as a
+# single slice, also on frames decimated by lowres
+SCENE_DEPS = LAVFI_INDEV TESTSRC2_FILTER FORMAT_FILTER NEGATE_FILTER METADATA_FILTER \
+             NULL_MUXER PIPE_PROTOCOL
+FATE_FILTER_SCENE-$(call ALLYES, $(SCENE_DEPS) SCDET_FILTER) += fate-filter-scdet-lowres fate-filter-scdet-lowres-threads
+FATE_FILTER_SCENE-$(call ALLYES, $(SCENE_DEPS) SELECT_FILTER) += fate-filter-select-scene fate-filter-select-scene-threads
+$(FATE_FILTER_SCENE-yes): REF = $(SRC_PATH)/tests/ref/fate/$(subst -threads,,$(@:fate-%=%))
+$(FATE_FILTER_SCENE-yes): CMD = ffmpeg -filter_threads $(SCENE_THREADS) -f lavfi \
+    -i "testsrc2=s=322x242:r=10:d=3,format=yuv420p,negate=enable=mod(floor(t*2)\,2)" \
+    -vf "$(SCENE_FILTER),metadata=mode=print:file=pipe\\\\:1" -f null -
+fate-filter-scdet-lowres fate-filter-scdet-lowres-threads: SCENE_FILTER = scdet=s=0:lowres=1
+fate-filter-select-scene fate-filter-select-scene-threads: SCENE_FILTER = select=gt(scene\,0.3)
+$(filter-out %-threads,$(FATE_FILTER_SCENE-yes)): SCENE_THREADS = 1
+$(filter %-threads,$(FATE_FILTER_SCENE-yes)): SCENE_THREADS = 4
+FATE_FILTER-yes += $(FATE_FILTER_SCENE-yes)
+
 CROPDETECT_DEPS = LAVFI_INDEV FILE_PROTOCOL MOVIE_FILTER MOVIE_FILTER MESTIMATE_FILTER CROPDETECT_FILTER \
                   SCALE_FILTER MOV_DEMUXER H264_DECODER
 FATE_METADATA_FILTER-$(call ALLYES, $(CROPDETECT_DEPS)) += fate-filter-metadata-cropdetect
@@ -732,6 +748,80 @@ FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER SPLIT_FILTER AVGBLUR_FILTER        \
                            METADATA_FILTER WRAPPED_AVFRAME_ENCODER NULL_MUXER \
                            PIPE_PROTOCOL) += $(FATE_FILTER_REFCMP_METADATA-yes)
 
+# Parallel filter activation must give the same output as serial execution,
+# including for commands sent by sendcmd while other filters are running.
+FATE_FILTER_GRAPH_THREADS-$(call ALLYES, TESTSRC2_FILTER FORMAT_FILTER SENDCMD_FILTER  \
+                                         SPLIT_FILTER HUE_FILTER NEGATE_FILTER      \
+                                         HFLIP_FILTER HSTACK_FILTER)                \
+    += fate-filter-graph-threads-sendcmd-serial fate-filter-graph-threads-sendcmd
+$(FATE_FILTER_GRAPH_THREADS-yes): libavfilter/tests/parallel$(EXESUF)
+$(FATE_FILTER_GRAPH_THREADS-yes): GRAPH = "testsrc2=s=96x64:r=25:d=2,format=yuv420p,sendcmd=c=0.4 hue h 90,sendcmd=c=1.2 hue s 0,split[a][b];[a]hue[x];[b]negate,hflip[y];[x][y]hstack,buffersink"
+$(FATE_FILTER_GRAPH_THREADS-yes): REF = $(SRC_PATH)/tests/ref/fate/filter-graph-threads-sendcmd
+fate-filter-graph-threads-sendcmd-serial: CMD = run libavfilter/tests/parallel$(EXESUF) 1 $(GRAPH)
+fate-filter-graph-threads-sendcmd: CMD = run libavfilter/tests/parallel$(EXESUF) 4 $(GRAPH)
+FATE_FILTER-yes += $(FATE_FILTER_GRAPH_THREADS-yes)
+
+# frames shared by split are copied by perms=rw before being made writable;
+# with several filter threads, large frames are copied in bands by the slice
+# threads, which must give the same output as av_frame_copy()
+FRAME_COPY_FMTS = yuv420p nv12 rgb48le
+FATE_FILTER_FRAME_COPY-$(call ALLYES, TESTSRC2_FILTER SCALE_FILTER FORMAT_FILTER SPLIT_FILTER \
+                                      PERMS_FILTER VSTACK_FILTER LAVFI_INDEV)            \
+    += $(FRAME_COPY_FMTS:%=fate-filter-frame-copy-%) $(FRAME_COPY_FMTS:%=fate-filter-frame-copy-%-threads)
+$(FATE_FILTER_FRAME_COPY-yes): COPY_FMT = $(firstword $(subst -threads,,$(@:fate-filter-frame-copy-%=%)))
+$(FATE_FILTER_FRAME_COPY-yes): REF = $(SRC_PATH)/tests/ref/fate/filter-frame-copy-$(COPY_FMT)
+$(FATE_FILTER_FRAME_COPY-yes): CMD = framecrc -filter_threads $(COPY_THREADS) -f lavfi -i testsrc2=s=1922x1082:d=0.12 \
+    -vf "scale,format=$(COPY_FMT),split[a][b];[a]perms=rw[c];[c][b]vstack"
+$(FRAME_COPY_FMTS:%=fate-filter-frame-copy-%): COPY_THREADS = 1
+$(FRAME_COPY_FMTS:%=fate-filter-frame-copy-%-threads): COPY_THREADS = 4
+FATE_FILTER-yes += $(FATE_FILTER_FRAME_COPY-yes)
+
+# a chain of 1000 null filters must pass every frame through unchanged;
+# this runs about 20 times slower if picking the next filter to activate
+# is linear in the graph size
+DIGITS = 0 1 2 3 4 5 6 7 8 9
+NULL_CHAIN = $(foreach a,$(DIGITS),$(foreach b,$(DIGITS),$(foreach c,$(DIGITS),null,)))
+FATE_FILTER_LONG_CHAIN-$(call ALLYES, TESTSRC2_FILTER NULL_FILTER) \
+    += fate-filter-graph-long-chain fate-filter-graph-short-chain
+$(FATE_FILTER_LONG_CHAIN-yes): libavfilter/tests/parallel$(EXESUF)
+$(FATE_FILTER_LONG_CHAIN-yes): REF = $(SRC_PATH)/tests/ref/fate/filter-graph-long-chain
+fate-filter-graph-long-chain: CMD = run libavfilter/tests/parallel$(EXESUF) 1 "testsrc2=s=64x64:r=25:d=20,$(NULL_CHAIN)buffersink"
+fate-filter-graph-short-chain: CMD = run libavfilter/tests/parallel$(EXESUF) 1 "testsrc2=s=64x64:r=25:d=20,buffersink"
+FATE_FILTER-yes += $(FATE_FILTER_LONG_CHAIN-yes)
+
+# chains of adjacent lookup-table filters of the same kind are fused into
+# their head, unless timeline support is enabled; both must give the same
+# output, also once a command or a timeline change splits the fused chain
+FATE_FILTER_FUSE_LUT-$(call ALLYES, TESTSRC2_FILTER FORMAT_FILTER SENDCMD_FILTER LUTYUV_FILTER) \
+    += fate-filter-lutyuv-fused fate-filter-lutyuv-unfused
+$(FATE_FILTER_FUSE_LUT-yes): libavfilter/tests/parallel$(EXESUF)
+$(FATE_FILTER_FUSE_LUT-yes): GRAPH = "testsrc2=s=96x64:r=25:d=2,format=yuv420p,sendcmd=c=0.4 lutyuv@b y val/2,sendcmd=c=0.8 lutyuv@c enable floor(t/1.2),lutyuv@a=y=val*2:u=negval$(ENABLE),lutyuv@b=y=val/3+20$(ENABLE),lutyuv@c=v=255-val:y=val+7$(ENABLE),buffersink"
+$(FATE_FILTER_FUSE_LUT-yes): REF = $(SRC_PATH)/tests/ref/fate/filter-lutyuv-fused
+fate-filter-lutyuv-fused: CMD = run libavfilter/tests/parallel$(EXESUF) 4 $(GRAPH)
+fate-filter-lutyuv-unfused: ENABLE = :enable=1
+fate-filter-lutyuv-unfused: CMD = run libavfilter/tests/parallel$(EXESUF) 1 $(GRAPH)
+FATE_FILTER-yes += $(FATE_FILTER_FUSE_LUT-yes)
+
+FATE_FILTER_FUSE_CURVES-$(call ALLYES, TESTSRC2_FILTER FORMAT_FILTER SENDCMD_FILTER CURVES_FILTER) \
+    += fate-filter-curves-fused fate-filter-curves-unfused
+$(FATE_FILTER_FUSE_CURVES-yes): libavfilter/tests/parallel$(EXESUF)
+$(FATE_FILTER_FUSE_CURVES-yes): GRAPH = "testsrc2=s=96x64:r=25:d=2,format=rgb24,sendcmd=c=0.4 curves@b preset darker,sendcmd=c=0.8 curves@a enable floor(t/1.2),curves@a=preset=vintage$(ENABLE),curves@b=preset=increase_contrast$(ENABLE),buffersink"
+$(FATE_FILTER_FUSE_CURVES-yes): REF = $(SRC_PATH)/tests/ref/fate/filter-curves-fused
+fate-filter-curves-fused: CMD = run libavfilter/tests/parallel$(EXESUF) 4 $(GRAPH)
+fate-filter-curves-unfused: ENABLE = :enable=1
+fate-filter-curves-unfused: CMD = run libavfilter/tests/parallel$(EXESUF) 1 $(GRAPH)
+FATE_FILTER-yes += $(FATE_FILTER_FUSE_CURVES-yes)
+
+# scaler configurations reused from the cache, or evicted from it, must give
+# the same output as scalers initialized anew on every size change
+FATE_FILTER_SCALE_CACHE-$(call ALLYES, TESTSRC2_FILTER SCALE_FILTER) \
+    += fate-filter-scale-cache-0 fate-filter-scale-cache-1 fate-filter-scale-cache-4
+$(FATE_FILTER_SCALE_CACHE-yes): libavfilter/tests/parallel$(EXESUF)
+$(FATE_FILTER_SCALE_CACHE-yes): REF = $(SRC_PATH)/tests/ref/fate/filter-scale-cache-0
+$(FATE_FILTER_SCALE_CACHE-yes): CMD = run libavfilter/tests/parallel$(EXESUF) 1 \
+    "testsrc2=s=176x144:r=25:d=1,scale=w=if(lt(mod(n\,6)\,3)\,128\,96):h=if(lt(mod(n\,4)\,2)\,96\,64):eval=frame:flags=bicubic+accurate_rnd+bitexact:cache_size=$(@:fate-filter-scale-cache-%=%),buffersink"
+FATE_FILTER-yes += $(FATE_FILTER_SCALE_CACHE-yes)
+
 FATE_SAMPLES_FFPROBE += $(FATE_METADATA_FILTER-yes)
 FATE_SAMPLES_FFMPEG += $(FATE_FILTER_SAMPLES-yes)
 FATE_FFMPEG += $(FATE_FILTER-yes)
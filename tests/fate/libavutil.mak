@@ -39,6 +39,10 @@ FATE_LIBAVUTIL += fate-base64
 fate-base64: libavutil/tests/base64$(EXESUF)
 fate-base64: CMD = run libavutil/tests/base64$(EXESUF)
 
+FATE_LIBAVUTIL += fate-buffer
+fate-buffer: libavutil/tests/buffer$(EXESUF)
+fate-buffer: CMD = run libavutil/tests/buffer$(EXESUF)
+
 FATE_LIBAVUTIL += fate-blowfish
 fate-blowfish: libavutil/tests/blowfish$(EXESUF)
 fate-blowfish: CMD = run libavutil/tests/blowfish$(EXESUF)
@@ -108,6 +112,10 @@ FATE_LIBAVUTIL += fate-lfg
 fate-lfg: libavutil/tests/lfg$(EXESUF)
 fate-lfg: CMD = run libavutil/tests/lfg$(EXESUF)
 
+FATE_LIBAVUTIL-$(HAVE_THREADS) += fate-log
+fate-log: libavutil/tests/log$(EXESUF)
+fate-log: CMD = run libavutil/tests/log$(EXESUF)
+
 FATE_LIBAVUTIL += fate-md5
 fate-md5: libavutil/tests/md5$(EXESUF)
 fate-md5: CMD = run libavutil/tests/md5$(EXESUF)
@@ -162,6 +170,10 @@ FATE_LIBAVUTIL += fate-xtea
 fate-xtea: libavutil/tests/xtea$(EXESUF)
 fate-xtea: CMD = run libavutil/tests/xtea$(EXESUF)
 
+FATE_LIBAVUTIL += fate-xxhash
+fate-xxhash: libavutil/tests/xxhash$(EXESUF)
+fate-xxhash: CMD = run libavutil/tests/xxhash$(EXESUF)
+
 FATE_LIBAVUTIL += fate-tea
 fate-tea: libavutil/tests/tea$(EXESUF)
 fate-tea: CMD = run libavutil/tests/tea$(EXESUF)
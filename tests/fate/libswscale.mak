@@ -33,6 +33,26 @@ fate-sws-yuv-range: CMD = framecrc \
   -frames 1 \
   -vf scale=in_color_matrix=bt601:in_range=limited:out_color_matrix=bt601:out_range=full:flags=+accurate_rnd+bitexact
 
+# unscaled conversions between the semi-planar, packed and planar layouts
+# of high bit depth formats; the YUV ones must give the same output as the
+# generic scaler
+SWS_UNSCALED = yuv420p10le-p010le p010le-yuv420p10le \
+               p012le-yuv420p12le \
+               yuv420p16le-p016le p016le-yuv420p16le \
+               yuv422p10le-y210le y210le-yuv422p10le \
+               yuv422p12le-y212le y212le-yuv422p12le \
+               gbrp10le-x2rgb10le x2rgb10le-gbrp10le \
+               gbrap10le-x2bgr10le x2bgr10le-gbrap10le
+
+FATE_SWS_UNSCALED-$(call ALLYES, LAVFI_INDEV TESTSRC2_FILTER FORMAT_FILTER SCALE_FILTER \
+                                 RAWVIDEO_ENCODER FRAMECRC_MUXER) = $(SWS_UNSCALED:%=fate-sws-unscaled-%)
+$(FATE_SWS_UNSCALED-yes): ffmpeg$(PROGSSUF)$(EXESUF)
+$(FATE_SWS_UNSCALED-yes): SWS_FMTS = $(subst -, ,$(@:fate-sws-unscaled-%=%))
+$(FATE_SWS_UNSCALED-yes): CMD = framecrc -f lavfi -i testsrc2=s=352x288:d=0.2 \
+  -vf scale,format=$(word 1,$(SWS_FMTS)),scale,format=$(word 2,$(SWS_FMTS))
+FATE_LIBSWSCALE += $(FATE_SWS_UNSCALED-yes)
+fate-sws-unscaled: $(FATE_SWS_UNSCALED-yes)
+
 FATE_LIBSWSCALE += $(FATE_LIBSWSCALE-yes)
 FATE_LIBSWSCALE_SAMPLES += $(FATE_LIBSWSCALE_SAMPLES-yes)
 FATE-$(CONFIG_SWSCALE) += $(FATE_LIBSWSCALE)